@@ -0,0 +1,73 @@
+// Allocations.cpp
+#include "Allocations.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> allocationCount{ 0 };
+static std::atomic<uint64_t> freeCount{ 0 };
+static std::atomic<uint64_t> allocatedBytes{ 0 };
+
+static void* countedAllocate(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+static void countedFree(void* pointer) {
+    if (!pointer) return;
+    freeCount.fetch_add(1, std::memory_order_relaxed);
+    free(pointer);
+}
+
+void* operator new(size_t size) {
+    void* pointer = countedAllocate(size);
+    if (!pointer) throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new[](size_t size) {
+    void* pointer = countedAllocate(size);
+    if (!pointer) throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    countedFree(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    countedFree(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    countedFree(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    countedFree(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+    countedFree(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+    countedFree(pointer);
+}
+
+AllocationTotals allocationTotals() {
+    AllocationTotals totals;
+    totals.allocations = allocationCount.load(std::memory_order_relaxed);
+    totals.frees = freeCount.load(std::memory_order_relaxed);
+    totals.bytes = allocatedBytes.load(std::memory_order_relaxed);
+    return totals;
+}
@@ -0,0 +1,16 @@
+// Allocations.h
+#pragma once
+#include <cstdint>
+
+// Heap accounting. Allocations.cpp replaces the global operator new and
+// delete, so every C++ heap allocation on any thread is counted. Memory
+// taken with malloc directly (GLU, GLUT, the C runtime) is not seen.
+// The renderer reads the totals once per frame; the goal for a steady
+// frame is zero allocations.
+struct AllocationTotals {
+    uint64_t allocations = 0;  // Since start
+    uint64_t frees = 0;
+    uint64_t bytes = 0;        // Requested, since start
+};
+
+AllocationTotals allocationTotals();
@@ -0,0 +1,559 @@
+// Atmosphere.cpp
+#include "Atmosphere.h"
+#include "Jobs.h"
+#include "PerfCounters.h"
+#include "Shaders.h"
+#include <GL/glu.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static const int TRANSMITTANCE_STEPS = 64; // Integration steps per transmittance texel
+static const int SCATTERING_STEPS = 48;    // Integration steps per scattering texel
+static const int ATMOSPHERE_CACHE_VERSION = 1;
+static const int ATMOSPHERE_SLICES = 64;   // Shell sphere tessellation
+static const float PI = 3.14159265f;
+
+struct AtmosphereCacheHeader {
+    char magic[4];
+    int version;
+    int sizes[6];
+    AtmosphereParams params;
+};
+
+struct AtmospherePreset {
+    const char* name;
+    AtmosphereParams params;
+};
+
+static AtmospherePreset makePreset(const char* name, float r, float g, float b, float mie, float mieG, float intensity) {
+    AtmospherePreset preset;
+    preset.name = name;
+    preset.params.rayleighDepth[0] = r;
+    preset.params.rayleighDepth[1] = g;
+    preset.params.rayleighDepth[2] = b;
+    preset.params.mieDepth = mie;
+    preset.params.mieG = mieG;
+    preset.params.sunIntensity = intensity;
+    return preset;
+}
+
+// Earth is physical (scaled to the exaggerated thickness); the others are
+// tuned by eye to their colors: sulfuric haze, dust, and hydrogen-methane
+static const AtmospherePreset ATMOSPHERE_PRESETS[] = {
+    makePreset("Earth", 0.046f, 0.108f, 0.265f, 0.025f, 0.76f, 12.0f),
+    makePreset("Venus", 0.30f, 0.26f, 0.16f, 0.60f, 0.70f, 8.0f),
+    makePreset("Mars", 0.030f, 0.020f, 0.012f, 0.12f, 0.65f, 12.0f),
+    makePreset("Jupiter", 0.08f, 0.09f, 0.12f, 0.10f, 0.70f, 10.0f),
+    makePreset("Saturn", 0.09f, 0.09f, 0.08f, 0.10f, 0.70f, 10.0f),
+    makePreset("Uranus", 0.04f, 0.14f, 0.20f, 0.03f, 0.70f, 12.0f),
+    makePreset("Neptune", 0.03f, 0.10f, 0.30f, 0.03f, 0.70f, 12.0f),
+};
+
+static std::map<std::string, AtmosphereModel*> atmosphereModels;
+static GLuint atmosphereProgram = 0;
+static GLint planetCenterLoc = -1, planetRadiusLoc = -1, sunDirLoc = -1;
+static GLint heightLoc = -1, mieGLoc = -1, sunIntensityLoc = -1;
+static GLUquadric* shellQuadric = nullptr;
+
+AtmosphereParams atmospherePreset(const char* name) {
+    for (const AtmospherePreset& preset : ATMOSPHERE_PRESETS) {
+        if (name && strcmp(name, preset.name) == 0) return preset.params;
+    }
+    return AtmosphereParams();
+}
+
+// Texture coordinates in [0, 1] for each table dimension. r is spaced by
+// its square root and mu by the square root of its magnitude, both to put
+// more texels near the ground and the horizon. The shader has the same
+// mappings.
+static float clamp01(float x) {
+    return std::min(std::max(x, 0.0f), 1.0f);
+}
+
+static float rCoord(const AtmosphereParams& p, float r) {
+    return sqrtf(clamp01((r - 1.0f) / p.height));
+}
+
+static float muCoord(float mu) {
+    float m = sqrtf(std::min(fabsf(mu), 1.0f));
+    return 0.5f + 0.5f * (mu < 0.0f ? -m : m);
+}
+
+static float cosineCoord(float c) {
+    return clamp01(0.5f * (c + 1.0f));
+}
+
+// Inverses, for the texel centers being computed
+static float rFromCoord(const AtmosphereParams& p, float u) {
+    return 1.0f + p.height * u * u;
+}
+
+static float muFromCoord(float u) {
+    float m = 2.0f * u - 1.0f;
+    return m * fabsf(m);
+}
+
+// Texel i of n sits at coordinate i / (n - 1), so both ends are exact
+static void texelPosition(float u, int n, int& i, float& f) {
+    float x = clamp01(u) * (n - 1);
+    i = std::min((int)x, n - 2);
+    f = x - i;
+}
+
+static void betas(const AtmosphereParams& p, float* rayleigh, float& mie) {
+    for (int c = 0; c < 3; ++c) rayleigh[c] = p.rayleighDepth[c] / (p.rayleighScale * p.height);
+    mie = p.mieDepth / (p.mieScale * p.height);
+}
+
+// Distance from radius r along zenith cosine mu to the top of the atmosphere
+static float distanceToTop(const AtmosphereParams& p, float r, float mu) {
+    float top = 1.0f + p.height;
+    return -r * mu + sqrtf(std::max(r * r * (mu * mu - 1.0f) + top * top, 0.0f));
+}
+
+static void computeTransmittance(const AtmosphereParams& p, float r, float mu, float* rgb) {
+    float rayleigh[3], mie;
+    betas(p, rayleigh, mie);
+    float dt = distanceToTop(p, r, mu) / TRANSMITTANCE_STEPS;
+    float depthR = 0.0f, depthM = 0.0f;
+    for (int i = 0; i < TRANSMITTANCE_STEPS; ++i) {
+        float t = (i + 0.5f) * dt;
+        float h = std::max(sqrtf(r * r + t * t + 2.0f * r * mu * t) - 1.0f, 0.0f);
+        depthR += expf(-h / (p.rayleighScale * p.height));
+        depthM += expf(-h / (p.mieScale * p.height));
+    }
+    for (int c = 0; c < 3; ++c) {
+        rgb[c] = expf(-(rayleigh[c] * depthR + mie / 0.9f * depthM) * dt); // Mie extinction includes absorption
+    }
+}
+
+void atmosphereTransmittance(const AtmosphereModel& model, float r, float mu, float* rgb) {
+    int x, y;
+    float fx, fy;
+    texelPosition(muCoord(mu), TRANSMITTANCE_MU_SIZE, x, fx);
+    texelPosition(rCoord(model.params, r), TRANSMITTANCE_R_SIZE, y, fy);
+    const float* row0 = &model.transmittance[((size_t)y * TRANSMITTANCE_MU_SIZE + x) * 3];
+    const float* row1 = row0 + TRANSMITTANCE_MU_SIZE * 3;
+    for (int c = 0; c < 3; ++c) {
+        float a = row0[c] + (row0[c + 3] - row0[c]) * fx;
+        float b = row1[c] + (row1[c + 3] - row1[c]) * fx;
+        rgb[c] = a + (b - a) * fy;
+    }
+}
+
+// Single scattering along (r, mu) up to the ground or the top
+static void computeScattering(const AtmosphereModel& model, float r, float mu, float muS, float nu, float* rgba) {
+    const AtmosphereParams& p = model.params;
+    float rayleigh[3], mie;
+    betas(p, rayleigh, mie);
+
+    // Not every nu is possible for a given mu and mu_s
+    float spread = sqrtf(std::max((1.0f - mu * mu) * (1.0f - muS * muS), 0.0f));
+    nu = std::min(std::max(nu, mu * muS - spread), mu * muS + spread);
+
+    float groundDisc = r * r * (mu * mu - 1.0f) + 1.0f;
+    bool ground = mu < 0.0f && groundDisc >= 0.0f;
+    float length = ground ? std::max(-r * mu - sqrtf(groundDisc), 0.0f) : distanceToTop(p, r, mu);
+    float dt = length / SCATTERING_STEPS;
+
+    // Transmittance from x to a point p on the ray, from two table lookups:
+    // T(x, p) = T(x, top) / T(p, top), or with the ray reversed when it
+    // ends on the ground (T(r, mu) through the planet is meaningless)
+    float fromX[3];
+    atmosphereTransmittance(model, r, ground ? -mu : mu, fromX);
+
+    float sumR[3] = { 0.0f, 0.0f, 0.0f }, sumM = 0.0f;
+    for (int i = 0; i < SCATTERING_STEPS; ++i) {
+        float t = (i + 0.5f) * dt;
+        float rt = sqrtf(r * r + t * t + 2.0f * r * mu * t);
+        float muT = (r * mu + t) / rt;
+        float muST = (r * muS + t * nu) / rt;
+        if (muST < -sqrtf(std::max(1.0f - 1.0f / (rt * rt), 0.0f))) continue; // The planet hides the sun
+
+        float view[3], sun[3];
+        atmosphereTransmittance(model, rt, ground ? -muT : muT, view);
+        atmosphereTransmittance(model, rt, muST, sun);
+        float h = std::max(rt - 1.0f, 0.0f);
+        float densityR = expf(-h / (p.rayleighScale * p.height));
+        float densityM = expf(-h / (p.mieScale * p.height));
+        float average = 0.0f;
+        for (int c = 0; c < 3; ++c) {
+            float path = ground ? view[c] / std::max(fromX[c], 1e-6f) : fromX[c] / std::max(view[c], 1e-6f);
+            float lit = std::min(path, 1.0f) * sun[c];
+            sumR[c] += densityR * lit;
+            average += lit / 3.0f;
+        }
+        sumM += densityM * average;
+    }
+    for (int c = 0; c < 3; ++c) rgba[c] = rayleigh[c] * sumR[c] * dt;
+    rgba[3] = mie * sumM * dt;
+}
+
+// Quadrilinear lookup; the shader does the same with two 3D fetches
+static void lookupScattering(const AtmosphereModel& model, float r, float mu, float muS, float nu, float* rgba) {
+    int i[4];
+    float f[4];
+    texelPosition(rCoord(model.params, r), SCATTERING_R_SIZE, i[0], f[0]);
+    texelPosition(muCoord(mu), SCATTERING_MU_SIZE, i[1], f[1]);
+    texelPosition(cosineCoord(nu), SCATTERING_NU_SIZE, i[2], f[2]);
+    texelPosition(cosineCoord(muS), SCATTERING_MU_S_SIZE, i[3], f[3]);
+
+    rgba[0] = rgba[1] = rgba[2] = rgba[3] = 0.0f;
+    for (int corner = 0; corner < 16; ++corner) {
+        float weight = 1.0f;
+        size_t index = 0;
+        const int sizes[4] = { SCATTERING_R_SIZE, SCATTERING_MU_SIZE, SCATTERING_NU_SIZE, SCATTERING_MU_S_SIZE };
+        for (int d = 0; d < 4; ++d) {
+            int high = (corner >> d) & 1;
+            weight *= high ? f[d] : 1.0f - f[d];
+            index = index * sizes[d] + i[d] + high;
+        }
+        const float* texel = &model.scattering[index * 4];
+        for (int c = 0; c < 4; ++c) rgba[c] += weight * texel[c];
+    }
+}
+
+static float rayleighPhase(float nu) {
+    return 3.0f / (16.0f * PI) * (1.0f + nu * nu);
+}
+
+static float miePhase(float g, float nu) {
+    float g2 = g * g;
+    return 3.0f / (8.0f * PI) * (1.0f - g2) * (1.0f + nu * nu) /
+        ((2.0f + g2) * powf(1.0f + g2 - 2.0f * g * nu, 1.5f));
+}
+
+void atmosphereInscatter(const AtmosphereModel& model, const float* x, const float* v, const float* s, float* rgb, float* through) {
+    rgb[0] = rgb[1] = rgb[2] = 0.0f;
+    through[0] = through[1] = through[2] = 1.0f;
+
+    // Start where the ray enters the atmosphere (or at x inside it)
+    float top = 1.0f + model.params.height;
+    float rmu = x[0] * v[0] + x[1] * v[1] + x[2] * v[2];
+    float rr = x[0] * x[0] + x[1] * x[1] + x[2] * x[2];
+    float disc = rmu * rmu - rr + top * top;
+    if (disc <= 0.0f || -rmu + sqrtf(disc) <= 0.0f) return;
+    float entry = std::max(-rmu - sqrtf(disc), 0.0f);
+    float start[3] = { x[0] + v[0] * entry, x[1] + v[1] * entry, x[2] + v[2] * entry };
+
+    float r = std::min(sqrtf(start[0] * start[0] + start[1] * start[1] + start[2] * start[2]), top);
+    float mu = (start[0] * v[0] + start[1] * v[1] + start[2] * v[2]) / r;
+    float muS = (start[0] * s[0] + start[1] * s[1] + start[2] * s[2]) / r;
+    float nu = v[0] * s[0] + v[1] * s[1] + v[2] * s[2];
+
+    float scattered[4];
+    lookupScattering(model, r, mu, muS, nu, scattered);
+    float phaseR = rayleighPhase(nu), phaseM = miePhase(model.params.mieG, nu);
+    for (int c = 0; c < 3; ++c) {
+        rgb[c] = model.params.sunIntensity * (scattered[c] * phaseR + scattered[3] * phaseM);
+    }
+
+    float groundDisc = r * r * (mu * mu - 1.0f) + 1.0f;
+    if (mu < 0.0f && groundDisc >= 0.0f) {
+        float toGround[3], fromStart[3];
+        atmosphereTransmittance(model, 1.0f, sqrtf(groundDisc), toGround);
+        atmosphereTransmittance(model, r, -mu, fromStart);
+        for (int c = 0; c < 3; ++c) through[c] = std::min(toGround[c] / std::max(fromStart[c], 1e-4f), 1.0f);
+    }
+    else {
+        atmosphereTransmittance(model, r, mu, through);
+    }
+}
+
+// Jobs over rows of the tables
+static void transmittanceRows(void* data, int begin, int end) {
+    AtmosphereModel& model = *(AtmosphereModel*)data;
+    for (int y = begin; y < end; ++y) {
+        float r = rFromCoord(model.params, (float)y / (TRANSMITTANCE_R_SIZE - 1));
+        for (int x = 0; x < TRANSMITTANCE_MU_SIZE; ++x) {
+            float mu = muFromCoord((float)x / (TRANSMITTANCE_MU_SIZE - 1));
+            computeTransmittance(model.params, r, mu, &model.transmittance[((size_t)y * TRANSMITTANCE_MU_SIZE + x) * 3]);
+        }
+    }
+}
+
+static void scatteringRows(void* data, int begin, int end) {
+    AtmosphereModel& model = *(AtmosphereModel*)data;
+    for (int row = begin; row < end; ++row) { // One (r, mu) pair per row
+        float r = rFromCoord(model.params, (float)(row / SCATTERING_MU_SIZE) / (SCATTERING_R_SIZE - 1));
+        float mu = muFromCoord((float)(row % SCATTERING_MU_SIZE) / (SCATTERING_MU_SIZE - 1));
+        float* out = &model.scattering[(size_t)row * SCATTERING_NU_SIZE * SCATTERING_MU_S_SIZE * 4];
+        for (int n = 0; n < SCATTERING_NU_SIZE; ++n) {
+            float nu = 2.0f * n / (SCATTERING_NU_SIZE - 1) - 1.0f;
+            for (int m = 0; m < SCATTERING_MU_S_SIZE; ++m) {
+                float muS = 2.0f * m / (SCATTERING_MU_S_SIZE - 1) - 1.0f;
+                computeScattering(model, r, mu, muS, nu, out);
+                out += 4;
+            }
+        }
+    }
+}
+
+static void computeTables(AtmosphereModel& model) {
+    model.transmittance.assign((size_t)TRANSMITTANCE_MU_SIZE * TRANSMITTANCE_R_SIZE * 3, 0.0f);
+    model.scattering.assign((size_t)SCATTERING_R_SIZE * SCATTERING_MU_SIZE * SCATTERING_NU_SIZE * SCATTERING_MU_S_SIZE * 4, 0.0f);
+
+    // Scattering reads the finished transmittance table
+    JobCounter transmittanceDone;
+    parallelFor(TRANSMITTANCE_R_SIZE, 1, transmittanceRows, &model, &transmittanceDone);
+    waitForCounter(&transmittanceDone);
+
+    JobCounter scatteringDone;
+    parallelFor(SCATTERING_R_SIZE * SCATTERING_MU_SIZE, 4, scatteringRows, &model, &scatteringDone);
+    waitForCounter(&scatteringDone);
+}
+
+static AtmosphereCacheHeader cacheHeader(const AtmosphereParams& params) {
+    AtmosphereCacheHeader header = {};
+    memcpy(header.magic, "ATMO", 4);
+    header.version = ATMOSPHERE_CACHE_VERSION;
+    const int sizes[6] = { TRANSMITTANCE_MU_SIZE, TRANSMITTANCE_R_SIZE, SCATTERING_R_SIZE,
+        SCATTERING_MU_SIZE, SCATTERING_NU_SIZE, SCATTERING_MU_S_SIZE };
+    memcpy(header.sizes, sizes, sizeof(sizes));
+    header.params = params;
+    return header;
+}
+
+// Tables from the cache file, if it was written for these parameters
+static bool readCache(const std::string& path, AtmosphereModel& model) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    AtmosphereCacheHeader expected = cacheHeader(model.params), header;
+    model.transmittance.resize((size_t)TRANSMITTANCE_MU_SIZE * TRANSMITTANCE_R_SIZE * 3);
+    model.scattering.resize((size_t)SCATTERING_R_SIZE * SCATTERING_MU_SIZE * SCATTERING_NU_SIZE * SCATTERING_MU_S_SIZE * 4);
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(&header, &expected, sizeof(header)) == 0 &&
+        fread(model.transmittance.data(), sizeof(float), model.transmittance.size(), file) == model.transmittance.size() &&
+        fread(model.scattering.data(), sizeof(float), model.scattering.size(), file) == model.scattering.size();
+    fclose(file);
+    return ok;
+}
+
+static void writeCache(const std::string& path, const AtmosphereModel& model) {
+#ifdef _WIN32
+    _mkdir(ATMOSPHERE_CACHE_DIR);
+#else
+    mkdir(ATMOSPHERE_CACHE_DIR, 0755);
+#endif
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Failed to write atmosphere cache: " << path << std::endl;
+        return;
+    }
+    AtmosphereCacheHeader header = cacheHeader(model.params);
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(model.transmittance.data(), sizeof(float), model.transmittance.size(), file) == model.transmittance.size() &&
+        fwrite(model.scattering.data(), sizeof(float), model.scattering.size(), file) == model.scattering.size();
+    fclose(file);
+    if (!ok) {
+        std::cerr << "Failed to write atmosphere cache: " << path << std::endl;
+        remove(path.c_str());
+    }
+}
+
+AtmosphereModel* loadAtmosphere(const char* name) {
+    std::string key = name ? name : "default";
+    auto found = atmosphereModels.find(key);
+    if (found != atmosphereModels.end()) return found->second;
+
+    AtmosphereModel* model = new AtmosphereModel();
+    model->params = atmospherePreset(name);
+    atmosphereModels[key] = model;
+
+    std::string file = key;
+    for (char& c : file) {
+        if (!isalnum((unsigned char)c)) c = '_';
+    }
+    std::string path = std::string(ATMOSPHERE_CACHE_DIR) + "/atmosphere_" + file + ".lut";
+    if (readCache(path, *model)) return model;
+
+    auto start = std::chrono::steady_clock::now();
+    computeTables(*model);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Computed atmosphere tables for " << key << " in " << (int)ms << " ms" << std::endl;
+    writeCache(path, *model);
+    return model;
+}
+
+static const char* atmosphereVertexShader =
+    "#version 120\n"
+    "varying vec3 eyePos;\n"
+    "void main() {\n"
+    "    eyePos = vec3(gl_ModelViewMatrix * gl_Vertex);\n"
+    "    gl_Position = ftransform();\n"
+    "}\n";
+
+// Table sizes are prepended as #defines
+static const char* atmosphereFragmentShader =
+    "uniform sampler2D transmittanceTable;\n"
+    "uniform sampler3D scatteringTable;\n"
+    "uniform vec3 planetCenter;\n"
+    "uniform float planetRadius;\n"
+    "uniform vec3 sunDir;\n"
+    "uniform float height;\n"
+    "uniform float mieG;\n"
+    "uniform float sunIntensity;\n"
+    "varying vec3 eyePos;\n"
+    "float rCoord(float r) { return sqrt(clamp((r - 1.0) / height, 0.0, 1.0)); }\n"
+    "float muCoord(float mu) { return 0.5 + 0.5 * sign(mu) * sqrt(min(abs(mu), 1.0)); }\n"
+    "float cosineCoord(float c) { return clamp(0.5 * (c + 1.0), 0.0, 1.0); }\n"
+    "float texel(float u, float n) { return (0.5 + u * (n - 1.0)) / n; }\n"
+    "vec3 transmittance(float r, float mu) {\n"
+    "    return texture2D(transmittanceTable, vec2(texel(muCoord(mu), TRANSMITTANCE_MU_SIZE), texel(rCoord(r), TRANSMITTANCE_R_SIZE))).rgb;\n"
+    "}\n"
+    // nu and mu_s share the 3D texture's x axis: NU_SIZE blocks of MU_S_SIZE
+    // texels. mu_s is filtered by the hardware, nu between two fetches.
+    "vec4 scattering(float r, float mu, float muS, float nu) {\n"
+    "    float n = cosineCoord(nu) * (NU_SIZE - 1.0);\n"
+    "    float n0 = min(floor(n), NU_SIZE - 2.0);\n"
+    "    float s = texel(cosineCoord(muS), MU_S_SIZE);\n"
+    "    vec2 yz = vec2(texel(muCoord(mu), MU_SIZE), texel(rCoord(r), R_SIZE));\n"
+    "    vec4 a = texture3D(scatteringTable, vec3((n0 + s) / NU_SIZE, yz));\n"
+    "    vec4 b = texture3D(scatteringTable, vec3((n0 + 1.0 + s) / NU_SIZE, yz));\n"
+    "    return mix(a, b, n - n0);\n"
+    "}\n"
+    "void main() {\n"
+    // Camera and ray relative to the planet, in planet radii
+    "    vec3 v = normalize(eyePos);\n"
+    "    vec3 x = -planetCenter / planetRadius;\n"
+    "    float top = 1.0 + height;\n"
+    "    float rmu = dot(x, v);\n"
+    "    float disc = rmu * rmu - dot(x, x) + top * top;\n"
+    "    if (disc <= 0.0 || -rmu + sqrt(disc) <= 0.0) discard;\n"
+    "    x += v * max(-rmu - sqrt(disc), 0.0);\n"
+    "    float r = min(length(x), top);\n"
+    "    float mu = dot(x, v) / r;\n"
+    "    float muS = dot(x, sunDir) / r;\n"
+    "    float nu = dot(v, sunDir);\n"
+    "    vec4 scattered = scattering(r, mu, muS, nu);\n"
+    "    float g2 = mieG * mieG;\n"
+    "    float phaseR = 0.0596831 * (1.0 + nu * nu);\n"
+    "    float phaseM = 0.1193662 * (1.0 - g2) * (1.0 + nu * nu) / ((2.0 + g2) * pow(1.0 + g2 - 2.0 * mieG * nu, 1.5));\n"
+    "    vec3 light = sunIntensity * (scattered.rgb * phaseR + scattered.a * phaseM);\n"
+    // What is behind is seen through the rest of the ray: to the ground,
+    // or out through the top
+    "    float groundDisc = r * r * (mu * mu - 1.0) + 1.0;\n"
+    "    vec3 through;\n"
+    "    if (mu < 0.0 && groundDisc >= 0.0) {\n"
+    "        float muGround = -sqrt(groundDisc);\n"
+    "        through = min(transmittance(1.0, -muGround) / max(transmittance(r, -mu), vec3(1e-4)), vec3(1.0));\n"
+    "    }\n"
+    "    else {\n"
+    "        through = transmittance(r, mu);\n"
+    "    }\n"
+    "    gl_FragColor = vec4(light, dot(through, vec3(1.0 / 3.0)));\n"
+    "}\n";
+
+bool initAtmosphereRendering() {
+    if (!GLEW_ARB_texture_float) {
+        std::cerr << "Float textures are not supported; atmospheres disabled" << std::endl;
+        return false;
+    }
+
+    std::string fragment = "#version 120\n";
+    const char* names[6] = { "TRANSMITTANCE_MU_SIZE", "TRANSMITTANCE_R_SIZE", "R_SIZE", "MU_SIZE", "NU_SIZE", "MU_S_SIZE" };
+    const int sizes[6] = { TRANSMITTANCE_MU_SIZE, TRANSMITTANCE_R_SIZE, SCATTERING_R_SIZE,
+        SCATTERING_MU_SIZE, SCATTERING_NU_SIZE, SCATTERING_MU_S_SIZE };
+    for (int i = 0; i < 6; ++i) fragment += "#define " + std::string(names[i]) + " " + std::to_string(sizes[i]) + ".0\n";
+    fragment += atmosphereFragmentShader;
+
+    atmosphereProgram = compileShaderProgram(atmosphereVertexShader, fragment.c_str());
+    if (!atmosphereProgram) return false;
+    planetCenterLoc = glGetUniformLocation(atmosphereProgram, "planetCenter");
+    planetRadiusLoc = glGetUniformLocation(atmosphereProgram, "planetRadius");
+    sunDirLoc = glGetUniformLocation(atmosphereProgram, "sunDir");
+    heightLoc = glGetUniformLocation(atmosphereProgram, "height");
+    mieGLoc = glGetUniformLocation(atmosphereProgram, "mieG");
+    sunIntensityLoc = glGetUniformLocation(atmosphereProgram, "sunIntensity");
+    glUseProgram(atmosphereProgram);
+    glUniform1i(glGetUniformLocation(atmosphereProgram, "transmittanceTable"), 0);
+    glUniform1i(glGetUniformLocation(atmosphereProgram, "scatteringTable"), 1);
+    glUseProgram(0);
+
+    shellQuadric = gluNewQuadric();
+    return true;
+}
+
+static void setTableFilters(GLenum target) {
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+}
+
+static void uploadTables(AtmosphereModel* model) {
+    glGenTextures(1, &model->transmittanceTexture);
+    glBindTexture(GL_TEXTURE_2D, model->transmittanceTexture);
+    setTableFilters(GL_TEXTURE_2D);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F_ARB, TRANSMITTANCE_MU_SIZE, TRANSMITTANCE_R_SIZE, 0,
+        GL_RGB, GL_FLOAT, model->transmittance.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenTextures(1, &model->scatteringTexture);
+    glBindTexture(GL_TEXTURE_3D, model->scatteringTexture);
+    setTableFilters(GL_TEXTURE_3D);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F_ARB, SCATTERING_NU_SIZE * SCATTERING_MU_S_SIZE, SCATTERING_MU_SIZE,
+        SCATTERING_R_SIZE, 0, GL_RGBA, GL_FLOAT, model->scattering.data());
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+void drawAtmosphere(AtmosphereModel* model, float radius, const float* sunEye) {
+    if (!atmosphereProgram || !model) return;
+    if (!model->transmittanceTexture) uploadTables(model);
+
+    // The planet sits at the origin of the current modelview
+    float modelview[16];
+    glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+    const float* center = &modelview[12];
+    float sunDir[3] = { sunEye[0] - center[0], sunEye[1] - center[1], sunEye[2] - center[2] };
+    float length = sqrtf(sunDir[0] * sunDir[0] + sunDir[1] * sunDir[1] + sunDir[2] * sunDir[2]);
+    for (int i = 0; i < 3; ++i) sunDir[i] /= length;
+
+    // The fragment shader intersects the true sphere, so the shell mesh is
+    // made just large enough to cover it. Only one side of it is drawn,
+    // so every pixel is shaded once.
+    float top = radius * (1.0f + model->params.height);
+    float distance = sqrtf(center[0] * center[0] + center[1] * center[1] + center[2] * center[2]);
+
+    glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_POLYGON_BIT | GL_TEXTURE_BIT);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_CULL_FACE);
+    glCullFace(distance > top ? GL_BACK : GL_FRONT);
+
+    glUseProgram(atmosphereProgram);
+    glUniform3f(planetCenterLoc, center[0], center[1], center[2]);
+    glUniform1f(planetRadiusLoc, radius);
+    glUniform3f(sunDirLoc, sunDir[0], sunDir[1], sunDir[2]);
+    glUniform1f(heightLoc, model->params.height);
+    glUniform1f(mieGLoc, model->params.mieG);
+    glUniform1f(sunIntensityLoc, model->params.sunIntensity);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, model->transmittanceTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_3D, model->scatteringTexture);
+
+    gluSphere(shellQuadric, top / cosf(PI / ATMOSPHERE_SLICES), ATMOSPHERE_SLICES, ATMOSPHERE_SLICES / 2);
+    perfCount(PERF_TEXTURE_BINDS, 2);
+    perfCount(PERF_DRAW_CALLS, ATMOSPHERE_SLICES / 2); // One strip per stack
+    perfCount(PERF_TRIANGLES, ATMOSPHERE_SLICES * ATMOSPHERE_SLICES);
+
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+    glPopAttrib();
+}
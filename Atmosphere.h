@@ -0,0 +1,67 @@
+// Atmosphere.h
+#pragma once
+#include <GL/glew.h>
+#include <vector>
+
+// Precomputed atmospheric scattering after Bruneton and Neyret (2008),
+// single scattering only. Per planet there are two tables:
+//   transmittance T(r, mu): light reaching the top of the atmosphere from
+//     radius r along a ray with zenith cosine mu (RGB)
+//   scattering S(r, mu, mu_s, nu): light scattered toward the viewer along
+//     that ray up to the ground or the top, for a sun at zenith cosine mu_s
+//     and view-sun cosine nu (Rayleigh RGB, Mie in alpha), phase not applied
+// Distances are in planet radii, so a table does not depend on the planet's
+// size. Tables are computed on the job system and cached in
+// ATMOSPHERE_CACHE_DIR; a cached file is reused only if its parameters
+// match exactly.
+const int TRANSMITTANCE_MU_SIZE = 128;
+const int TRANSMITTANCE_R_SIZE = 32;
+const int SCATTERING_R_SIZE = 16;
+const int SCATTERING_MU_SIZE = 64;
+const int SCATTERING_MU_S_SIZE = 32;
+const int SCATTERING_NU_SIZE = 8;
+const char* const ATMOSPHERE_CACHE_DIR = "cache";
+
+struct AtmosphereParams {
+    float height = 0.08f;         // Thickness as a fraction of the planet radius (exaggerated to be visible)
+    float rayleighScale = 0.133f; // Rayleigh scale height as a fraction of the thickness
+    float mieScale = 0.02f;       // Mie scale height as a fraction of the thickness
+    float rayleighDepth[3] = { 0.046f, 0.108f, 0.265f }; // Zenith optical depth per channel
+    float mieDepth = 0.025f;      // Zenith optical depth of aerosols
+    float mieG = 0.76f;           // Mie phase asymmetry
+    float sunIntensity = 12.0f;   // Scale on the scattered light
+};
+
+struct AtmosphereModel {
+    AtmosphereParams params;
+    std::vector<float> transmittance; // RGB, mu fastest, then r
+    std::vector<float> scattering;    // RGBA, mu_s fastest, then nu, mu, r
+    GLuint transmittanceTexture = 0;
+    GLuint scatteringTexture = 0;     // 3D: (nu, mu_s) x mu x r
+};
+
+// Parameters for a planet by name; unknown names get Earth's
+AtmosphereParams atmospherePreset(const char* name);
+
+// Tables for a planet, from the cache or computed (and cached) if the
+// parameters changed. Models live until exit; the same name returns the
+// same model.
+AtmosphereModel* loadAtmosphere(const char* name);
+
+// CPU lookups for the ray tracer. Positions and directions are relative to
+// the planet center, in planet radii.
+void atmosphereTransmittance(const AtmosphereModel& model, float r, float mu, float* rgb);
+
+// Light scattered toward a viewer at x looking along v (unit), up to the
+// ground or the top of the atmosphere, with the sun along s (unit), and
+// the transmittance of that path for whatever lies at its end
+void atmosphereInscatter(const AtmosphereModel& model, const float* x, const float* v, const float* s, float* rgb, float* through);
+
+// Compile the shell shader; false if the driver lacks GLSL or float textures
+bool initAtmosphereRendering();
+
+// Draw the atmosphere shell of a planet of the given radius centered at the
+// current modelview origin; the tables are uploaded on first use. The sun
+// position is in eye space. Adds the in-scattered light to what is behind
+// and dims that by the (grey) transmittance.
+void drawAtmosphere(AtmosphereModel* model, float radius, const float* sunEye);
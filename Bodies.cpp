@@ -0,0 +1,224 @@
+// Bodies.cpp
+#include "Bodies.h"
+#include "MappedFile.h"
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BODIES_SSE2 1
+#endif
+
+BodyTable bodies;
+
+static MappedFile sceneFile;
+
+static const double identityFrame[16] = {
+    1.0, 0.0, 0.0, 0.0,
+    0.0, 1.0, 0.0, 0.0,
+    0.0, 0.0, 1.0, 0.0,
+    0.0, 0.0, 0.0, 1.0
+};
+
+// Check the header against the file size, then every per-body value that is
+// used as an index: a scene can come from any file given to --scene
+static bool validScene(const SceneHeader& header, const unsigned char* data, size_t size) {
+    if (memcmp(header.magic, SCENE_MAGIC, 4) != 0 || header.version != SCENE_VERSION) return false;
+    if (header.levelCount > (uint32_t)SCENE_MAX_LEVELS || header.frameCount > header.bodyCount) return false;
+    if (header.bodyCount == 0 || header.levelStart[0] != 0 || header.levelStart[header.levelCount] != header.bodyCount) return false;
+    for (uint32_t l = 0; l < header.levelCount; ++l) {
+        if (header.levelStart[l] > header.levelStart[l + 1]) return false;
+    }
+
+    // Compare against what is left of the file, so no sum can overflow
+    uint64_t columnBytes = (uint64_t)header.bodyCount * 4;
+    for (int c = 0; c < SCENE_COLUMN_COUNT; ++c) {
+        uint64_t offset = header.columnOffset[c];
+        if (offset % 16 != 0 || offset < sizeof(header) || offset > size || columnBytes > size - offset) return false;
+    }
+    if (header.stringOffset > size || header.stringSize > size - header.stringOffset) return false;
+    const char* strings = (const char*)(data + header.stringOffset);
+    if (header.stringSize > 0 && strings[header.stringSize - 1] != '\0') return false;
+
+    const int32_t* parent = (const int32_t*)(data + header.columnOffset[SCENE_PARENT]);
+    const int32_t* name = (const int32_t*)(data + header.columnOffset[SCENE_NAME]);
+    const int32_t* texture = (const int32_t*)(data + header.columnOffset[SCENE_TEXTURE]);
+    const int32_t* frameSlot = (const int32_t*)(data + header.columnOffset[SCENE_FRAME_SLOT]);
+    int64_t stringSize = (int64_t)header.stringSize;
+    for (uint32_t l = 0; l < header.levelCount; ++l) {
+        int64_t levelBegin = header.levelStart[l];
+        for (uint32_t b = header.levelStart[l]; b < header.levelStart[l + 1]; ++b) {
+            // Parents come from an earlier level; one that is not a root
+            // passes its frame on, so it must have one
+            int32_t p = parent[b];
+            if (p < -1 || p >= levelBegin) return false;
+            if (p >= 0 && parent[p] >= 0 && frameSlot[p] < 0) return false;
+            if (name[b] < -1 || name[b] >= stringSize) return false;
+            if (texture[b] < -1 || texture[b] >= stringSize) return false;
+            // Textured bodies are drawn in their frame
+            if (frameSlot[b] < -1 || frameSlot[b] >= (int64_t)header.frameCount) return false;
+            if (texture[b] >= 0 && frameSlot[b] < 0) return false;
+        }
+    }
+    return true;
+}
+
+bool loadScene(const char* path) {
+    unloadScene();
+
+    MappedFile file;
+    if (!mapFile(path, file)) return false;
+
+    SceneHeader header;
+    if (file.size < sizeof(header)) {
+        std::cerr << "Scene file is truncated: " << path << std::endl;
+        unmapFile(file);
+        return false;
+    }
+    memcpy(&header, file.data, sizeof(header));
+    if (!validScene(header, file.data, file.size)) {
+        std::cerr << "Not a valid scene file: " << path << std::endl;
+        unmapFile(file);
+        return false;
+    }
+
+    // Point the static columns into the mapping; nothing is parsed or copied
+    const unsigned char* base = file.data;
+    bodies.kind = (const int32_t*)(base + header.columnOffset[SCENE_KIND]);
+    bodies.parent = (const int32_t*)(base + header.columnOffset[SCENE_PARENT]);
+    bodies.flags = (const int32_t*)(base + header.columnOffset[SCENE_FLAGS]);
+    bodies.name = (const int32_t*)(base + header.columnOffset[SCENE_NAME]);
+    bodies.texture = (const int32_t*)(base + header.columnOffset[SCENE_TEXTURE]);
+    bodies.frameSlot = (const int32_t*)(base + header.columnOffset[SCENE_FRAME_SLOT]);
+    bodies.radius = (const float*)(base + header.columnOffset[SCENE_RADIUS]);
+    bodies.distance = (const float*)(base + header.columnOffset[SCENE_DISTANCE]);
+    bodies.inclination = (const float*)(base + header.columnOffset[SCENE_INCLINATION]);
+    bodies.phase = (const float*)(base + header.columnOffset[SCENE_PHASE]);
+    bodies.orbitRate = (const float*)(base + header.columnOffset[SCENE_ORBIT_RATE]);
+    bodies.spinRate = (const float*)(base + header.columnOffset[SCENE_SPIN_RATE]);
+    bodies.strings = (const char*)(base + header.stringOffset);
+
+    bodies.bodyCount = (int)header.bodyCount;
+    bodies.levelCount = (int)header.levelCount;
+    for (uint32_t l = 0; l <= header.levelCount; ++l) {
+        bodies.levelStart[l] = (int)header.levelStart[l];
+    }
+
+    // Only the per-tick state is allocated, one block per column
+    bodies.worldX.assign(header.bodyCount, 0.0);
+    bodies.worldY.assign(header.bodyCount, 0.0);
+    bodies.worldZ.assign(header.bodyCount, 0.0);
+    bodies.worldFrames.assign((size_t)header.frameCount * 16, 0.0);
+    bodies.posX.assign(header.bodyCount, 0.0f);
+    bodies.posY.assign(header.bodyCount, 0.0f);
+    bodies.posZ.assign(header.bodyCount, 0.0f);
+    bodies.relX.assign(header.bodyCount, 0.0f);
+    bodies.relY.assign(header.bodyCount, 0.0f);
+    bodies.relZ.assign(header.bodyCount, 0.0f);
+    bodies.frames.assign((size_t)header.frameCount * 16, 0.0f);
+
+    sceneFile = file;
+    return true;
+}
+
+void unloadScene() {
+    unmapFile(sceneFile);
+    bodies = BodyTable();
+}
+
+void updateBodies(double time, int begin, int end) {
+    const double degToRad = 3.14159265358979 / 180.0;
+
+    for (int b = begin; b < end; ++b) {
+        int p = bodies.parent[b];
+
+        // Keep the angles small before taking sines
+        double orbit = fmod(bodies.phase[b] + bodies.orbitRate[b] * time, 360.0) * degToRad;
+        double spin = fmod(bodies.spinRate[b] * time, 360.0) * degToRad;
+        double inc = bodies.inclination[b] * degToRad;
+        double ci = cos(inc), si = sin(inc);
+        double co = cos(orbit), so = sin(orbit);
+        double d = bodies.distance[b];
+
+        // Rz(inclination) * Ry(orbit) * (d, 0, 0)
+        double lx = ci * co * d, ly = si * co * d, lz = -so * d;
+
+        // Roots keep their spin to themselves
+        const double* pf = (p >= 0 && bodies.parent[p] >= 0) ? bodies.worldFrame(p) : identityFrame;
+        double px = p >= 0 ? bodies.worldX[p] : 0.0;
+        double py = p >= 0 ? bodies.worldY[p] : 0.0;
+        double pz = p >= 0 ? bodies.worldZ[p] : 0.0;
+
+        double x = px + pf[0] * lx + pf[4] * ly + pf[8] * lz;
+        double y = py + pf[1] * lx + pf[5] * ly + pf[9] * lz;
+        double z = pz + pf[2] * lx + pf[6] * ly + pf[10] * lz;
+        bodies.worldX[b] = x;
+        bodies.worldY[b] = y;
+        bodies.worldZ[b] = z;
+        bodies.posX[b] = (float)x;
+        bodies.posY[b] = (float)y;
+        bodies.posZ[b] = (float)z;
+
+        if (bodies.frameSlot[b] < 0) continue;
+
+        // Rotation: parent * Rz(inclination) * Ry(orbit + spin)
+        double ca = cos(orbit + spin), sa = sin(orbit + spin);
+        double local[9] = {            // Column-major 3x3
+            ci * ca, si * ca, -sa,
+            -si, ci, 0.0,
+            ci * sa, si * sa, ca
+        };
+        double* f = bodies.worldFrames.data() + 16 * bodies.frameSlot[b];
+        for (int c = 0; c < 3; ++c) {
+            for (int r = 0; r < 3; ++r) {
+                f[4 * c + r] = pf[r] * local[3 * c] + pf[4 + r] * local[3 * c + 1] + pf[8 + r] * local[3 * c + 2];
+            }
+            f[4 * c + 3] = 0.0;
+        }
+        f[12] = x;
+        f[13] = y;
+        f[14] = z;
+        f[15] = 1.0;
+    }
+}
+
+// dst[i] = float(src[i] - origin), two doubles per SSE2 instruction
+static void rebaseColumn(const double* src, float* dst, double origin, int count) {
+    int i = 0;
+#ifdef BODIES_SSE2
+    __m128d o = _mm_set1_pd(origin);
+    for (; i + 4 <= count; i += 4) {
+        __m128 low = _mm_cvtpd_ps(_mm_sub_pd(_mm_loadu_pd(src + i), o));
+        __m128 high = _mm_cvtpd_ps(_mm_sub_pd(_mm_loadu_pd(src + i + 2), o));
+        _mm_storeu_ps(dst + i, _mm_movelh_ps(low, high));
+    }
+#endif
+    for (; i < count; ++i) dst[i] = (float)(src[i] - origin);
+}
+
+void setBodyOrigin(double x, double y, double z) {
+    bodies.origin[0] = x;
+    bodies.origin[1] = y;
+    bodies.origin[2] = z;
+}
+
+void rebaseBodies(int begin, int end) {
+    const double x = bodies.origin[0], y = bodies.origin[1], z = bodies.origin[2];
+    rebaseColumn(bodies.worldX.data() + begin, bodies.relX.data() + begin, x, end - begin);
+    rebaseColumn(bodies.worldY.data() + begin, bodies.relY.data() + begin, y, end - begin);
+    rebaseColumn(bodies.worldZ.data() + begin, bodies.relZ.data() + begin, z, end - begin);
+
+    // Frames: the rotation converts as is, the translation is rebased
+    const double zero[4] = { 0.0, 0.0, 0.0, 0.0 };
+    const double translation[4] = { x, y, z, 0.0 };
+    for (int b = begin; b < end; ++b) {
+        if (bodies.frameSlot[b] < 0) continue;
+        const double* src = bodies.worldFrame(b);
+        float* dst = bodies.frames.data() + 16 * bodies.frameSlot[b];
+        for (int c = 0; c < 4; ++c) {
+            const double* offset = c == 3 ? translation : zero;
+            for (int r = 0; r < 4; ++r) dst[4 * c + r] = (float)(src[4 * c + r] - offset[r]);
+        }
+    }
+}
@@ -0,0 +1,99 @@
+// Bodies.h
+#pragma once
+#include "SceneFormat.h"
+#include <vector>
+
+// Kinds of bodies stored in the body table
+enum BodyKind {
+    BODY_STAR,
+    BODY_PLANET,
+    BODY_MOON,
+    BODY_ASTEROID
+};
+
+// Per-body options from the scene file
+enum BodyFlags {
+    BODY_FLAG_TRAIL = 1 << 0, // Record an orbit trail
+    BODY_FLAG_ORBIT = 1 << 1, // Draw the orbit path
+    BODY_FLAG_RINGS = 1 << 2, // Draw a ring system
+    BODY_FLAG_LABEL = 1 << 3, // Label in the HUD
+    BODY_FLAG_ATMOSPHERE = 1 << 4 // Has an atmosphere (scattering shell in GL, ray-traced renders)
+};
+
+// Structure-of-arrays table with one entry per simulated body.
+//
+// The static columns point straight into the memory-mapped scene file.
+// The simulation state is kept in doubles in world space and rewritten on
+// every update() tick, along with a float copy of the positions for picking,
+// trails and checkpoints. A body's frame places it like the GL matrix stack
+// would:
+//     parent frame * Rz(inclination) * Ry(orbit angle) * T(distance) * Ry(spin angle)
+// Root bodies sit at the origin and do not pass their spin on.
+//
+// Drawing uses floats relative to a floating origin near the camera,
+// produced by rebaseBodies() each frame, so float precision is spent where
+// the camera is and distances can be true to scale.
+struct BodyTable {
+    std::vector<double> worldX;
+    std::vector<double> worldY;
+    std::vector<double> worldZ;
+    std::vector<double> worldFrames; // 16 doubles (column-major) per frame slot
+
+    std::vector<float> posX;   // World positions rounded to float
+    std::vector<float> posY;
+    std::vector<float> posZ;
+
+    double origin[3] = { 0.0, 0.0, 0.0 }; // Floating origin of the last rebase
+    std::vector<float> relX;   // Positions relative to the origin
+    std::vector<float> relY;
+    std::vector<float> relZ;
+    std::vector<float> frames; // Frames relative to the origin, 16 floats per frame slot
+
+    int bodyCount = 0;
+    const int32_t* kind = nullptr;
+    const int32_t* parent = nullptr;
+    const int32_t* flags = nullptr;
+    const int32_t* name = nullptr;
+    const int32_t* texture = nullptr;
+    const int32_t* frameSlot = nullptr;
+    const float* radius = nullptr;
+    const float* distance = nullptr;
+    const float* inclination = nullptr;
+    const float* phase = nullptr;
+    const float* orbitRate = nullptr;
+    const float* spinRate = nullptr;
+    const char* strings = nullptr;
+
+    int levelCount = 0;
+    int levelStart[SCENE_MAX_LEVELS + 1] = {};
+
+    int count() const { return bodyCount; }
+
+    // String table entry, or null for -1
+    const char* string(int32_t offset) const { return offset >= 0 ? strings + offset : nullptr; }
+
+    // Origin-relative frame of a body with a frame slot
+    const float* frame(int b) const { return frames.data() + 16 * frameSlot[b]; }
+
+    // World frame of a body with a frame slot
+    const double* worldFrame(int b) const { return worldFrames.data() + 16 * frameSlot[b]; }
+};
+
+extern BodyTable bodies;
+
+// Map a binary scene and point the body table at it; prints an error and
+// returns false on failure
+bool loadScene(const char* path);
+
+// Release the mapped scene and empty the table
+void unloadScene();
+
+// Compute positions and frames of bodies [begin, end) at the given simulation
+// time. Parents must already be up to date, so call this level by level.
+void updateBodies(double time, int begin, int end);
+
+// Move the floating origin; call rebaseBodies() for every body afterwards
+void setBodyOrigin(double x, double y, double z);
+
+// Convert bodies [begin, end) to floats relative to the floating origin
+void rebaseBodies(int begin, int end);
@@ -0,0 +1,212 @@
+// Bvh.cpp
+#include "Bvh.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Nodes are stored depth-first, so a node's left child is the next node and
+// every child has a larger index than its parent
+struct BvhNode {
+    float bmin[3];
+    float bmax[3];
+    int start; // Leaf: first entry in bvhItems
+    int count; // Leaf: number of bodies; 0 for internal nodes
+    int right; // Internal: index of the right child
+};
+
+static std::vector<BvhNode> bvhNodes;
+static std::vector<int> bvhItems;   // Body indices, grouped by leaf
+static float builtLeafArea = 0.0f;  // Total leaf surface area right after building
+
+static float pickRadius(const BodyTable& table, int b) {
+    return std::max(table.radius[b], BVH_MIN_PICK_RADIUS);
+}
+
+static float surfaceArea(const BvhNode& n) {
+    float dx = n.bmax[0] - n.bmin[0], dy = n.bmax[1] - n.bmin[1], dz = n.bmax[2] - n.bmin[2];
+    return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+// Bounds of a leaf's bodies
+static void fitLeaf(const BodyTable& table, BvhNode& n) {
+    for (int k = 0; k < 3; ++k) {
+        n.bmin[k] = INFINITY;
+        n.bmax[k] = -INFINITY;
+    }
+    for (int i = n.start; i < n.start + n.count; ++i) {
+        int b = bvhItems[i];
+        float r = pickRadius(table, b);
+        float p[3] = { table.posX[b], table.posY[b], table.posZ[b] };
+        for (int k = 0; k < 3; ++k) {
+            n.bmin[k] = std::min(n.bmin[k], p[k] - r);
+            n.bmax[k] = std::max(n.bmax[k], p[k] + r);
+        }
+    }
+}
+
+// Bounds of an internal node from its two children
+static void fitInternal(int index) {
+    BvhNode& n = bvhNodes[index];
+    const BvhNode& a = bvhNodes[index + 1];
+    const BvhNode& b = bvhNodes[n.right];
+    for (int k = 0; k < 3; ++k) {
+        n.bmin[k] = std::min(a.bmin[k], b.bmin[k]);
+        n.bmax[k] = std::max(a.bmax[k], b.bmax[k]);
+    }
+}
+
+// Split items [start, end) at the median centroid along the widest axis
+static int buildNode(const BodyTable& table, int start, int end) {
+    int index = (int)bvhNodes.size();
+    bvhNodes.push_back(BvhNode());
+
+    if (end - start <= BVH_LEAF_SIZE) {
+        BvhNode& leaf = bvhNodes[index];
+        leaf.start = start;
+        leaf.count = end - start;
+        leaf.right = -1;
+        fitLeaf(table, leaf);
+        builtLeafArea += surfaceArea(leaf);
+        return index;
+    }
+
+    float cmin[3] = { INFINITY, INFINITY, INFINITY }, cmax[3] = { -INFINITY, -INFINITY, -INFINITY };
+    for (int i = start; i < end; ++i) {
+        int b = bvhItems[i];
+        float p[3] = { table.posX[b], table.posY[b], table.posZ[b] };
+        for (int k = 0; k < 3; ++k) {
+            cmin[k] = std::min(cmin[k], p[k]);
+            cmax[k] = std::max(cmax[k], p[k]);
+        }
+    }
+    int axis = 0;
+    for (int k = 1; k < 3; ++k) {
+        if (cmax[k] - cmin[k] > cmax[axis] - cmin[axis]) axis = k;
+    }
+    const float* coord = axis == 0 ? table.posX.data() : axis == 1 ? table.posY.data() : table.posZ.data();
+
+    int mid = (start + end) / 2;
+    std::nth_element(bvhItems.begin() + start, bvhItems.begin() + mid, bvhItems.begin() + end,
+        [coord](int a, int b) { return coord[a] < coord[b]; });
+
+    buildNode(table, start, mid);
+    int right = buildNode(table, mid, end);
+
+    BvhNode& node = bvhNodes[index];
+    node.start = start;
+    node.count = 0;
+    node.right = right;
+    fitInternal(index);
+    return index;
+}
+
+void buildBvh(const BodyTable& table) {
+    int n = table.count();
+    bvhNodes.clear();
+    bvhNodes.reserve(n > 0 ? 2 * (n / BVH_LEAF_SIZE + 1) : 0);
+    bvhItems.resize(n);
+    for (int i = 0; i < n; ++i) bvhItems[i] = i;
+    builtLeafArea = 0.0f;
+    if (n > 0) buildNode(table, 0, n);
+}
+
+void refitBvh(const BodyTable& table) {
+    if ((int)bvhItems.size() != table.count()) {
+        buildBvh(table);
+        return;
+    }
+
+    float leafArea = 0.0f;
+    for (int i = (int)bvhNodes.size() - 1; i >= 0; --i) {
+        BvhNode& n = bvhNodes[i];
+        if (n.count > 0) {
+            fitLeaf(table, n);
+            leafArea += surfaceArea(n);
+        }
+        else {
+            fitInternal(i);
+        }
+    }
+
+    // Bodies that drift apart make refit boxes overlap; start over when that gets bad
+    if (leafArea > BVH_REBUILD_GROWTH * builtLeafArea) {
+        buildBvh(table);
+    }
+}
+
+// Slab test; returns the entry distance or INFINITY on a miss
+static float rayBox(const BvhNode& n, const float* origin, const float* invDir, float maxT) {
+    float tmin = 0.0f, tmax = maxT;
+    for (int k = 0; k < 3; ++k) {
+        float t0 = (n.bmin[k] - origin[k]) * invDir[k];
+        float t1 = (n.bmax[k] - origin[k]) * invDir[k];
+        if (t0 > t1) std::swap(t0, t1);
+        tmin = std::max(tmin, t0);
+        tmax = std::min(tmax, t1);
+        if (tmin > tmax) return INFINITY;
+    }
+    return tmin;
+}
+
+// Nearest hit against spheres of at least minRadius. The node boxes hold the
+// pick radii, so any smaller minRadius still finds every hit.
+static int nearestBody(const BodyTable& table, const float* origin, const float* dir, float* hitT, float minRadius) {
+    if (bvhNodes.empty()) return -1;
+
+    float len = sqrtf(dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2]);
+    if (len == 0.0f) return -1;
+    float d[3] = { dir[0] / len, dir[1] / len, dir[2] / len };
+    float invDir[3] = { 1.0f / d[0], 1.0f / d[1], 1.0f / d[2] };
+
+    int best = -1;
+    float bestT = INFINITY;
+
+    int stack[64];
+    int top = 0;
+    if (rayBox(bvhNodes[0], origin, invDir, bestT) < INFINITY) stack[top++] = 0;
+
+    while (top > 0) {
+        const BvhNode& n = bvhNodes[stack[--top]];
+        if (n.count > 0) {
+            for (int i = n.start; i < n.start + n.count; ++i) {
+                int b = bvhItems[i];
+                float r = std::max(table.radius[b], minRadius);
+                float oc[3] = { origin[0] - table.posX[b], origin[1] - table.posY[b], origin[2] - table.posZ[b] };
+                float bq = oc[0] * d[0] + oc[1] * d[1] + oc[2] * d[2];
+                float c = oc[0] * oc[0] + oc[1] * oc[1] + oc[2] * oc[2] - r * r;
+                float disc = bq * bq - c;
+                if (disc < 0.0f) continue;
+                float t = -bq - sqrtf(disc);
+                if (t < 0.0f) t = -bq + sqrtf(disc); // Origin inside the sphere
+                if (t >= 0.0f && t < bestT) {
+                    bestT = t;
+                    best = b;
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearer child first so bestT shrinks early
+        int left = (int)(&n - bvhNodes.data()) + 1;
+        int right = n.right;
+        float tl = rayBox(bvhNodes[left], origin, invDir, bestT);
+        float tr = rayBox(bvhNodes[right], origin, invDir, bestT);
+        if (tl > tr) {
+            std::swap(tl, tr);
+            std::swap(left, right);
+        }
+        if (tr < INFINITY && top < 64) stack[top++] = right;
+        if (tl < INFINITY && top < 64) stack[top++] = left;
+    }
+
+    if (hitT) *hitT = bestT / len;
+    return best;
+}
+
+int pickBody(const BodyTable& table, const float* origin, const float* dir, float* hitT) {
+    return nearestBody(table, origin, dir, hitT, BVH_MIN_PICK_RADIUS);
+}
+
+int intersectBodies(const BodyTable& table, const float* origin, const float* dir, float* hitT) {
+    return nearestBody(table, origin, dir, hitT, 0.0f);
+}
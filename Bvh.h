@@ -0,0 +1,24 @@
+// Bvh.h
+#pragma once
+#include "Bodies.h"
+
+// Bounding volume hierarchy over the bounding spheres in the body table,
+// used for ray picking. It is built once and refit bottom-up each tick;
+// a full rebuild only happens when refitting has loosened the boxes too much.
+const int BVH_LEAF_SIZE = 4;
+const float BVH_MIN_PICK_RADIUS = 0.15f; // Small bodies are easier to click
+const float BVH_REBUILD_GROWTH = 2.0f;    // Rebuild when leaf boxes grow this much
+
+// Build the hierarchy for the current contents of the table
+void buildBvh(const BodyTable& table);
+
+// Update node bounds for the table's current positions (same body count)
+void refitBvh(const BodyTable& table);
+
+// Nearest body hit by the ray origin + t * dir (dir need not be normalized).
+// Returns the body index, or -1 if nothing was hit.
+int pickBody(const BodyTable& table, const float* origin, const float* dir, float* hitT);
+
+// Like pickBody() but against each body's true radius, for rendering.
+// Safe to call from several threads at once.
+int intersectBodies(const BodyTable& table, const float* origin, const float* dir, float* hitT);
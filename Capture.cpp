@@ -0,0 +1,245 @@
+// Capture.cpp
+#include "Capture.h"
+#include "Jobs.h"
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#define PIPE_WRITE_MODE "wb"
+#else
+#include <csignal>
+#define PIPE_WRITE_MODE "w"
+#endif
+
+static bool active = false;
+static int captureWidth = 0, captureHeight = 0;
+static GLuint pbos[CAPTURE_PBO_COUNT];
+static int frameIndex = 0; // Frames read back since startCapture()
+
+static FILE* output = nullptr;
+static bool outputIsPipe = false;
+
+// YUV frames move from `freeFrames` to `queuedFrames` (GL thread) and back (writer)
+static std::thread writerThread;
+static std::mutex queueLock;
+static std::condition_variable queueWake;
+static std::condition_variable frameFreed;
+static std::deque<std::vector<unsigned char>> freeFrames, queuedFrames;
+static bool writerStopping = false;
+static int framesWritten = 0;
+static int framesDropped = 0;
+
+// Source pixels and destination planes for the conversion jobs
+struct ConvertJob {
+    const unsigned char* rgba;
+    unsigned char* y;
+    unsigned char* u;
+    unsigned char* v;
+};
+
+// Convert pairs of rows [begin, end) from bottom-up RGBA to top-down BT.601 YUV 4:2:0
+static void convertRows(void* data, int begin, int end) {
+    const ConvertJob* job = (const ConvertJob*)data;
+    const int w = captureWidth, h = captureHeight;
+
+    for (int pair = begin; pair < end; ++pair) {
+        for (int r = 0; r < 2; ++r) {
+            int row = 2 * pair + r;
+            const unsigned char* src = job->rgba + (size_t)(h - 1 - row) * w * 4;
+            unsigned char* dst = job->y + (size_t)row * w;
+            for (int x = 0; x < w; ++x, src += 4) {
+                dst[x] = (unsigned char)((66 * src[0] + 129 * src[1] + 25 * src[2] + 128) / 256 + 16);
+            }
+        }
+
+        // Chroma from the average of each 2x2 block
+        const unsigned char* top = job->rgba + (size_t)(h - 1 - 2 * pair) * w * 4;
+        const unsigned char* bottom = top - (size_t)w * 4;
+        unsigned char* u = job->u + (size_t)pair * (w / 2);
+        unsigned char* v = job->v + (size_t)pair * (w / 2);
+        for (int x = 0; x < w / 2; ++x) {
+            int i = 8 * x;
+            int r = top[i] + top[i + 4] + bottom[i] + bottom[i + 4];
+            int g = top[i + 1] + top[i + 5] + bottom[i + 1] + bottom[i + 5];
+            int b = top[i + 2] + top[i + 6] + bottom[i + 2] + bottom[i + 6];
+            // The +128 bias is folded in first so the shift sees a positive value
+            u[x] = (unsigned char)((-38 * r - 74 * g + 112 * b + (128 << 10) + 512) >> 10);
+            v[x] = (unsigned char)((112 * r - 94 * g - 18 * b + (128 << 10) + 512) >> 10);
+        }
+    }
+}
+
+static void writerLoop() {
+    std::unique_lock<std::mutex> guard(queueLock);
+    while (true) {
+        queueWake.wait(guard, [] { return !queuedFrames.empty() || writerStopping; });
+        if (queuedFrames.empty()) break;
+
+        std::vector<unsigned char> frame = std::move(queuedFrames.front());
+        queuedFrames.pop_front();
+        guard.unlock();
+        bool ok = fwrite(frame.data(), 1, frame.size(), output) == frame.size();
+        guard.lock();
+
+        if (ok) ++framesWritten;
+        else ++framesDropped;
+        freeFrames.push_back(std::move(frame));
+        frameFreed.notify_one();
+    }
+}
+
+// Map the PBO filled CAPTURE_PBO_COUNT frames ago and queue its contents.
+// While recording a frame is dropped rather than waiting for the writer;
+// when draining at the end, `waitForWriter` keeps every frame.
+static void consumeFrame(int slot, bool waitForWriter) {
+    std::vector<unsigned char> frame;
+    {
+        std::unique_lock<std::mutex> guard(queueLock);
+        if (waitForWriter) {
+            frameFreed.wait(guard, [] { return !freeFrames.empty(); });
+        }
+        else if (freeFrames.empty()) {
+            ++framesDropped;
+            return;
+        }
+        frame = std::move(freeFrames.front());
+        freeFrames.pop_front();
+    }
+
+    size_t lumaSize = (size_t)captureWidth * captureHeight;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+    const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+        (GLsizeiptr)lumaSize * 4, GL_MAP_READ_BIT);
+    if (pixels) {
+        ConvertJob job = { pixels, frame.data(), frame.data() + lumaSize, frame.data() + lumaSize + lumaSize / 4 };
+        JobCounter converted;
+        parallelFor(captureHeight / 2, 16, convertRows, &job, &converted);
+        waitForCounter(&converted);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    std::lock_guard<std::mutex> guard(queueLock);
+    if (pixels) queuedFrames.push_back(std::move(frame));
+    else freeFrames.push_back(std::move(frame));
+    queueWake.notify_one();
+}
+
+bool startCapture(const char* path, int width, int height, double frameRate) {
+    if (active) stopCapture();
+    if (!GLEW_ARB_pixel_buffer_object) {
+        std::cerr << "Frame capture needs GL_ARB_pixel_buffer_object" << std::endl;
+        return false;
+    }
+
+    captureWidth = width & ~1;
+    captureHeight = height & ~1;
+    if (captureWidth < 2 || captureHeight < 2) return false;
+
+    std::string name(path);
+    outputIsPipe = name.size() < 4 || name.compare(name.size() - 4, 4, ".yuv") != 0;
+    if (outputIsPipe) {
+        char command[1024];
+        snprintf(command, sizeof(command),
+            "ffmpeg -loglevel error -y -f rawvideo -pix_fmt yuv420p -s %dx%d -r %g -i - "
+            "-c:v libx264 -preset veryfast -pix_fmt yuv420p \"%s\"",
+            captureWidth, captureHeight, frameRate, path);
+#ifndef _WIN32
+        signal(SIGPIPE, SIG_IGN); // A dying encoder should fail writes, not kill us
+#endif
+        output = popen(command, PIPE_WRITE_MODE);
+    }
+    else {
+        output = fopen(path, "wb");
+    }
+    if (!output) {
+        std::cerr << "Failed to open capture output: " << path << std::endl;
+        return false;
+    }
+
+    size_t rgbaSize = (size_t)captureWidth * captureHeight * 4;
+    glGenBuffers(CAPTURE_PBO_COUNT, pbos);
+    for (int i = 0; i < CAPTURE_PBO_COUNT; ++i) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)rgbaSize, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    freeFrames.clear();
+    queuedFrames.clear();
+    for (int i = 0; i < CAPTURE_QUEUE_LENGTH; ++i) {
+        freeFrames.emplace_back(rgbaSize * 3 / 8); // 1.5 bytes per pixel
+    }
+
+    frameIndex = 0;
+    framesWritten = 0;
+    framesDropped = 0;
+    writerStopping = false;
+    writerThread = std::thread(writerLoop);
+    active = true;
+    return true;
+}
+
+void captureFrame() {
+    if (!active) return;
+
+    int slot = frameIndex % CAPTURE_PBO_COUNT;
+    if (frameIndex >= CAPTURE_PBO_COUNT) {
+        consumeFrame(slot, false); // Oldest frame in the ring, about to be overwritten
+    }
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadBuffer(GL_BACK);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+    glReadPixels(0, 0, captureWidth, captureHeight, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    ++frameIndex;
+}
+
+void stopCapture() {
+    if (!active) return;
+
+    // Frames still in the ring, oldest first
+    int first = frameIndex > CAPTURE_PBO_COUNT ? frameIndex - CAPTURE_PBO_COUNT : 0;
+    for (int f = first; f < frameIndex; ++f) {
+        consumeFrame(f % CAPTURE_PBO_COUNT, true);
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(queueLock);
+        writerStopping = true;
+    }
+    queueWake.notify_one();
+    writerThread.join();
+
+    if (outputIsPipe) pclose(output);
+    else fclose(output);
+    output = nullptr;
+
+    glDeleteBuffers(CAPTURE_PBO_COUNT, pbos);
+    freeFrames.clear();
+    active = false;
+}
+
+bool capturing() {
+    return active;
+}
+
+int capturedFrames() {
+    std::lock_guard<std::mutex> guard(queueLock);
+    return framesWritten;
+}
+
+int droppedFrames() {
+    std::lock_guard<std::mutex> guard(queueLock);
+    return framesDropped;
+}
@@ -0,0 +1,31 @@
+// Capture.h
+#pragma once
+#include <GL/glew.h>
+
+// Asynchronous frame capture. Each frame is read back into a ring of pixel
+// buffer objects and mapped CAPTURE_PBO_COUNT frames later, just before its
+// buffer is reused. By then the transfer has long finished, so neither
+// glReadPixels nor the map waits for the GPU.
+// Mapped frames are converted to YUV 4:2:0 on the job system and written by
+// a separate thread, either to a raw .yuv file or into an ffmpeg pipe.
+const int CAPTURE_PBO_COUNT = 3;
+
+// Frames converted but not yet written; further frames are dropped
+const int CAPTURE_QUEUE_LENGTH = 4;
+
+// Start recording width x height frames (rounded down to even sizes).
+// A path ending in ".yuv" gets raw frames; anything else is encoded by
+// ffmpeg, which must be on the PATH.
+bool startCapture(const char* path, int width, int height, double frameRate);
+
+// Read back the current back buffer; call after drawing and before the swap
+void captureFrame();
+
+// Drain the pipeline and close the output
+void stopCapture();
+
+bool capturing();
+
+// Frames written and frames dropped because the writer fell behind
+int capturedFrames();
+int droppedFrames();
@@ -0,0 +1,322 @@
+// Checkpoint.cpp
+#include "Checkpoint.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Snapshot handed from the simulation to the writer thread
+struct Snapshot {
+    std::string path;
+    double simulationTime = 0.0;
+    int bodyCount = 0;
+    std::vector<float> columns[CHECKPOINT_COLUMNS];
+};
+
+static std::thread writerThread;
+static std::mutex writerLock;
+static std::condition_variable writerWake;
+static Snapshot pendingSnapshot;
+static bool snapshotPending = false; // Set by requestCheckpoint(), cleared when written
+static bool writerRunning = false;
+static CheckpointStats stats;
+
+// Split the bytes of each float into four planes
+static void shuffle(const float* values, int count, std::vector<uint8_t>& planes) {
+    const uint8_t* bytes = (const uint8_t*)values;
+    planes.resize((size_t)count * 4);
+    for (int i = 0; i < count; ++i) {
+        for (int k = 0; k < 4; ++k) {
+            planes[(size_t)k * count + i] = bytes[4 * i + k];
+        }
+    }
+}
+
+static void unshuffle(const std::vector<uint8_t>& planes, int count, float* values) {
+    uint8_t* bytes = (uint8_t*)values;
+    for (int i = 0; i < count; ++i) {
+        for (int k = 0; k < 4; ++k) {
+            bytes[4 * i + k] = planes[(size_t)k * count + i];
+        }
+    }
+}
+
+// Order-0 rANS coder for one byte plane. A plane is stored as a mode
+// byte, then either the raw bytes (mode 0) or 256 16-bit symbol
+// frequencies, the stream length and the rANS stream (mode 1).
+const int RANS_PRECISION = 12;
+const uint32_t RANS_TOTAL = 1u << RANS_PRECISION;
+const uint32_t RANS_LOW = 1u << 23; // Lower bound of the normalized state
+
+// Scale symbol counts so they add up to RANS_TOTAL, keeping every used symbol
+static void normalizeFrequencies(const uint32_t* counts, size_t total, uint32_t* freq) {
+    int32_t sum = 0;
+    for (int s = 0; s < 256; ++s) {
+        freq[s] = counts[s] ? (uint32_t)std::max<uint64_t>(1, (uint64_t)counts[s] * RANS_TOTAL / total) : 0;
+        sum += (int32_t)freq[s];
+    }
+
+    // Settle the rounding error on the most frequent symbols
+    while (sum != (int32_t)RANS_TOTAL) {
+        int largest = 0;
+        for (int s = 1; s < 256; ++s) {
+            if (freq[s] > freq[largest]) largest = s;
+        }
+        int32_t change = (int32_t)RANS_TOTAL - sum;
+        if (change < 0) change = std::max(change, 1 - (int32_t)freq[largest]);
+        freq[largest] += change;
+        sum += change;
+    }
+}
+
+static void encodePlane(const uint8_t* in, size_t n, std::vector<uint8_t>& out) {
+    uint32_t counts[256] = {}, freq[256], start[256];
+    for (size_t i = 0; i < n; ++i) ++counts[in[i]];
+    normalizeFrequencies(counts, n ? n : 1, freq);
+    for (int s = 0, cumulative = 0; s < 256; ++s) {
+        start[s] = cumulative;
+        cumulative += freq[s];
+    }
+
+    // rANS encodes backwards and emits bytes in reverse
+    std::vector<uint8_t> stream;
+    uint32_t x = RANS_LOW;
+    for (size_t i = n; i-- > 0;) {
+        uint32_t f = freq[in[i]];
+        uint32_t limit = ((RANS_LOW >> RANS_PRECISION) << 8) * f;
+        while (x >= limit) {
+            stream.push_back((uint8_t)x);
+            x >>= 8;
+        }
+        x = ((x / f) << RANS_PRECISION) + (x % f) + start[in[i]];
+    }
+    for (int k = 0; k < 4; ++k, x >>= 8) stream.push_back((uint8_t)x);
+    std::reverse(stream.begin(), stream.end());
+
+    size_t coded = 512 + 4 + stream.size();
+    if (coded >= n) { // Incompressible: store
+        out.push_back(0);
+        out.insert(out.end(), in, in + n);
+        return;
+    }
+    out.push_back(1);
+    for (int s = 0; s < 256; ++s) {
+        out.push_back((uint8_t)freq[s]);
+        out.push_back((uint8_t)(freq[s] >> 8));
+    }
+    uint32_t length = (uint32_t)stream.size();
+    for (int k = 0; k < 4; ++k) out.push_back((uint8_t)(length >> (8 * k)));
+    out.insert(out.end(), stream.begin(), stream.end());
+}
+
+// Decode n bytes of a plane starting at `in`; returns the bytes consumed, or 0 on error
+static size_t decodePlane(const uint8_t* in, size_t size, uint8_t* out, size_t n) {
+    if (size < 1) return 0;
+    if (in[0] == 0) {
+        if (size < 1 + n) return 0;
+        memcpy(out, in + 1, n);
+        return 1 + n;
+    }
+    if (in[0] != 1 || size < 1 + 512 + 4) return 0;
+
+    uint32_t freq[256], start[256];
+    uint8_t symbolOf[RANS_TOTAL];
+    uint32_t cumulative = 0;
+    for (int s = 0; s < 256; ++s) {
+        freq[s] = in[1 + 2 * s] | (in[2 + 2 * s] << 8);
+        start[s] = cumulative;
+        if (cumulative + freq[s] > RANS_TOTAL) return 0;
+        memset(symbolOf + cumulative, s, freq[s]);
+        cumulative += freq[s];
+    }
+    if (cumulative != RANS_TOTAL) return 0;
+
+    const uint8_t* p = in + 513;
+    uint32_t length = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    p += 4;
+    if (length < 4 || size < 517 + (size_t)length) return 0;
+    const uint8_t* end = p + length;
+
+    uint32_t x = 0;
+    for (int k = 0; k < 4; ++k) x = (x << 8) | *p++;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t slot = x & (RANS_TOTAL - 1);
+        uint8_t s = symbolOf[slot];
+        out[i] = s;
+        x = freq[s] * (x >> RANS_PRECISION) + slot - start[s];
+        while (x < RANS_LOW) {
+            if (p == end) return 0;
+            x = (x << 8) | *p++;
+        }
+    }
+    return 517 + length;
+}
+
+// Replace `to` with `from`, even if `to` exists
+static bool replaceFile(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+static void writeSnapshot(const Snapshot& snapshot) {
+    auto start = std::chrono::steady_clock::now();
+
+    CheckpointHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, 4);
+    header.version = CHECKPOINT_VERSION;
+    header.bodyCount = (uint32_t)snapshot.bodyCount;
+    header.columnCount = CHECKPOINT_COLUMNS;
+    header.simulationTime = snapshot.simulationTime;
+
+    std::vector<uint8_t> planes, packed[CHECKPOINT_COLUMNS];
+    for (int c = 0; c < CHECKPOINT_COLUMNS; ++c) {
+        shuffle(snapshot.columns[c].data(), snapshot.bodyCount, planes);
+        packed[c].clear();
+        for (int k = 0; k < 4; ++k) {
+            encodePlane(planes.data() + (size_t)k * snapshot.bodyCount, snapshot.bodyCount, packed[c]);
+        }
+        header.packedSize[c] = packed[c].size();
+    }
+
+    // Write beside the old checkpoint and swap, so a crash never leaves a torn file
+    std::string temporary = snapshot.path + ".tmp";
+    FILE* out = fopen(temporary.c_str(), "wb");
+    if (!out) {
+        std::cerr << "Failed to open checkpoint: " << temporary << std::endl;
+        return;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    uint64_t fileSize = sizeof(header);
+    for (int c = 0; c < CHECKPOINT_COLUMNS; ++c) {
+        ok = ok && fwrite(packed[c].data(), 1, packed[c].size(), out) == packed[c].size();
+        fileSize += packed[c].size();
+    }
+    ok = (fclose(out) == 0) && ok;
+    if (!ok || !replaceFile(temporary, snapshot.path)) {
+        std::cerr << "Failed to write checkpoint: " << snapshot.path << std::endl;
+        return;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double rawBytes = (double)snapshot.bodyCount * 4 * CHECKPOINT_COLUMNS + sizeof(header);
+
+    std::lock_guard<std::mutex> guard(writerLock);
+    ++stats.written;
+    stats.megabytesPerSecond = seconds > 0.0 ? (float)(rawBytes / seconds / 1e6) : 0.0f;
+    stats.bytesPerBody = (float)fileSize / snapshot.bodyCount;
+}
+
+static void writerLoop() {
+    Snapshot snapshot;
+    std::unique_lock<std::mutex> guard(writerLock);
+    while (true) {
+        writerWake.wait(guard, [] { return snapshotPending || !writerRunning; });
+        if (!snapshotPending) break; // Stopped with nothing left to write
+
+        std::swap(snapshot, pendingSnapshot);
+        guard.unlock();
+        writeSnapshot(snapshot);
+        guard.lock();
+        snapshotPending = false;
+    }
+}
+
+void initCheckpoints() {
+    if (writerThread.joinable()) return;
+    writerRunning = true;
+    writerThread = std::thread(writerLoop);
+}
+
+void shutdownCheckpoints() {
+    if (!writerThread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> guard(writerLock);
+        writerRunning = false;
+    }
+    writerWake.notify_one();
+    writerThread.join();
+}
+
+bool requestCheckpoint(const char* path, double simulationTime, const BodyTable& table) {
+    std::lock_guard<std::mutex> guard(writerLock);
+    if (snapshotPending || !writerRunning) {
+        ++stats.skipped;
+        return false;
+    }
+
+    // Only the copy happens on the simulation thread; the buffers are reused
+    pendingSnapshot.path = path;
+    pendingSnapshot.simulationTime = simulationTime;
+    pendingSnapshot.bodyCount = table.count();
+    pendingSnapshot.columns[0].assign(table.posX.begin(), table.posX.end());
+    pendingSnapshot.columns[1].assign(table.posY.begin(), table.posY.end());
+    pendingSnapshot.columns[2].assign(table.posZ.begin(), table.posZ.end());
+    snapshotPending = true;
+    writerWake.notify_one();
+    return true;
+}
+
+bool readCheckpoint(const char* path, int bodyCount, double& simulationTime,
+    std::vector<float>& x, std::vector<float>& y, std::vector<float>& z) {
+    FILE* in = fopen(path, "rb");
+    if (!in) {
+        std::cerr << "Failed to open checkpoint: " << path << std::endl;
+        return false;
+    }
+
+    CheckpointHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, CHECKPOINT_MAGIC, 4) != 0
+        || header.version != CHECKPOINT_VERSION || header.columnCount != CHECKPOINT_COLUMNS) {
+        std::cerr << "Not a valid checkpoint: " << path << std::endl;
+        fclose(in);
+        return false;
+    }
+    if ((int)header.bodyCount != bodyCount) {
+        std::cerr << "Checkpoint has " << header.bodyCount << " bodies, the scene has " << bodyCount << std::endl;
+        fclose(in);
+        return false;
+    }
+
+    std::vector<float>* columns[CHECKPOINT_COLUMNS] = { &x, &y, &z };
+    std::vector<uint8_t> packed, planes;
+    for (int c = 0; c < CHECKPOINT_COLUMNS; ++c) {
+        packed.resize((size_t)header.packedSize[c]);
+        planes.resize((size_t)bodyCount * 4);
+        bool ok = fread(packed.data(), 1, packed.size(), in) == packed.size();
+        size_t used = 0;
+        for (int k = 0; ok && k < 4; ++k) {
+            size_t bytes = decodePlane(packed.data() + used, packed.size() - used, planes.data() + (size_t)k * bodyCount, bodyCount);
+            ok = bytes != 0;
+            used += bytes;
+        }
+        if (!ok) {
+            std::cerr << "Checkpoint is truncated or corrupt: " << path << std::endl;
+            fclose(in);
+            return false;
+        }
+        columns[c]->resize(bodyCount);
+        unshuffle(planes, bodyCount, columns[c]->data());
+    }
+    fclose(in);
+
+    simulationTime = header.simulationTime;
+    return true;
+}
+
+CheckpointStats checkpointStats() {
+    std::lock_guard<std::mutex> guard(writerLock);
+    return stats;
+}
@@ -0,0 +1,51 @@
+// Checkpoint.h
+#pragma once
+#include "Bodies.h"
+#include <cstdint>
+#include <vector>
+
+// Simulation checkpoints: the clock and every body's position, written on a
+// background thread. Each position column is byte-shuffled (the four bytes
+// of every float split into planes, so the sign and exponent bytes sit
+// together) and each plane is entropy coded with an order-0 rANS coder.
+// The codec is lossless, so resuming is bit-exact.
+const char CHECKPOINT_MAGIC[4] = { 'C', 'K', 'P', 'T' };
+const uint32_t CHECKPOINT_VERSION = 1;
+const int CHECKPOINT_COLUMNS = 3; // posX, posY, posZ
+
+struct CheckpointHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t bodyCount;
+    uint32_t columnCount;
+    double simulationTime;                     // Bit-exact; positions follow from it
+    uint64_t packedSize[CHECKPOINT_COLUMNS];   // Bytes of each compressed column
+};
+
+static_assert(sizeof(CheckpointHeader) == 48, "CheckpointHeader must be 48 bytes");
+
+// Results of the most recent checkpoint write
+struct CheckpointStats {
+    int written = 0;          // Checkpoints completed
+    int skipped = 0;          // Requests dropped because the writer was busy
+    float megabytesPerSecond = 0.0f; // Uncompressed bytes over compress + write time
+    float bytesPerBody = 0.0f;       // File size per body
+};
+
+// Start the writer thread
+void initCheckpoints();
+
+// Finish any pending write and stop the writer thread
+void shutdownCheckpoints();
+
+// Copy the positions and hand them to the writer thread. Never waits: if
+// the previous checkpoint is still being written the request is skipped
+// and false is returned.
+bool requestCheckpoint(const char* path, double simulationTime, const BodyTable& table);
+
+// Read a checkpoint written for a table of bodyCount bodies; prints an
+// error and returns false on failure
+bool readCheckpoint(const char* path, int bodyCount, double& simulationTime,
+    std::vector<float>& x, std::vector<float>& y, std::vector<float>& z);
+
+CheckpointStats checkpointStats();
@@ -0,0 +1,310 @@
+// Collisions.cpp
+#include "Collisions.h"
+#include "Jobs.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+// Bodies per job in the per-body passes
+const int COLLISION_JOB_GRAIN = 4096;
+
+// A body's copy in a slab, so the sweep and the pair tests read slab-local memory
+struct SlabBody {
+    float fromX, fromY, fromZ; // Position at the previous tick
+    float toX, toY, toZ;       // and now
+    float radius;
+    int32_t body;
+};
+
+// Swept box of a slab body along one axis, grown to the approach distance
+static float sweptMin(float from, float to, float radius) {
+    return std::min(from, to) - COLLISION_APPROACH_FACTOR * radius;
+}
+
+static float sweptMax(float from, float to, float radius) {
+    return std::max(from, to) + COLLISION_APPROACH_FACTOR * radius;
+}
+
+// Sort key of a slab's sweep list
+struct SweepKey {
+    uint32_t order; // minX with its bits mapped so unsigned order is float order
+    int32_t index;  // SlabBody within the slab
+};
+
+static uint32_t floatOrder(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, 4);
+    return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+}
+
+// LSD radix sort by byte; passes where every key has the same byte are skipped.
+// The result is in keys, using scratch of the same size.
+static void radixSort(SweepKey* keys, SweepKey* scratch, int count) {
+    SweepKey* from = keys;
+    SweepKey* to = scratch;
+    for (int shift = 0; shift < 32; shift += 8) {
+        int histogram[256] = {};
+        for (int i = 0; i < count; ++i) ++histogram[(from[i].order >> shift) & 255];
+        if (histogram[(from[0].order >> shift) & 255] == count) continue;
+        int offset = 0;
+        for (int d = 0; d < 256; ++d) {
+            int n = histogram[d];
+            histogram[d] = offset;
+            offset += n;
+        }
+        for (int i = 0; i < count; ++i) to[histogram[(from[i].order >> shift) & 255]++] = from[i];
+        std::swap(from, to);
+    }
+    if (from != keys) memcpy(keys, from, count * sizeof(SweepKey));
+}
+
+// Positions at the previous tick
+static std::vector<float> previousX, previousY, previousZ;
+static double previousTime = 0.0;
+static bool havePrevious = false;
+
+// Slabs along Z; per-chunk counts and scatter offsets are stored chunk-major
+static int slabCount = 0;
+static float slabMinZ = 0.0f, slabScale = 0.0f;
+static std::vector<float> chunkMinZ, chunkMaxZ;
+static std::vector<int> chunkSlabCounts;
+static std::vector<int> slabStart;
+static std::vector<SlabBody> slabBodies;
+static std::vector<SweepKey> sweepKeys, sortScratch;
+
+static const BodyTable* table = nullptr;
+static double tickStart = 0.0, tickLength = 0.0;
+static std::atomic<int> candidatePairs{ 0 };
+
+static std::vector<CollisionEvent> eventLog;
+static std::atomic<uint64_t> eventCount{ 0 };
+static std::atomic<uint64_t> approachCount{ 0 }, contactCount{ 0 };
+static CollisionStats stats;
+
+static int slabOf(float z) {
+    int s = (int)((z - slabMinZ) * slabScale);
+    return s < 0 ? 0 : s >= slabCount ? slabCount - 1 : s;
+}
+
+static void logEvent(CollisionEventType type, int a, int b, float fraction, float distance) {
+    uint64_t index = eventCount.fetch_add(1, std::memory_order_relaxed);
+    CollisionEvent& event = eventLog[index % COLLISION_LOG_CAPACITY];
+    event.time = tickStart + fraction * tickLength;
+    event.a = a;
+    event.b = b;
+    event.distance = distance;
+    event.type = type;
+    (type == COLLISION_CONTACT ? contactCount : approachCount).fetch_add(1, std::memory_order_relaxed);
+}
+
+// Continuous test for a broadphase pair: both bodies move in a straight
+// line over the tick, so their separation is d0 + v t for t in [0, 1]
+static void testPair(const SlabBody& p, const SlabBody& q) {
+    float d0x = p.fromX - q.fromX, d0y = p.fromY - q.fromY, d0z = p.fromZ - q.fromZ;
+    float vx = (p.toX - q.toX) - d0x, vy = (p.toY - q.toY) - d0y, vz = (p.toZ - q.toZ) - d0z;
+    float contact = p.radius + q.radius;
+    float approach = COLLISION_APPROACH_FACTOR * contact;
+
+    float dv = d0x * vx + d0y * vy + d0z * vz;
+    float vv = vx * vx + vy * vy + vz * vz;
+    float t = vv > 0.0f ? std::min(std::max(-dv / vv, 0.0f), 1.0f) : 0.0f;
+    float mx = d0x + vx * t, my = d0y + vy * t, mz = d0z + vz * t;
+    float closest2 = mx * mx + my * my + mz * mz;
+    if (closest2 > approach * approach) return;
+
+    // Only entries into range are events; pairs already inside at the start were logged before
+    int a = std::min(p.body, q.body), b = std::max(p.body, q.body);
+    float start2 = d0x * d0x + d0y * d0y + d0z * d0z;
+    if (start2 > approach * approach) logEvent(COLLISION_APPROACH, a, b, t, sqrtf(closest2));
+    if (start2 > contact * contact && closest2 <= contact * contact) {
+        // First root of |d0 + v s|^2 = contact^2
+        float c = start2 - contact * contact;
+        float s = (-dv - sqrtf(std::max(dv * dv - vv * c, 0.0f))) / vv;
+        logEvent(COLLISION_CONTACT, a, b, std::min(std::max(s, 0.0f), 1.0f), contact);
+    }
+}
+
+// Z extent of a body's swept box
+static void sweptRangeZ(int b, float& low, float& high) {
+    low = sweptMin(previousZ[b], table->posZ[b], table->radius[b]);
+    high = sweptMax(previousZ[b], table->posZ[b], table->radius[b]);
+}
+
+static void boundsJob(void* data, int begin, int end) {
+    float lowZ = INFINITY, highZ = -INFINITY;
+    for (int b = begin; b < end; ++b) {
+        float low, high;
+        sweptRangeZ(b, low, high);
+        lowZ = std::min(lowZ, low);
+        highZ = std::max(highZ, high);
+    }
+    chunkMinZ[begin / COLLISION_JOB_GRAIN] = lowZ;
+    chunkMaxZ[begin / COLLISION_JOB_GRAIN] = highZ;
+}
+
+static void countSlabsJob(void* data, int begin, int end) {
+    int* counts = chunkSlabCounts.data() + (size_t)(begin / COLLISION_JOB_GRAIN) * slabCount;
+    std::fill(counts, counts + slabCount, 0);
+    for (int b = begin; b < end; ++b) {
+        float low, high;
+        sweptRangeZ(b, low, high);
+        for (int s = slabOf(low), last = slabOf(high); s <= last; ++s) ++counts[s];
+    }
+}
+
+static void scatterSlabsJob(void* data, int begin, int end) {
+    int* offsets = chunkSlabCounts.data() + (size_t)(begin / COLLISION_JOB_GRAIN) * slabCount;
+    for (int b = begin; b < end; ++b) {
+        SlabBody body;
+        body.fromX = previousX[b];
+        body.fromY = previousY[b];
+        body.fromZ = previousZ[b];
+        body.toX = table->posX[b];
+        body.toY = table->posY[b];
+        body.toZ = table->posZ[b];
+        body.radius = table->radius[b];
+        body.body = b;
+        uint32_t order = floatOrder(sweptMin(body.fromX, body.toX, body.radius));
+        for (int s = slabOf(sweptMin(body.fromZ, body.toZ, body.radius)), last = slabOf(sweptMax(body.fromZ, body.toZ, body.radius)); s <= last; ++s) {
+            int offset = offsets[s]++;
+            slabBodies[offset] = body;
+            sweepKeys[offset].order = order;
+            sweepKeys[offset].index = offset - slabStart[s];
+        }
+    }
+}
+
+// Sort one slab along X and sweep it; a pair shared by several slabs is
+// tested only in the slab where the overlap of their Z ranges begins
+static void sweepSlabsJob(void* data, int begin, int end) {
+    int pairs = 0;
+    for (int s = begin; s < end; ++s) {
+        const SlabBody* slab = slabBodies.data() + slabStart[s];
+        SweepKey* first = sweepKeys.data() + slabStart[s];
+        SweepKey* last = sweepKeys.data() + slabStart[s + 1];
+        if (last > first) radixSort(first, sortScratch.data() + slabStart[s], (int)(last - first));
+        for (SweepKey* i = first; i < last; ++i) {
+            const SlabBody& p = slab[i->index];
+            uint32_t maxX = floatOrder(sweptMax(p.fromX, p.toX, p.radius));
+            float minY = sweptMin(p.fromY, p.toY, p.radius), maxY = sweptMax(p.fromY, p.toY, p.radius);
+            float minZ = sweptMin(p.fromZ, p.toZ, p.radius), maxZ = sweptMax(p.fromZ, p.toZ, p.radius);
+            for (SweepKey* j = i + 1; j < last && j->order <= maxX; ++j) {
+                const SlabBody& q = slab[j->index];
+                if (minY > sweptMax(q.fromY, q.toY, q.radius) || sweptMin(q.fromY, q.toY, q.radius) > maxY) continue;
+                float qMinZ = sweptMin(q.fromZ, q.toZ, q.radius);
+                if (minZ > sweptMax(q.fromZ, q.toZ, q.radius) || qMinZ > maxZ) continue;
+                if (slabOf(std::max(minZ, qMinZ)) != s) continue;
+                ++pairs;
+                testPair(p, q);
+            }
+        }
+    }
+    candidatePairs.fetch_add(pairs, std::memory_order_relaxed);
+}
+
+static void copyPositionsJob(void* data, int begin, int end) {
+    std::copy(table->posX.begin() + begin, table->posX.begin() + end, previousX.begin() + begin);
+    std::copy(table->posY.begin() + begin, table->posY.begin() + end, previousY.begin() + begin);
+    std::copy(table->posZ.begin() + begin, table->posZ.begin() + end, previousZ.begin() + begin);
+}
+
+void detectCollisions(const BodyTable& bodies, double time) {
+    auto start = std::chrono::steady_clock::now();
+    table = &bodies;
+    int n = bodies.count();
+    int chunks = (n + COLLISION_JOB_GRAIN - 1) / COLLISION_JOB_GRAIN;
+
+    // The first tick, or a new table, only records where the bodies are
+    if (!havePrevious || (int)previousX.size() != n) {
+        previousX.resize(n);
+        previousY.resize(n);
+        previousZ.resize(n);
+        chunkMinZ.resize(chunks);
+        chunkMaxZ.resize(chunks);
+        eventLog.resize(COLLISION_LOG_CAPACITY);
+        JobCounter copied;
+        parallelFor(n, COLLISION_JOB_GRAIN, copyPositionsJob, nullptr, &copied);
+        waitForCounter(&copied);
+        previousTime = time;
+        havePrevious = true;
+        return;
+    }
+    tickStart = previousTime;
+    tickLength = time - previousTime;
+
+    JobCounter bounded;
+    parallelFor(n, COLLISION_JOB_GRAIN, boundsJob, nullptr, &bounded);
+    waitForCounter(&bounded);
+
+    // Slabs of roughly COLLISION_SLAB_BODIES bodies over the occupied Z range
+    float lowZ = INFINITY, highZ = -INFINITY;
+    for (int c = 0; c < chunks; ++c) {
+        lowZ = std::min(lowZ, chunkMinZ[c]);
+        highZ = std::max(highZ, chunkMaxZ[c]);
+    }
+    slabCount = std::max(1, std::min(COLLISION_MAX_SLABS, n / COLLISION_SLAB_BODIES));
+    slabMinZ = lowZ;
+    slabScale = highZ > lowZ ? slabCount / (highZ - lowZ) : 0.0f;
+
+    // Counting sort of the bodies into slabs: count per chunk, turn the
+    // counts into offsets in slab order, then scatter
+    chunkSlabCounts.resize((size_t)chunks * slabCount);
+    JobCounter counted;
+    parallelFor(n, COLLISION_JOB_GRAIN, countSlabsJob, nullptr, &counted);
+    waitForCounter(&counted);
+    slabStart.resize(slabCount + 1);
+    int total = 0;
+    for (int s = 0; s < slabCount; ++s) {
+        slabStart[s] = total;
+        for (int c = 0; c < chunks; ++c) {
+            int& count = chunkSlabCounts[(size_t)c * slabCount + s];
+            int offset = total;
+            total += count;
+            count = offset;
+        }
+    }
+    slabStart[slabCount] = total;
+    slabBodies.resize(total);
+    sweepKeys.resize(total);
+    sortScratch.resize(total);
+    JobCounter scattered;
+    parallelFor(n, COLLISION_JOB_GRAIN, scatterSlabsJob, nullptr, &scattered);
+    waitForCounter(&scattered);
+
+    candidatePairs.store(0, std::memory_order_relaxed);
+    JobCounter swept;
+    parallelFor(slabCount, 1, sweepSlabsJob, nullptr, &swept);
+    waitForCounter(&swept);
+
+    JobCounter copied;
+    parallelFor(n, COLLISION_JOB_GRAIN, copyPositionsJob, nullptr, &copied);
+    waitForCounter(&copied);
+    previousTime = time;
+
+    stats.approaches = approachCount.load(std::memory_order_relaxed);
+    stats.contacts = contactCount.load(std::memory_order_relaxed);
+    stats.candidatePairs = candidatePairs.load(std::memory_order_relaxed);
+    stats.slabs = slabCount;
+    stats.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void resetCollisions() {
+    havePrevious = false;
+}
+
+uint64_t collisionEventCount() {
+    return eventCount.load(std::memory_order_relaxed);
+}
+
+bool collisionEvent(uint64_t index, CollisionEvent& event) {
+    uint64_t count = eventCount.load(std::memory_order_relaxed);
+    if (index >= count || count - index > (uint64_t)COLLISION_LOG_CAPACITY) return false;
+    event = eventLog[index % COLLISION_LOG_CAPACITY];
+    return true;
+}
+
+CollisionStats collisionStats() {
+    return stats;
+}
@@ -0,0 +1,54 @@
+// Collisions.h
+#pragma once
+#include "Bodies.h"
+#include <cstdint>
+
+// Close-approach and collision detection over every body, once per update
+// tick. Each body's bounding sphere, grown to the approach distance, is
+// swept from its position at the previous tick to the current one. The
+// broadphase is sweep-and-prune: the swept boxes are bucketed into slabs
+// along Z with a parallel counting sort, and each slab is radix-sorted and
+// swept along X on its own job, so a million bodies never meet the
+// all-pairs cost. Candidate pairs are refined with a continuous test on
+// the straight line between the two ticks, which finds the closest
+// distance and the moment of first contact. Only entries into range are
+// logged, so a pair that stays close is reported once.
+const float COLLISION_APPROACH_FACTOR = 4.0f; // Approach within this many times the sum of the radii
+const int COLLISION_SLAB_BODIES = 1024;       // Target bodies per slab
+const int COLLISION_MAX_SLABS = 4096;
+const int COLLISION_LOG_CAPACITY = 65536;     // Ring of the most recent events
+
+enum CollisionEventType {
+    COLLISION_APPROACH, // Came within the approach distance
+    COLLISION_CONTACT   // Bounding spheres touched
+};
+
+struct CollisionEvent {
+    double time;        // Simulation time of closest approach or first contact
+    int32_t a, b;       // Body indices, a < b
+    float distance;     // Between centers at that time
+    int32_t type;       // CollisionEventType
+};
+
+struct CollisionStats {
+    uint64_t approaches = 0;  // Since start
+    uint64_t contacts = 0;
+    int candidatePairs = 0;   // Broadphase pairs in the last tick
+    int slabs = 0;
+    float milliseconds = 0.0f; // Last tick's detection time
+};
+
+// Detect the events between the previous call and `time` for the table's
+// current float positions, using the job system
+void detectCollisions(const BodyTable& table, double time);
+
+// Forget the previous positions, for when the clock jumps instead of
+// stepping; the next detectCollisions() only records where the bodies are
+void resetCollisions();
+
+// Events logged so far; event i stays readable until COLLISION_LOG_CAPACITY
+// newer ones replace it. Read between ticks.
+uint64_t collisionEventCount();
+bool collisionEvent(uint64_t index, CollisionEvent& event);
+
+CollisionStats collisionStats();
@@ -0,0 +1,332 @@
+// Comets.cpp
+#include "Comets.h"
+#include "Particles.h"
+#include "FrameArena.h"
+#include "Jobs.h"
+#include "PerfCounters.h"
+#include "Shaders.h"
+#include <GL/glew.h>
+#include <cmath>
+
+// Scene gravity: the Earth's orbit (distance 7 at 90 degrees per second) is
+// a Kepler orbit under it
+const double COMET_GM = (3.14159265358979 / 2.0) * (3.14159265358979 / 2.0) * 7.0 * 7.0 * 7.0;
+
+// Orbital elements; angles in degrees, distances in scene units
+struct CometOrbit {
+    const char* name;
+    double perihelion;
+    double eccentricity;
+    double inclination;
+    double node;          // Longitude of the ascending node
+    double argument;      // Argument of perihelion
+    double meanAnomaly;   // At time 0
+};
+
+static const CometOrbit COMET_ORBITS[] = {
+    { "Halley", 2.0, 0.88, 162.0, 58.0, 112.0, 300.0 },
+    { "Encke", 1.5, 0.83, 12.0, 334.0, 187.0, 100.0 },
+    { "Hale-Bopp", 2.5, 0.90, 89.0, 282.0, 131.0, 340.0 },
+};
+const int COMET_COUNT = sizeof(COMET_ORBITS) / sizeof(COMET_ORBITS[0]);
+
+// How one kind of tail is emitted and drawn
+struct TailKind {
+    float rate;          // Particles per second at distance 1 from the Sun
+    float speed;         // Away from the Sun, added to the inherited velocity
+    float inherit;       // Fraction of the nucleus' velocity kept
+    float spread;        // Random velocity per axis
+    float life;          // Mean lifetime in seconds
+    float pull;          // Fraction of the Sun's gravity felt
+    float color[4];
+    float size;          // Sprite size in pixels
+};
+
+static const TailKind ION_TAIL = { 3.2e6f, 80.0f, 0.0f, 4.0f, 0.06f, 0.0f, { 0.45f, 0.65f, 1.0f, 0.25f }, 2.0f };
+static const TailKind DUST_TAIL = { 8.0e5f, 3.0f, 1.0f, 0.6f, 0.6f, 0.85f, { 1.0f, 0.85f, 0.6f, 0.08f }, 2.0f };
+
+struct Comet;
+
+struct CometTail {
+    ParticleSystem particles;
+    const TailKind* kind;
+    const Comet* comet;
+    unsigned int random;  // xorshift32 state
+    float carry;          // Fraction of a particle left over from the last tick
+    float step;           // dt of the tick being run
+};
+
+struct Comet {
+    double position[3];
+    double velocity[3];
+    CometTail ion;
+    CometTail dust;
+};
+
+static Comet comets[COMET_COUNT];
+static bool cometsReady = false;
+static GLuint tailProgram = 0;
+static GLint colorUniform = -1;
+static GLint sizeUniform = -1;
+
+// Attribute locations are bound before the program is relinked
+enum TailAttribute { TAIL_PX, TAIL_PY, TAIL_PZ, TAIL_AGE, TAIL_LIFE };
+
+static const char* tailVertexShader =
+    "#version 120\n"
+    "attribute float px;\n"
+    "attribute float py;\n"
+    "attribute float pz;\n"
+    "attribute float age;\n"
+    "attribute float life;\n"
+    "uniform vec4 color;\n"
+    "uniform float size;\n"
+    "void main() {\n"
+    "    gl_PointSize = size;\n"
+    "    gl_FrontColor = vec4(color.rgb, color.a * clamp(1.0 - age / life, 0.0, 1.0));\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * vec4(px, py, pz, 1.0);\n"
+    "}\n";
+
+static const char* tailFragmentShader =
+    "#version 120\n"
+    "void main() {\n"
+    "    float r = 2.0 * length(gl_PointCoord - vec2(0.5));\n"
+    "    gl_FragColor = vec4(gl_Color.rgb, gl_Color.a * smoothstep(1.0, 0.2, r));\n"
+    "}\n";
+
+static float randomUnit(unsigned int& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (state >> 8) * (1.0f / 16777216.0f);
+}
+
+// Position and velocity on the orbit at `time`, in scene axes (Y up)
+static void placeComet(const CometOrbit& orbit, double time, Comet& comet) {
+    const double degToRad = 3.14159265358979 / 180.0;
+    double e = orbit.eccentricity;
+    double a = orbit.perihelion / (1.0 - e);
+    double n = sqrt(COMET_GM / (a * a * a));
+    double m = fmod(orbit.meanAnomaly * degToRad + n * time, 2.0 * 3.14159265358979);
+
+    // Kepler's equation M = E - e sin E by Newton's method
+    double E = e > 0.8 ? 3.14159265358979 : m;
+    for (int i = 0; i < 12; ++i) {
+        E -= (E - e * sin(E) - m) / (1.0 - e * cos(E));
+    }
+    double cE = cos(E), sE = sin(E), b = a * sqrt(1.0 - e * e);
+    double rate = n / (1.0 - e * cE); // dE/dt
+    double ox = a * (cE - e), oy = b * sE;
+    double ovx = -a * sE * rate, ovy = b * cE * rate;
+
+    // Orbital plane to ecliptic (Z north)
+    double cw = cos(orbit.argument * degToRad), sw = sin(orbit.argument * degToRad);
+    double cn = cos(orbit.node * degToRad), sn = sin(orbit.node * degToRad);
+    double ci = cos(orbit.inclination * degToRad), si = sin(orbit.inclination * degToRad);
+    double p[3] = { cn * cw - sn * sw * ci, sn * cw + cn * sw * ci, sw * si };
+    double q[3] = { -cn * sw - sn * cw * ci, -sn * sw + cn * cw * ci, cw * si };
+    double ex = ox * p[0] + oy * q[0], ey = ox * p[1] + oy * q[1], ez = ox * p[2] + oy * q[2];
+    double vx = ovx * p[0] + ovy * q[0], vy = ovx * p[1] + ovy * q[1], vz = ovx * p[2] + ovy * q[2];
+
+    // Ecliptic to scene, where orbits run counterclockwise seen from +Y
+    comet.position[0] = ex;
+    comet.position[1] = ez;
+    comet.position[2] = -ey;
+    comet.velocity[0] = vx;
+    comet.velocity[1] = vz;
+    comet.velocity[2] = -vy;
+}
+
+static void initTail(CometTail& tail, const TailKind& kind, const Comet& comet, int capacity, unsigned int seed) {
+    initParticleSystem(tail.particles, capacity);
+    tail.particles.radialAcceleration = (float)(-COMET_GM * kind.pull);
+    tail.kind = &kind;
+    tail.comet = &comet;
+    tail.random = seed;
+    tail.carry = 0.0f;
+    tail.step = 0.0f;
+}
+
+static void advanceTailJob(void* data, int begin, int end) {
+    CometTail* tail = (CometTail*)data;
+    advanceParticles(tail->particles, tail->step, begin, end);
+}
+
+// Retire the dead, then emit this tick's particles. Each one is born at a
+// random moment inside the tick and moved to where it would be now, so
+// the tail stays continuous however far the nucleus moved.
+static void emitTailJob(void* data, int begin, int end) {
+    CometTail& tail = *(CometTail*)data;
+    const TailKind& kind = *tail.kind;
+    const Comet& comet = *tail.comet;
+    ParticleSystem& s = tail.particles;
+    compactParticles(s);
+
+    float cx = (float)comet.position[0], cy = (float)comet.position[1], cz = (float)comet.position[2];
+    float r2 = cx * cx + cy * cy + cz * cz;
+    float r = sqrtf(r2);
+    float wanted = kind.rate / r2 * tail.step + tail.carry;
+    int first;
+    int granted = reserveParticles(s, (int)wanted, first);
+    tail.carry = wanted - (int)wanted;
+
+    float ux = cx / r, uy = cy / r, uz = cz / r;
+    float bx = kind.inherit * (float)comet.velocity[0] + kind.speed * ux;
+    float by = kind.inherit * (float)comet.velocity[1] + kind.speed * uy;
+    float bz = kind.inherit * (float)comet.velocity[2] + kind.speed * uz;
+    float backX = (float)comet.velocity[0], backY = (float)comet.velocity[1], backZ = (float)comet.velocity[2];
+    for (int i = first; i < first + granted; ++i) {
+        float age = randomUnit(tail.random) * tail.step;
+        float vx = bx + kind.spread * (2.0f * randomUnit(tail.random) - 1.0f);
+        float vy = by + kind.spread * (2.0f * randomUnit(tail.random) - 1.0f);
+        float vz = bz + kind.spread * (2.0f * randomUnit(tail.random) - 1.0f);
+        s.posX[i] = cx + (vx - backX) * age;
+        s.posY[i] = cy + (vy - backY) * age;
+        s.posZ[i] = cz + (vz - backZ) * age;
+        s.velX[i] = vx;
+        s.velY[i] = vy;
+        s.velZ[i] = vz;
+        s.age[i] = age;
+        s.life[i] = kind.life * (0.5f + randomUnit(tail.random));
+    }
+}
+
+void initComets() {
+    for (int c = 0; c < COMET_COUNT; ++c) {
+        initTail(comets[c].ion, ION_TAIL, comets[c], COMET_ION_PARTICLES, 0x9e3779b9u + 2 * c);
+        initTail(comets[c].dust, DUST_TAIL, comets[c], COMET_DUST_PARTICLES, 0x7f4a7c15u + 2 * c);
+        placeComet(COMET_ORBITS[c], 0.0, comets[c]);
+    }
+
+    // The columns are fed straight from the pools as separate attributes
+    tailProgram = compileShaderProgram(tailVertexShader, tailFragmentShader);
+    if (tailProgram) {
+        glBindAttribLocation(tailProgram, TAIL_PX, "px");
+        glBindAttribLocation(tailProgram, TAIL_PY, "py");
+        glBindAttribLocation(tailProgram, TAIL_PZ, "pz");
+        glBindAttribLocation(tailProgram, TAIL_AGE, "age");
+        glBindAttribLocation(tailProgram, TAIL_LIFE, "life");
+        glLinkProgram(tailProgram);
+        GLint linked = GL_FALSE;
+        glGetProgramiv(tailProgram, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            glDeleteProgram(tailProgram);
+            tailProgram = 0;
+        }
+        else {
+            colorUniform = glGetUniformLocation(tailProgram, "color");
+            sizeUniform = glGetUniformLocation(tailProgram, "size");
+        }
+    }
+    cometsReady = true;
+}
+
+void updateComets(double time, float dt) {
+    if (!cometsReady) return;
+    for (int c = 0; c < COMET_COUNT; ++c) {
+        placeComet(COMET_ORBITS[c], time, comets[c]);
+        comets[c].ion.step = dt;
+        comets[c].dust.step = dt;
+    }
+
+    // Advance every tail in parallel, then retire and emit one job per tail
+    JobCounter advanced;
+    for (int c = 0; c < COMET_COUNT; ++c) {
+        parallelFor(comets[c].ion.particles.count, PARTICLE_JOB_GRAIN, advanceTailJob, &comets[c].ion, &advanced);
+        parallelFor(comets[c].dust.particles.count, PARTICLE_JOB_GRAIN, advanceTailJob, &comets[c].dust, &advanced);
+    }
+    waitForCounter(&advanced);
+
+    JobCounter emitted;
+    for (int c = 0; c < COMET_COUNT; ++c) {
+        runJob(emitTailJob, &comets[c].ion, 0, 0, &emitted);
+        runJob(emitTailJob, &comets[c].dust, 0, 0, &emitted);
+    }
+    waitForCounter(&emitted);
+}
+
+// One draw for all particles of a tail
+static void drawTail(const CometTail& tail) {
+    const ParticleSystem& s = tail.particles;
+    if (s.count == 0) return;
+    const TailKind& kind = *tail.kind;
+
+    if (tailProgram) {
+        glUniform4fv(colorUniform, 1, kind.color);
+        glUniform1f(sizeUniform, kind.size);
+        glVertexAttribPointer(TAIL_PX, 1, GL_FLOAT, GL_FALSE, 0, s.posX);
+        glVertexAttribPointer(TAIL_PY, 1, GL_FLOAT, GL_FALSE, 0, s.posY);
+        glVertexAttribPointer(TAIL_PZ, 1, GL_FLOAT, GL_FALSE, 0, s.posZ);
+        glVertexAttribPointer(TAIL_AGE, 1, GL_FLOAT, GL_FALSE, 0, s.age);
+        glVertexAttribPointer(TAIL_LIFE, 1, GL_FLOAT, GL_FALSE, 0, s.life);
+        glDrawArrays(GL_POINTS, 0, s.count);
+    }
+    else {
+        // No GLSL: interleave the positions and draw without fading
+        float* vertices = frameArray<float>((size_t)s.count * 3);
+        for (int i = 0; i < s.count; ++i) {
+            vertices[3 * i] = s.posX[i];
+            vertices[3 * i + 1] = s.posY[i];
+            vertices[3 * i + 2] = s.posZ[i];
+        }
+        glColor4f(kind.color[0], kind.color[1], kind.color[2], 0.5f * kind.color[3]);
+        glVertexPointer(3, GL_FLOAT, 0, vertices);
+        glDrawArrays(GL_POINTS, 0, s.count);
+    }
+    perfCount(PERF_DRAW_CALLS);
+}
+
+void drawComets() {
+    if (!cometsReady) return;
+
+    glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_POINT_BIT | GL_CURRENT_BIT);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_TEXTURE_2D);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE); // Particles add up
+    glDepthMask(GL_FALSE);             // Tested against the bodies, never written
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Tails first, then the nuclei on top
+    if (tailProgram) {
+        glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
+        glEnable(GL_POINT_SPRITE);
+        glUseProgram(tailProgram);
+        for (int a = TAIL_PX; a <= TAIL_LIFE; ++a) glEnableVertexAttribArray(a);
+    }
+    else {
+        glPointSize(1.0f);
+        glEnableClientState(GL_VERTEX_ARRAY);
+    }
+    for (int c = 0; c < COMET_COUNT; ++c) {
+        drawTail(comets[c].dust);
+        drawTail(comets[c].ion);
+    }
+    if (tailProgram) {
+        for (int a = TAIL_PX; a <= TAIL_LIFE; ++a) glDisableVertexAttribArray(a);
+        glUseProgram(0);
+        glDisable(GL_VERTEX_PROGRAM_POINT_SIZE);
+        glDisable(GL_POINT_SPRITE);
+        glEnableClientState(GL_VERTEX_ARRAY);
+    }
+
+    float nuclei[COMET_COUNT * 3];
+    for (int c = 0; c < COMET_COUNT; ++c) {
+        for (int k = 0; k < 3; ++k) nuclei[3 * c + k] = (float)comets[c].position[k];
+    }
+    glPointSize(4.0f);
+    glColor4f(0.9f, 0.95f, 1.0f, 1.0f);
+    glVertexPointer(3, GL_FLOAT, 0, nuclei);
+    glDrawArrays(GL_POINTS, 0, COMET_COUNT);
+    perfCount(PERF_DRAW_CALLS);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glPopAttrib();
+}
+
+int cometParticleCount() {
+    int total = 0;
+    for (int c = 0; c < COMET_COUNT; ++c) {
+        total += comets[c].ion.particles.count + comets[c].dust.particles.count;
+    }
+    return total;
+}
@@ -0,0 +1,25 @@
+// Comets.h
+#pragma once
+
+// A few comets on eccentric Kepler orbits around the Sun at the world
+// origin, each with an ion tail and a dust tail (Particles.h). Ions leave
+// the nucleus fast and straight away from the Sun; dust keeps the
+// nucleus' velocity and feels only part of the Sun's pull, so it lags
+// behind along the orbit in a curved fan. Both are emitted at a rate
+// that falls with the square of the distance to the Sun.
+const int COMET_ION_PARTICLES = 50000;   // Pool size per ion tail
+const int COMET_DUST_PARTICLES = 100000; // Pool size per dust tail
+
+// Allocate the particle pools and the sprite program (needs a GL context)
+void initComets();
+
+// Move the comets to `time` and advance their tails by dt seconds, on the
+// job workers. Called once per update() tick that ran steps.
+void updateComets(double time, float dt);
+
+// Draw the nuclei and tails as point sprites. The current modelview must
+// map world coordinates (the Sun at the origin).
+void drawComets();
+
+// Live particles over all tails
+int cometParticleCount();
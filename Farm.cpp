@@ -0,0 +1,149 @@
+// Farm.cpp
+#include "Farm.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+struct FarmChunk {
+    int first, last;
+    int attempts;
+};
+
+// Chunks waiting for a worker, shared by the slot threads
+static std::mutex farmLock;
+static std::deque<FarmChunk> pendingChunks;
+static int completedFrames = 0;
+static bool farmFailed = false;
+
+bool frameFileName(const std::string& pattern, int frame, std::string& name) {
+    size_t start = pattern.find('#');
+    if (start == std::string::npos) return false;
+    size_t end = pattern.find_first_not_of('#', start);
+    if (end == std::string::npos) end = pattern.size();
+
+    std::string number = std::to_string(frame);
+    if (number.size() < end - start) number.insert(0, end - start - number.size(), '0');
+    name = pattern.substr(0, start) + number + pattern.substr(end);
+    return true;
+}
+
+std::string shellQuote(const std::string& argument) {
+#ifdef _WIN32
+    std::string quoted = "\"";
+    for (char c : argument) {
+        if (c == '"') quoted += '\\';
+        quoted += c;
+    }
+    return quoted + "\"";
+#else
+    std::string quoted = "'";
+    for (char c : argument) {
+        if (c == '\'') quoted += "'\\''";
+        else quoted += c;
+    }
+    return quoted + "'";
+#endif
+}
+
+static bool chunkWritten(const FarmJob& job, const FarmChunk& chunk) {
+    for (int f = chunk.first; f <= chunk.last; ++f) {
+        std::string name;
+        frameFileName(job.pattern, f, name);
+        FILE* file = fopen(name.c_str(), "rb");
+        if (!file) return false;
+        fclose(file);
+    }
+    return true;
+}
+
+// One worker slot: take chunks until the queue is empty
+static void runSlot(const FarmJob* job, int slot) {
+    while (true) {
+        FarmChunk chunk;
+        {
+            std::lock_guard<std::mutex> guard(farmLock);
+            if (pendingChunks.empty() || farmFailed) return;
+            chunk = pendingChunks.front();
+            pendingChunks.pop_front();
+        }
+
+        // Stale frames from an earlier run must not pass for this one's
+        for (int f = chunk.first; f <= chunk.last; ++f) {
+            std::string name;
+            frameFileName(job->pattern, f, name);
+            remove(name.c_str());
+        }
+
+        std::string command = job->workers[slot] + " " + job->workerArgs + " --frames " +
+            std::to_string(chunk.first) + " " + std::to_string(chunk.last);
+        int status = system(command.c_str());
+        bool ok = status == 0 && chunkWritten(*job, chunk);
+
+        std::lock_guard<std::mutex> guard(farmLock);
+        if (ok) {
+            completedFrames += chunk.last - chunk.first + 1;
+            std::cout << "Worker " << slot << ": frames " << chunk.first << "-" << chunk.last << " done ("
+                << completedFrames << "/" << job->lastFrame - job->firstFrame + 1 << ")" << std::endl;
+        }
+        else if (++chunk.attempts < FARM_MAX_ATTEMPTS) {
+            std::cerr << "Worker " << slot << ": frames " << chunk.first << "-" << chunk.last
+                << " failed (status " << status << "), retrying" << std::endl;
+            pendingChunks.push_back(chunk);
+        }
+        else {
+            std::cerr << "Frames " << chunk.first << "-" << chunk.last << " failed " << FARM_MAX_ATTEMPTS
+                << " times, giving up" << std::endl;
+            farmFailed = true;
+        }
+    }
+}
+
+// Encode the numbered frames into one video
+static bool encodeVideo(const FarmJob& job) {
+    size_t start = job.pattern.find('#');
+    size_t end = job.pattern.find_first_not_of('#', start);
+    if (end == std::string::npos) end = job.pattern.size();
+    std::string input = job.pattern.substr(0, start) + "%0" + std::to_string(end - start) + "d" + job.pattern.substr(end);
+
+    std::string command = "ffmpeg -loglevel error -y -framerate " + std::to_string(job.frameRate) +
+        " -start_number " + std::to_string(job.firstFrame) + " -i " + shellQuote(input) +
+        " -frames:v " + std::to_string(job.lastFrame - job.firstFrame + 1) +
+        " -c:v libx264 -pix_fmt yuv420p " + shellQuote(job.video);
+    if (system(command.c_str()) != 0) {
+        std::cerr << "Failed to encode " << job.video << std::endl;
+        return false;
+    }
+    std::cout << "Encoded " << job.video << std::endl;
+    return true;
+}
+
+bool runFarm(const FarmJob& job) {
+    std::string name;
+    if (!frameFileName(job.pattern, job.firstFrame, name)) {
+        std::cerr << "The output name needs a run of '#' for the frame number: " << job.pattern << std::endl;
+        return false;
+    }
+    if (job.workers.empty() || job.lastFrame < job.firstFrame || job.chunkFrames <= 0) {
+        std::cerr << "Render farm needs workers and a frame range" << std::endl;
+        return false;
+    }
+
+    pendingChunks.clear();
+    completedFrames = 0;
+    farmFailed = false;
+    for (int f = job.firstFrame; f <= job.lastFrame; f += job.chunkFrames) {
+        FarmChunk chunk = { f, std::min(f + job.chunkFrames - 1, job.lastFrame), 0 };
+        pendingChunks.push_back(chunk);
+    }
+
+    std::vector<std::thread> slots;
+    for (size_t s = 0; s < job.workers.size(); ++s) slots.emplace_back(runSlot, &job, (int)s);
+    for (std::thread& t : slots) t.join();
+
+    if (farmFailed) return false;
+    return job.video.empty() || encodeVideo(job);
+}
@@ -0,0 +1,34 @@
+// Farm.h
+#pragma once
+#include <string>
+#include <vector>
+
+// Render farm for long ray-traced animations. Frame f is rendered at
+// simulation time start + f / fps, so it depends on nothing but its number
+// and any worker can render any frame. The coordinator splits the frame
+// range into chunks and hands them out as worker slots become free. Each
+// slot runs its worker command to completion and checks that every frame
+// of the chunk was written; failed chunks go back on the queue.
+const int FARM_CHUNK_FRAMES = 8;  // Default frames per chunk
+const int FARM_MAX_ATTEMPTS = 3;  // Tries per chunk before the farm gives up
+
+struct FarmJob {
+    std::vector<std::string> workers; // Command prefix per slot, e.g. the local executable or "ssh node2 solar_system"
+    std::string workerArgs;           // Quoted arguments every worker gets before --frames
+    std::string pattern;              // Output name with a run of '#' for the frame number
+    int firstFrame = 0;
+    int lastFrame = 0;                // Inclusive
+    int chunkFrames = FARM_CHUNK_FRAMES;
+    std::string video;                // Encode the finished frames to this file with ffmpeg (optional)
+    double frameRate = 60.0;
+};
+
+// Output file of one frame: the first run of '#' in the pattern replaced by
+// the zero-padded frame number. Returns false if the pattern has no '#'.
+bool frameFileName(const std::string& pattern, int frame, std::string& name);
+
+// Quote one argument for the platform's shell
+std::string shellQuote(const std::string& argument);
+
+// Render the whole range on the workers; false if any chunk kept failing
+bool runFarm(const FarmJob& job);
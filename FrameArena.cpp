@@ -0,0 +1,55 @@
+// FrameArena.cpp
+#include "FrameArena.h"
+#include <cstdint>
+#include <new>
+
+static unsigned char* arena = nullptr;
+static size_t capacity = 0;
+static size_t used = 0;
+static size_t overflowBytes = 0;             // Taken from the heap this frame
+static void* overflowBlocks = nullptr;       // Linked through their first bytes, so tracking them does not allocate
+static FrameArenaStats stats;
+
+void* frameAllocate(size_t bytes, size_t alignment) {
+    if (!arena) {
+        capacity = FRAME_ARENA_BYTES;
+        arena = static_cast<unsigned char*>(::operator new(capacity));
+    }
+    size_t start = (used + alignment - 1) & ~(alignment - 1);
+    if (start + bytes <= capacity) {
+        used = start + bytes;
+        return arena + start;
+    }
+
+    // Full: fall back to the heap until the arena grows at the next reset
+    size_t blockBytes = sizeof(void*) + bytes + alignment;
+    void* block = ::operator new(blockBytes);
+    *static_cast<void**>(block) = overflowBlocks;
+    overflowBlocks = block;
+    overflowBytes += blockBytes;
+    uintptr_t aligned = ((uintptr_t)block + sizeof(void*) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    return (void*)aligned;
+}
+
+void resetFrameArena() {
+    stats.usedBytes = used + overflowBytes;
+    if (stats.usedBytes > stats.highWaterBytes) stats.highWaterBytes = stats.usedBytes;
+
+    while (overflowBlocks) {
+        void* next = *static_cast<void**>(overflowBlocks);
+        ::operator delete(overflowBlocks);
+        overflowBlocks = next;
+    }
+    if (overflowBytes > 0) {
+        ::operator delete(arena);
+        capacity = stats.highWaterBytes + stats.highWaterBytes / 4;
+        arena = static_cast<unsigned char*>(::operator new(capacity));
+    }
+    stats.capacityBytes = capacity;
+    used = 0;
+    overflowBytes = 0;
+}
+
+FrameArenaStats frameArenaStats() {
+    return stats;
+}
@@ -0,0 +1,32 @@
+// FrameArena.h
+#pragma once
+#include <cstddef>
+
+// Linear allocator for data that lives for one frame: culling lists, draw
+// queues and other scratch arrays. Allocating bumps a pointer, and
+// resetFrameArena() at the end of display() releases everything at once.
+// A frame that needs more than the arena holds takes the rest from the heap,
+// and the arena grows to that frame's high-water mark at the next reset, so
+// steady state never allocates. Render thread only.
+const size_t FRAME_ARENA_BYTES = (size_t)1 << 20;
+
+struct FrameArenaStats {
+    size_t usedBytes = 0;      // By the last frame, overflow included
+    size_t capacityBytes = 0;
+    size_t highWaterBytes = 0;
+};
+
+// Uninitialized memory aligned to `alignment` (a power of two), valid until
+// the next reset
+void* frameAllocate(size_t bytes, size_t alignment = 16);
+
+// Uninitialized array of `count` T; T must not need a destructor
+template <typename T>
+T* frameArray(size_t count) {
+    return static_cast<T*>(frameAllocate(count * sizeof(T), alignof(T)));
+}
+
+// Release the frame's memory
+void resetFrameArena();
+
+FrameArenaStats frameArenaStats();
@@ -0,0 +1,72 @@
+// FramePacer.cpp
+#include "FramePacer.h"
+#include <chrono>
+#include <cmath>
+
+static double refreshPeriod = 1.0 / DEFAULT_REFRESH_RATE;
+static double nextDeadline = 0.0;
+static double lastFrameStart = 0.0;
+static float frameTimeMs = 0.0f;
+
+static double pendingInputTime = -1.0; // Oldest input not yet on screen
+static float lastLatencyMs = 0.0f;
+static float averageLatencyMs = 0.0f;
+
+double pacerNow() {
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void initFramePacer(double refreshRate) {
+    if (refreshRate <= 0.0) refreshRate = DEFAULT_REFRESH_RATE;
+    refreshPeriod = 1.0 / refreshRate;
+    nextDeadline = pacerNow();
+    lastFrameStart = nextDeadline;
+}
+
+double pacerRefreshRate() {
+    return 1.0 / refreshPeriod;
+}
+
+int pacerNextDelayMs() {
+    double now = pacerNow();
+    frameTimeMs = (float)((now - lastFrameStart) * 1000.0);
+    lastFrameStart = now;
+
+    nextDeadline += refreshPeriod;
+    if (nextDeadline < now - refreshPeriod) {
+        nextDeadline = now + refreshPeriod; // Too far behind to catch up
+    }
+
+    // Overshoot on one frame shortens the wait for the next
+    double wait = (nextDeadline - now) * 1000.0;
+    return wait > 0.0 ? (int)std::floor(wait) : 0;
+}
+
+float pacerFrameTimeMs() {
+    return frameTimeMs;
+}
+
+void markInput() {
+    if (pendingInputTime < 0.0) pendingInputTime = pacerNow();
+}
+
+void markFramePresented() {
+    if (pendingInputTime < 0.0) return;
+
+    lastLatencyMs = (float)((pacerNow() - pendingInputTime) * 1000.0);
+    averageLatencyMs = averageLatencyMs == 0.0f ? lastLatencyMs : 0.9f * averageLatencyMs + 0.1f * lastLatencyMs;
+    pendingInputTime = -1.0;
+}
+
+bool inputPending() {
+    return pendingInputTime >= 0.0;
+}
+
+float lastInputLatencyMs() {
+    return lastLatencyMs;
+}
+
+float averageInputLatencyMs() {
+    return averageLatencyMs;
+}
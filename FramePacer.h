@@ -0,0 +1,41 @@
+// FramePacer.h
+#pragma once
+
+// Frame pacing from a monotonic clock. Deadlines advance by exactly one
+// period from the previous deadline rather than from when the timer fired,
+// so timer jitter and the time spent in update() do not accumulate.
+const double DEFAULT_REFRESH_RATE = 60.0;
+
+// Fixed simulation step (seconds); the simulation no longer depends on
+// how often frames are drawn
+const double SIMULATION_STEP = 1.0 / 60.0;
+
+// Most simulation steps taken in one frame before dropping time (after a
+// stall, e.g. while the window is dragged)
+const int MAX_SIMULATION_STEPS = 8;
+
+// Set the target refresh rate in Hz and restart the deadline chain
+void initFramePacer(double refreshRate);
+
+double pacerRefreshRate();
+
+// Seconds on a monotonic clock
+double pacerNow();
+
+// Advance to the next deadline and return the milliseconds to wait for it,
+// for glutTimerFunc(). Falling more than a period behind resynchronizes.
+int pacerNextDelayMs();
+
+// Measured time between the last two paced frames, in milliseconds
+float pacerFrameTimeMs();
+
+// Input-to-photon latency: markInput() at an input event that changes the
+// view, markFramePresented() right after the swap that shows it
+void markInput();
+void markFramePresented();
+
+// Whether an input is waiting to be presented (the next swap is measured)
+bool inputPending();
+
+float lastInputLatencyMs();
+float averageInputLatencyMs();
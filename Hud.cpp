@@ -0,0 +1,263 @@
+// Hud.cpp
+#include "Hud.h"
+#include "PerfCounters.h"
+#include <cstdarg>
+#include <cstdio>
+#include <vector>
+
+// 5x7 font for ASCII 32..126, one byte per column, bit 0 = top row
+static const unsigned char hudFont[95 * 5] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, // ' '
+    0x00, 0x00, 0x5F, 0x00, 0x00, // '!'
+    0x00, 0x07, 0x00, 0x07, 0x00, // '"'
+    0x14, 0x7F, 0x14, 0x7F, 0x14, // '#'
+    0x24, 0x2A, 0x7F, 0x2A, 0x12, // '$'
+    0x23, 0x13, 0x08, 0x64, 0x62, // '%'
+    0x36, 0x49, 0x55, 0x22, 0x50, // '&'
+    0x00, 0x05, 0x03, 0x00, 0x00, // '''
+    0x00, 0x1C, 0x22, 0x41, 0x00, // '('
+    0x00, 0x41, 0x22, 0x1C, 0x00, // ')'
+    0x08, 0x2A, 0x1C, 0x2A, 0x08, // '*'
+    0x08, 0x08, 0x3E, 0x08, 0x08, // '+'
+    0x00, 0x50, 0x30, 0x00, 0x00, // ','
+    0x08, 0x08, 0x08, 0x08, 0x08, // '-'
+    0x00, 0x60, 0x60, 0x00, 0x00, // '.'
+    0x20, 0x10, 0x08, 0x04, 0x02, // '/'
+    0x3E, 0x51, 0x49, 0x45, 0x3E, // '0'
+    0x00, 0x42, 0x7F, 0x40, 0x00, // '1'
+    0x42, 0x61, 0x51, 0x49, 0x46, // '2'
+    0x21, 0x41, 0x45, 0x4B, 0x31, // '3'
+    0x18, 0x14, 0x12, 0x7F, 0x10, // '4'
+    0x27, 0x45, 0x45, 0x45, 0x39, // '5'
+    0x3C, 0x4A, 0x49, 0x49, 0x30, // '6'
+    0x01, 0x71, 0x09, 0x05, 0x03, // '7'
+    0x36, 0x49, 0x49, 0x49, 0x36, // '8'
+    0x06, 0x49, 0x49, 0x29, 0x1E, // '9'
+    0x00, 0x36, 0x36, 0x00, 0x00, // ':'
+    0x00, 0x56, 0x36, 0x00, 0x00, // ';'
+    0x08, 0x14, 0x22, 0x41, 0x00, // '<'
+    0x14, 0x14, 0x14, 0x14, 0x14, // '='
+    0x00, 0x41, 0x22, 0x14, 0x08, // '>'
+    0x02, 0x01, 0x51, 0x09, 0x06, // '?'
+    0x32, 0x49, 0x79, 0x41, 0x3E, // '@'
+    0x7E, 0x11, 0x11, 0x11, 0x7E, // 'A'
+    0x7F, 0x49, 0x49, 0x49, 0x36, // 'B'
+    0x3E, 0x41, 0x41, 0x41, 0x22, // 'C'
+    0x7F, 0x41, 0x41, 0x22, 0x1C, // 'D'
+    0x7F, 0x49, 0x49, 0x49, 0x41, // 'E'
+    0x7F, 0x09, 0x09, 0x09, 0x01, // 'F'
+    0x3E, 0x41, 0x49, 0x49, 0x7A, // 'G'
+    0x7F, 0x08, 0x08, 0x08, 0x7F, // 'H'
+    0x00, 0x41, 0x7F, 0x41, 0x00, // 'I'
+    0x20, 0x40, 0x41, 0x3F, 0x01, // 'J'
+    0x7F, 0x08, 0x14, 0x22, 0x41, // 'K'
+    0x7F, 0x40, 0x40, 0x40, 0x40, // 'L'
+    0x7F, 0x02, 0x0C, 0x02, 0x7F, // 'M'
+    0x7F, 0x04, 0x08, 0x10, 0x7F, // 'N'
+    0x3E, 0x41, 0x41, 0x41, 0x3E, // 'O'
+    0x7F, 0x09, 0x09, 0x09, 0x06, // 'P'
+    0x3E, 0x41, 0x51, 0x21, 0x5E, // 'Q'
+    0x7F, 0x09, 0x19, 0x29, 0x46, // 'R'
+    0x46, 0x49, 0x49, 0x49, 0x31, // 'S'
+    0x01, 0x01, 0x7F, 0x01, 0x01, // 'T'
+    0x3F, 0x40, 0x40, 0x40, 0x3F, // 'U'
+    0x1F, 0x20, 0x40, 0x20, 0x1F, // 'V'
+    0x3F, 0x40, 0x38, 0x40, 0x3F, // 'W'
+    0x63, 0x14, 0x08, 0x14, 0x63, // 'X'
+    0x07, 0x08, 0x70, 0x08, 0x07, // 'Y'
+    0x61, 0x51, 0x49, 0x45, 0x43, // 'Z'
+    0x00, 0x7F, 0x41, 0x41, 0x00, // '['
+    0x02, 0x04, 0x08, 0x10, 0x20, // '\'
+    0x00, 0x41, 0x41, 0x7F, 0x00, // ']'
+    0x04, 0x02, 0x01, 0x02, 0x04, // '^'
+    0x40, 0x40, 0x40, 0x40, 0x40, // '_'
+    0x00, 0x01, 0x02, 0x04, 0x00, // '`'
+    0x20, 0x54, 0x54, 0x54, 0x78, // 'a'
+    0x7F, 0x48, 0x44, 0x44, 0x38, // 'b'
+    0x38, 0x44, 0x44, 0x44, 0x20, // 'c'
+    0x38, 0x44, 0x44, 0x48, 0x7F, // 'd'
+    0x38, 0x54, 0x54, 0x54, 0x18, // 'e'
+    0x08, 0x7E, 0x09, 0x01, 0x02, // 'f'
+    0x0C, 0x52, 0x52, 0x52, 0x3E, // 'g'
+    0x7F, 0x08, 0x04, 0x04, 0x78, // 'h'
+    0x00, 0x44, 0x7D, 0x40, 0x00, // 'i'
+    0x20, 0x40, 0x44, 0x3D, 0x00, // 'j'
+    0x7F, 0x10, 0x28, 0x44, 0x00, // 'k'
+    0x00, 0x41, 0x7F, 0x40, 0x00, // 'l'
+    0x7C, 0x04, 0x18, 0x04, 0x78, // 'm'
+    0x7C, 0x08, 0x04, 0x04, 0x78, // 'n'
+    0x38, 0x44, 0x44, 0x44, 0x38, // 'o'
+    0x7C, 0x14, 0x14, 0x14, 0x08, // 'p'
+    0x08, 0x14, 0x14, 0x18, 0x7C, // 'q'
+    0x7C, 0x08, 0x04, 0x04, 0x08, // 'r'
+    0x48, 0x54, 0x54, 0x54, 0x20, // 's'
+    0x04, 0x3F, 0x44, 0x40, 0x20, // 't'
+    0x3C, 0x40, 0x40, 0x20, 0x7C, // 'u'
+    0x1C, 0x20, 0x40, 0x20, 0x1C, // 'v'
+    0x3C, 0x40, 0x30, 0x40, 0x3C, // 'w'
+    0x44, 0x28, 0x10, 0x28, 0x44, // 'x'
+    0x0C, 0x50, 0x50, 0x50, 0x3C, // 'y'
+    0x44, 0x64, 0x54, 0x4C, 0x44, // 'z'
+    0x00, 0x08, 0x36, 0x41, 0x00, // '{'
+    0x00, 0x00, 0x7F, 0x00, 0x00, // '|'
+    0x00, 0x41, 0x36, 0x08, 0x00, // '}'
+    0x08, 0x04, 0x08, 0x10, 0x08, // '~'
+};
+
+// Atlas layout: 16 x 6 cells; the last cell (ASCII 127) is solid for rectangles
+const int ATLAS_COLUMNS = 16;
+const int ATLAS_WIDTH = 128;
+const int ATLAS_HEIGHT = 64;
+const int SOLID_GLYPH = 127;
+
+struct HudVertex {
+    float x, y;
+    float u, v;
+    GLubyte color[4];
+};
+
+static GLuint atlasTexture = 0;
+static std::vector<HudVertex> hudVertices; // Reused every frame, never shrinks
+static int hudWidth = 0, hudHeight = 0;
+
+void initHud() {
+    unsigned char pixels[ATLAS_WIDTH * ATLAS_HEIGHT] = { 0 };
+    for (int c = 32; c < 128; ++c) {
+        int cellX = ((c - 32) % ATLAS_COLUMNS) * HUD_GLYPH_WIDTH;
+        int cellY = ((c - 32) / ATLAS_COLUMNS) * HUD_GLYPH_HEIGHT;
+        for (int col = 0; col < 5; ++col) {
+            unsigned char bits = c == SOLID_GLYPH ? 0x7F : hudFont[(c - 32) * 5 + col];
+            for (int row = 0; row < 7; ++row) {
+                if (bits & (1 << row)) {
+                    pixels[(cellY + row) * ATLAS_WIDTH + cellX + col] = 255;
+                }
+            }
+        }
+    }
+
+    glGenTextures(1, &atlasTexture);
+    glBindTexture(GL_TEXTURE_2D, atlasTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, ATLAS_WIDTH, ATLAS_HEIGHT, 0, GL_ALPHA, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    hudVertices.reserve(4 * 4096);
+}
+
+void hudBegin(int width, int height) {
+    hudVertices.clear();
+    hudWidth = width;
+    hudHeight = height;
+}
+
+// Append one textured quad covering the given atlas cell region
+static void pushQuad(float x, float y, float w, float h, int glyph, float cellW, float cellH,
+                     float r, float g, float b, float a) {
+    float u0 = (float)(((glyph - 32) % ATLAS_COLUMNS) * HUD_GLYPH_WIDTH) / ATLAS_WIDTH;
+    float v0 = (float)(((glyph - 32) / ATLAS_COLUMNS) * HUD_GLYPH_HEIGHT) / ATLAS_HEIGHT;
+    float u1 = u0 + cellW / ATLAS_WIDTH;
+    float v1 = v0 + cellH / ATLAS_HEIGHT;
+    GLubyte rgba[4] = { (GLubyte)(r * 255.0f), (GLubyte)(g * 255.0f), (GLubyte)(b * 255.0f), (GLubyte)(a * 255.0f) };
+
+    HudVertex quad[4] = {
+        { x,     y,     u0, v0, { rgba[0], rgba[1], rgba[2], rgba[3] } },
+        { x + w, y,     u1, v0, { rgba[0], rgba[1], rgba[2], rgba[3] } },
+        { x + w, y + h, u1, v1, { rgba[0], rgba[1], rgba[2], rgba[3] } },
+        { x,     y + h, u0, v1, { rgba[0], rgba[1], rgba[2], rgba[3] } }
+    };
+    hudVertices.insert(hudVertices.end(), quad, quad + 4);
+}
+
+void hudText(float x, float y, float scale, float r, float g, float b, const char* text) {
+    float penX = x;
+    for (const char* c = text; *c; ++c) {
+        if (*c == '\n') {
+            penX = x;
+            y += HUD_GLYPH_HEIGHT * scale;
+            continue;
+        }
+        if (*c > 32 && *c < 127) {
+            pushQuad(penX, y, 5.0f * scale, 7.0f * scale, *c, 5.0f, 7.0f, r, g, b, 1.0f);
+        }
+        penX += HUD_GLYPH_WIDTH * scale;
+    }
+}
+
+void hudPrintf(float x, float y, float scale, float r, float g, float b, const char* format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    hudText(x, y, scale, r, g, b, buffer);
+}
+
+void hudRect(float x, float y, float w, float h, float r, float g, float b, float a) {
+    // Sample the middle of the solid cell so filtering never reaches its edge
+    float u = (float)(((SOLID_GLYPH - 32) % ATLAS_COLUMNS) * HUD_GLYPH_WIDTH + 2) / ATLAS_WIDTH;
+    float v = (float)(((SOLID_GLYPH - 32) / ATLAS_COLUMNS) * HUD_GLYPH_HEIGHT + 3) / ATLAS_HEIGHT;
+    GLubyte rgba[4] = { (GLubyte)(r * 255.0f), (GLubyte)(g * 255.0f), (GLubyte)(b * 255.0f), (GLubyte)(a * 255.0f) };
+    HudVertex quad[4] = {
+        { x,     y,     u, v, { rgba[0], rgba[1], rgba[2], rgba[3] } },
+        { x + w, y,     u, v, { rgba[0], rgba[1], rgba[2], rgba[3] } },
+        { x + w, y + h, u, v, { rgba[0], rgba[1], rgba[2], rgba[3] } },
+        { x,     y + h, u, v, { rgba[0], rgba[1], rgba[2], rgba[3] } }
+    };
+    hudVertices.insert(hudVertices.end(), quad, quad + 4);
+}
+
+float hudTextWidth(const char* text, float scale) {
+    int longest = 0, current = 0;
+    for (const char* c = text; *c; ++c) {
+        current = *c == '\n' ? 0 : current + 1;
+        if (current > longest) longest = current;
+    }
+    return longest * HUD_GLYPH_WIDTH * scale;
+}
+
+void hudFlush() {
+    if (hudVertices.empty()) return;
+
+    glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_TEXTURE_BIT);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, atlasTexture);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0.0, hudWidth, hudHeight, 0.0, -1.0, 1.0);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    const HudVertex* base = hudVertices.data();
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_FLOAT, sizeof(HudVertex), &base->x);
+    glTexCoordPointer(2, GL_FLOAT, sizeof(HudVertex), &base->u);
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(HudVertex), base->color);
+    glDrawArrays(GL_QUADS, 0, (GLsizei)hudVertices.size());
+    perfCount(PERF_TEXTURE_BINDS);
+    perfCount(PERF_DRAW_CALLS);
+    perfCount(PERF_TRIANGLES, (int)hudVertices.size() / 2);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glPopAttrib();
+}
@@ -0,0 +1,32 @@
+// Hud.h
+#pragma once
+#include <GL/glew.h>
+
+// Batched screen-space text and rectangles. Glyphs from an embedded 5x7
+// bitmap font are baked into one atlas texture at startup; every hudText()
+// and hudRect() call for a frame appends quads to a single vertex array,
+// and hudFlush() draws the whole batch with one glDrawArrays call.
+// Coordinates are in pixels with the origin at the top-left corner.
+const int HUD_GLYPH_WIDTH = 6;  // Glyph cell width in pixels (including spacing)
+const int HUD_GLYPH_HEIGHT = 8; // Glyph cell height in pixels (including spacing)
+
+// Bake the font atlas
+void initHud();
+
+// Start a new batch for a window of the given size
+void hudBegin(int width, int height);
+
+// Queue a line of ASCII text; scale is an integer-friendly pixel multiplier
+void hudText(float x, float y, float scale, float r, float g, float b, const char* text);
+
+// Queue printf-style text
+void hudPrintf(float x, float y, float scale, float r, float g, float b, const char* format, ...);
+
+// Queue a solid rectangle
+void hudRect(float x, float y, float w, float h, float r, float g, float b, float a);
+
+// Width in pixels of a line of text
+float hudTextWidth(const char* text, float scale);
+
+// Draw everything queued since hudBegin() in one call
+void hudFlush();
@@ -0,0 +1,184 @@
+// Image.cpp
+#include "Image.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static void putU32BE(std::vector<unsigned char>& out, uint32_t v) {
+    out.push_back((unsigned char)(v >> 24));
+    out.push_back((unsigned char)(v >> 16));
+    out.push_back((unsigned char)(v >> 8));
+    out.push_back((unsigned char)v);
+}
+
+static uint32_t crc32(const unsigned char* data, size_t size) {
+    static uint32_t table[256];
+    if (!table[1]) {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+    }
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) c = table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+// Append a chunk: length, type, data, CRC of type and data
+static void putChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data) {
+    putU32BE(out, (uint32_t)data.size());
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    putU32BE(out, crc32(&out[start], out.size() - start));
+}
+
+void encodePNG(int width, int height, const unsigned char* rgb, std::vector<unsigned char>& png) {
+    png.assign({ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' });
+
+    std::vector<unsigned char> header;
+    putU32BE(header, (uint32_t)width);
+    putU32BE(header, (uint32_t)height);
+    const unsigned char format[5] = { 8, 2, 0, 0, 0 }; // 8-bit RGB, no interlace
+    header.insert(header.end(), format, format + 5);
+    putChunk(png, "IHDR", header);
+
+    // Each row is filter byte 0 followed by the pixels
+    size_t rowSize = (size_t)width * 3 + 1;
+    std::vector<unsigned char> raw(rowSize * height);
+    for (int y = 0; y < height; ++y) {
+        raw[y * rowSize] = 0;
+        memcpy(&raw[y * rowSize + 1], rgb + (size_t)y * width * 3, rowSize - 1);
+    }
+
+    // zlib stream of stored deflate blocks (at most 65535 bytes each)
+    std::vector<unsigned char> zlib = { 0x78, 0x01 };
+    uint32_t a = 1, b = 0;
+    size_t pos = 0;
+    do {
+        size_t size = std::min<size_t>(raw.size() - pos, 65535);
+        bool last = pos + size == raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back((unsigned char)size);
+        zlib.push_back((unsigned char)(size >> 8));
+        zlib.push_back((unsigned char)~size);
+        zlib.push_back((unsigned char)(~size >> 8));
+        zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + size);
+        for (size_t i = pos; i < pos + size; ++i) {
+            a = (a + raw[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        pos += size;
+    } while (pos < raw.size());
+    putU32BE(zlib, (b << 16) | a);
+    putChunk(png, "IDAT", zlib);
+    putChunk(png, "IEND", std::vector<unsigned char>());
+}
+
+bool writePNG(const char* path, int width, int height, const unsigned char* rgb) {
+    std::vector<unsigned char> png;
+    encodePNG(width, height, rgb, png);
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        std::cerr << "Failed to open image file: " << path << std::endl;
+        return false;
+    }
+    bool ok = fwrite(png.data(), 1, png.size(), file) == png.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok) std::cerr << "Failed to write image file: " << path << std::endl;
+    return ok;
+}
+
+// EXR is little-endian throughout
+static void putLE(std::vector<unsigned char>& out, const void* value, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)value;
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+static void putAttribute(std::vector<unsigned char>& out, const char* name, const char* type,
+    const std::vector<unsigned char>& value) {
+    out.insert(out.end(), name, name + strlen(name) + 1);
+    out.insert(out.end(), type, type + strlen(type) + 1);
+    int32_t size = (int32_t)value.size();
+    putLE(out, &size, 4);
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+bool writeEXR(const char* path, int width, int height, const float* rgb) {
+    std::vector<unsigned char> exr = { 0x76, 0x2F, 0x31, 0x01, 2, 0, 0, 0 };
+
+    // Channels are stored in alphabetical order, all FLOAT
+    std::vector<unsigned char> channels;
+    const char* names[3] = { "B", "G", "R" };
+    for (const char* name : names) {
+        channels.insert(channels.end(), name, name + 2);
+        int32_t fields[4] = { 2, 0, 1, 1 }; // Pixel type, pLinear + reserved, x and y sampling
+        putLE(channels, fields, sizeof(fields));
+    }
+    channels.push_back(0);
+    putAttribute(exr, "channels", "chlist", channels);
+    putAttribute(exr, "compression", "compression", std::vector<unsigned char>(1, 0));
+
+    std::vector<unsigned char> window;
+    int32_t box[4] = { 0, 0, width - 1, height - 1 };
+    putLE(window, box, sizeof(box));
+    putAttribute(exr, "dataWindow", "box2i", window);
+    putAttribute(exr, "displayWindow", "box2i", window);
+    putAttribute(exr, "lineOrder", "lineOrder", std::vector<unsigned char>(1, 0));
+
+    std::vector<unsigned char> value;
+    float one = 1.0f, center[2] = { 0.0f, 0.0f };
+    putLE(value, &one, 4);
+    putAttribute(exr, "pixelAspectRatio", "float", value);
+    putAttribute(exr, "screenWindowWidth", "float", value);
+    value.clear();
+    putLE(value, center, sizeof(center));
+    putAttribute(exr, "screenWindowCenter", "v2f", value);
+    exr.push_back(0); // End of header
+
+    // Offset table, then one scanline per block: y, byte count, B, G, R rows
+    int32_t lineBytes = width * 3 * 4;
+    uint64_t offset = exr.size() + (uint64_t)height * 8;
+    for (int y = 0; y < height; ++y) {
+        putLE(exr, &offset, 8);
+        offset += 8 + lineBytes;
+    }
+    std::vector<float> plane(width);
+    for (int32_t y = 0; y < height; ++y) {
+        putLE(exr, &y, 4);
+        putLE(exr, &lineBytes, 4);
+        for (int c = 2; c >= 0; --c) {
+            for (int x = 0; x < width; ++x) plane[x] = rgb[((size_t)y * width + x) * 3 + c];
+            putLE(exr, plane.data(), width * 4);
+        }
+    }
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        std::cerr << "Failed to open image file: " << path << std::endl;
+        return false;
+    }
+    bool ok = fwrite(exr.data(), 1, exr.size(), file) == exr.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok) std::cerr << "Failed to write image file: " << path << std::endl;
+    return ok;
+}
+
+bool writeImage(const char* path, int width, int height, const float* rgb) {
+    std::string name(path);
+    if (name.size() >= 4 && name.compare(name.size() - 4, 4, ".exr") == 0) {
+        return writeEXR(path, width, height, rgb);
+    }
+
+    std::vector<unsigned char> bytes((size_t)width * height * 3);
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = (unsigned char)(std::min(std::max(rgb[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+    return writePNG(path, width, height, bytes.data());
+}
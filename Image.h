@@ -0,0 +1,16 @@
+// Image.h
+#pragma once
+#include <vector>
+
+// Still image output. Pixels are RGB with rows top-down.
+
+// 8-bit PNG, stored without compression so no zlib is needed
+void encodePNG(int width, int height, const unsigned char* rgb, std::vector<unsigned char>& png);
+bool writePNG(const char* path, int width, int height, const unsigned char* rgb);
+
+// Linear 32-bit float OpenEXR, scanline and uncompressed
+bool writeEXR(const char* path, int width, int height, const float* rgb);
+
+// Linear float image: EXR for paths ending in ".exr", otherwise PNG with
+// values clamped to [0, 1]
+bool writeImage(const char* path, int width, int height, const float* rgb);
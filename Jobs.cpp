@@ -0,0 +1,205 @@
+// Jobs.cpp
+#include "Jobs.h"
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+
+struct Worker {
+    std::mutex lock;
+    std::vector<Job> jobs;                // Ring of JOB_QUEUE_CAPACITY, allocated by initJobs()
+    unsigned head = 0, tail = 0;          // Owner uses the tail, thieves the head
+    std::atomic<long long> busyNanos{ 0 };
+};
+
+static Worker workers[MAX_JOB_WORKERS];
+static std::vector<std::thread> threads;
+static int workerCount = 1;
+static std::atomic<bool> running{ false };
+static std::atomic<int> queuedJobs{ 0 };
+static std::mutex sleepLock;
+static std::condition_variable wakeUp;
+static std::chrono::steady_clock::time_point statsStart = std::chrono::steady_clock::now();
+static thread_local int currentWorker = 0;
+
+static void execute(int self, const Job& job);
+
+static void pushJob(const Job& job) {
+    Worker& w = workers[currentWorker];
+    bool queued;
+    {
+        std::lock_guard<std::mutex> guard(w.lock);
+        queued = w.tail - w.head < (unsigned)w.jobs.size();
+        if (queued) w.jobs[w.tail++ % JOB_QUEUE_CAPACITY] = job;
+    }
+    if (!queued) {
+        execute(currentWorker, job); // Full (or not started): run it here instead of growing the ring
+        return;
+    }
+    queuedJobs.fetch_add(1);
+    {
+        // Taking the lock orders this wake-up after a sleeper's check
+        std::lock_guard<std::mutex> guard(sleepLock);
+    }
+    wakeUp.notify_one();
+}
+
+// Pop from our own deque, otherwise steal from another worker's
+static bool findJob(int self, Job& job) {
+    {
+        Worker& w = workers[self];
+        std::lock_guard<std::mutex> guard(w.lock);
+        if (w.tail != w.head) {
+            job = w.jobs[--w.tail % JOB_QUEUE_CAPACITY];
+            queuedJobs.fetch_sub(1);
+            return true;
+        }
+    }
+    for (int i = 1; i < workerCount; ++i) {
+        Worker& victim = workers[(self + i) % workerCount];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (victim.tail != victim.head) {
+            job = victim.jobs[victim.head++ % JOB_QUEUE_CAPACITY];
+            queuedJobs.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Decrement a counter and release its continuations when it reaches zero.
+// The counter's lock is held throughout so a waiter that sees zero and then
+// takes the lock knows the counter is no longer being touched.
+static void finishJob(JobCounter* counter) {
+    Job waiting[JOB_INLINE_CONTINUATIONS];
+    int waitingCount = 0;
+    std::vector<Job> ready;
+    {
+        std::lock_guard<std::mutex> guard(counter->lock);
+        if (counter->pending.fetch_sub(1) == 1) {
+            waitingCount = counter->waitingCount;
+            for (int i = 0; i < waitingCount; ++i) waiting[i] = counter->waiting[i];
+            counter->waitingCount = 0;
+            ready.swap(counter->continuations);
+        }
+    }
+    for (int i = 0; i < waitingCount; ++i) {
+        pushJob(waiting[i]);
+    }
+    for (const Job& job : ready) {
+        pushJob(job);
+    }
+}
+
+static void execute(int self, const Job& job) {
+    auto start = std::chrono::steady_clock::now();
+    job.function(job.data, job.begin, job.end);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    workers[self].busyNanos.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+
+    if (job.counter) finishJob(job.counter);
+}
+
+static void workerLoop(int self) {
+    currentWorker = self;
+    while (running.load()) {
+        Job job;
+        if (findJob(self, job)) {
+            execute(self, job);
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(sleepLock);
+        wakeUp.wait(guard, [] { return queuedJobs.load() > 0 || !running.load(); });
+    }
+}
+
+void initJobs(int count) {
+    shutdownJobs();
+
+    if (count <= 0) count = (int)std::thread::hardware_concurrency();
+    if (count < 1) count = 1;
+    if (count > MAX_JOB_WORKERS) count = MAX_JOB_WORKERS;
+
+    workerCount = count;
+    currentWorker = 0;
+    for (int i = 0; i < count; ++i) {
+        workers[i].jobs.resize(JOB_QUEUE_CAPACITY);
+    }
+    running = true;
+    for (int i = 1; i < count; ++i) {
+        threads.emplace_back(workerLoop, i);
+    }
+    resetJobStats();
+}
+
+void shutdownJobs() {
+    if (threads.empty()) return;
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        running = false;
+    }
+    wakeUp.notify_all();
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    threads.clear();
+    workerCount = 1;
+}
+
+int jobWorkerCount() {
+    return workerCount;
+}
+
+void runJob(JobFunction function, void* data, int begin, int end, JobCounter* counter) {
+    if (counter) counter->pending.fetch_add(1);
+    pushJob(Job{ function, data, begin, end, counter });
+}
+
+void runJobAfter(JobCounter* dependency, JobFunction function, void* data, int begin, int end, JobCounter* counter) {
+    if (counter) counter->pending.fetch_add(1);
+    Job job{ function, data, begin, end, counter };
+    {
+        std::lock_guard<std::mutex> guard(dependency->lock);
+        if (dependency->pending.load() > 0) {
+            if (dependency->waitingCount < JOB_INLINE_CONTINUATIONS) dependency->waiting[dependency->waitingCount++] = job;
+            else dependency->continuations.push_back(job);
+            return;
+        }
+    }
+    pushJob(job);
+}
+
+void parallelFor(int count, int grain, JobFunction function, void* data, JobCounter* counter) {
+    if (grain < 1) grain = 1;
+    for (int begin = 0; begin < count; begin += grain) {
+        int end = begin + grain < count ? begin + grain : count;
+        runJob(function, data, begin, end, counter);
+    }
+}
+
+void waitForCounter(JobCounter* counter) {
+    while (counter->pending.load() > 0) {
+        Job job;
+        if (findJob(currentWorker, job)) {
+            execute(currentWorker, job);
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+    std::lock_guard<std::mutex> guard(counter->lock); // See finishJob()
+}
+
+float jobWorkerUtilization(int worker) {
+    if (worker < 0 || worker >= workerCount) return 0.0f;
+    auto window = std::chrono::steady_clock::now() - statsStart;
+    long long windowNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(window).count();
+    if (windowNanos <= 0) return 0.0f;
+    return (float)workers[worker].busyNanos.load() / (float)windowNanos;
+}
+
+void resetJobStats() {
+    for (int i = 0; i < workerCount; ++i) {
+        workers[i].busyNanos = 0;
+    }
+    statsStart = std::chrono::steady_clock::now();
+}
@@ -0,0 +1,63 @@
+// Jobs.h
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// Small work-stealing job system. Every worker (the calling thread is
+// worker 0) owns a fixed ring of queued jobs: it pushes and pops jobs at
+// the back, and idle workers steal from the front of the others. A job
+// pushed onto a full ring runs at once on the pushing thread, so queuing
+// never allocates. Completion is tracked with JobCounters; a job can be
+// held back until a counter reaches zero, which is how per-frame
+// dependencies are expressed. A range that depends on a counter is queued
+// as one held-back job that calls parallelFor when it runs.
+const int MAX_JOB_WORKERS = 64;
+const unsigned JOB_QUEUE_CAPACITY = 4096; // Per worker; a power of two
+const int JOB_INLINE_CONTINUATIONS = 4;   // Held-back jobs a counter stores without allocating
+
+typedef void (*JobFunction)(void* data, int begin, int end);
+
+struct JobCounter;
+
+struct Job {
+    JobFunction function;
+    void* data;
+    int begin, end;
+    JobCounter* counter; // Decremented when the job finishes (may be null)
+};
+
+// Number of unfinished jobs in a group, plus the jobs waiting on it
+struct JobCounter {
+    std::atomic<int> pending{ 0 };
+    std::mutex lock;
+    Job waiting[JOB_INLINE_CONTINUATIONS]; // The first continuations
+    int waitingCount = 0;
+    std::vector<Job> continuations;        // Any beyond those
+};
+
+// Start the worker threads; 0 picks one per hardware thread
+void initJobs(int workerCount = 0);
+
+// Stop and join the worker threads
+void shutdownJobs();
+
+int jobWorkerCount();
+
+// Queue function(data, begin, end) on the calling worker
+void runJob(JobFunction function, void* data, int begin, int end, JobCounter* counter);
+
+// Queue a job that starts only once `dependency` reaches zero
+void runJobAfter(JobCounter* dependency, JobFunction function, void* data, int begin, int end, JobCounter* counter);
+
+// Split [0, count) into chunks of at most `grain` items, one job each
+void parallelFor(int count, int grain, JobFunction function, void* data, JobCounter* counter);
+
+// Run queued jobs on this thread until the counter reaches zero
+void waitForCounter(JobCounter* counter);
+
+// Fraction of wall time worker w spent running jobs since the last reset
+float jobWorkerUtilization(int worker);
+
+// Start a new utilization measurement window (once per frame)
+void resetJobStats();
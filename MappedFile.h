@@ -0,0 +1,19 @@
+// MappedFile.h
+#pragma once
+#include <cstddef>
+
+// Read-only memory mapping of a whole file
+struct MappedFile {
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+// Map a file for reading; prints an error and returns false on failure
+bool mapFile(const char* path, MappedFile& file);
+
+// Release a mapping created by mapFile()
+void unmapFile(MappedFile& file);
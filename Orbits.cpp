@@ -0,0 +1,188 @@
+// Orbits.cpp
+#include "Orbits.h"
+#include "PerfCounters.h"
+#include <cmath>
+#include <vector>
+
+struct OrbitPath {
+    float c[3]; // Center
+    float u[3]; // Semi-axis at t = 0
+    float v[3]; // Semi-axis at t = pi / 2
+};
+
+static std::vector<OrbitPath> orbits;
+
+// Cached tessellation (all orbits packed into one vertex array)
+static std::vector<float> orbitVertices;
+static std::vector<GLint> orbitFirst;
+static std::vector<GLsizei> orbitCount;
+static GLuint orbitVBO = 0;
+static bool orbitsDirty = true;
+
+// View the cache was built for
+static float cachedMVP[16];
+static GLint cachedViewport[4];
+
+// Matrices for the rebuild in progress
+static float mvp[16];
+static float halfWidth, halfHeight;
+
+int addOrbit(float cx, float cy, float cz,
+             float ux, float uy, float uz,
+             float vx, float vy, float vz) {
+    OrbitPath o = { { cx, cy, cz }, { ux, uy, uz }, { vx, vy, vz } };
+    orbits.push_back(o);
+    orbitsDirty = true;
+    return (int)orbits.size() - 1;
+}
+
+void clearOrbits() {
+    orbits.clear();
+    orbitsDirty = true;
+}
+
+// Point on the ellipse and its clip-space position
+static void evalOrbit(const OrbitPath& o, float t, float* world, float* clip) {
+    float ct = cosf(t), st = sinf(t);
+    for (int k = 0; k < 3; ++k) {
+        world[k] = o.c[k] + o.u[k] * ct + o.v[k] * st;
+    }
+    for (int r = 0; r < 4; ++r) {
+        clip[r] = mvp[r] * world[0] + mvp[4 + r] * world[1] + mvp[8 + r] * world[2] + mvp[12 + r];
+    }
+}
+
+// True when all points lie outside the same frustum plane
+static bool outsideFrustum(const float* a, const float* b, const float* m) {
+    for (int axis = 0; axis < 3; ++axis) {
+        if (a[axis] > a[3] && b[axis] > b[3] && m[axis] > m[3]) return true;
+        if (a[axis] < -a[3] && b[axis] < -b[3] && m[axis] < -m[3]) return true;
+    }
+    return false;
+}
+
+// Emit the start of the arc [t0, t1], splitting while it is visibly curved
+static void tessellateArc(const OrbitPath& o, float t0, const float* clip0,
+                          float t1, const float* clip1, int depth) {
+    float tm = 0.5f * (t0 + t1);
+    float world[3], clipM[4];
+    evalOrbit(o, tm, world, clipM);
+
+    bool split = false;
+    if (depth < ORBIT_MAX_DEPTH && !outsideFrustum(clip0, clip1, clipM)) {
+        if (clip0[3] <= 0.0f || clip1[3] <= 0.0f || clipM[3] <= 0.0f) {
+            split = true; // Crosses the eye plane: refine toward the camera
+        }
+        else {
+            // Distance in pixels between the projected arc midpoint and the chord midpoint
+            float ax = clip0[0] / clip0[3], ay = clip0[1] / clip0[3];
+            float bx = clip1[0] / clip1[3], by = clip1[1] / clip1[3];
+            float mx = clipM[0] / clipM[3], my = clipM[1] / clipM[3];
+            float dx = (mx - 0.5f * (ax + bx)) * halfWidth;
+            float dy = (my - 0.5f * (ay + by)) * halfHeight;
+            split = dx * dx + dy * dy > ORBIT_PIXEL_TOLERANCE * ORBIT_PIXEL_TOLERANCE;
+        }
+    }
+
+    if (split) {
+        tessellateArc(o, t0, clip0, tm, clipM, depth + 1);
+        tessellateArc(o, tm, clipM, t1, clip1, depth + 1);
+    }
+    else {
+        float ct = cosf(t0), st = sinf(t0);
+        for (int k = 0; k < 3; ++k) {
+            orbitVertices.push_back(o.c[k] + o.u[k] * ct + o.v[k] * st);
+        }
+    }
+}
+
+// Has the view changed enough to make the cached tessellation visibly wrong?
+static bool viewChanged(const float* newMVP, const GLint* viewport) {
+    for (int i = 0; i < 4; ++i) {
+        if (viewport[i] != cachedViewport[i]) return true;
+    }
+    float scale = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+        scale = fmaxf(scale, fabsf(newMVP[i]));
+    }
+    for (int i = 0; i < 16; ++i) {
+        if (fabsf(newMVP[i] - cachedMVP[i]) > 1e-3f * scale) return true;
+    }
+    return false;
+}
+
+void updateOrbitTessellation() {
+    float modelview[16], projection[16];
+    GLint viewport[4];
+    glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+    glGetFloatv(GL_PROJECTION_MATRIX, projection);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    // mvp = projection * modelview (column-major)
+    float newMVP[16];
+    for (int c = 0; c < 4; ++c) {
+        for (int r = 0; r < 4; ++r) {
+            newMVP[c * 4 + r] = projection[r] * modelview[c * 4] + projection[4 + r] * modelview[c * 4 + 1]
+                              + projection[8 + r] * modelview[c * 4 + 2] + projection[12 + r] * modelview[c * 4 + 3];
+        }
+    }
+
+    if (!orbitsDirty && !viewChanged(newMVP, viewport)) return;
+
+    for (int i = 0; i < 16; ++i) mvp[i] = cachedMVP[i] = newMVP[i];
+    for (int i = 0; i < 4; ++i) cachedViewport[i] = viewport[i];
+    halfWidth = 0.5f * viewport[2];
+    halfHeight = 0.5f * viewport[3];
+
+    orbitVertices.clear();
+    orbitFirst.clear();
+    orbitCount.clear();
+
+    const float step = 6.28318531f / ORBIT_BASE_SEGMENTS;
+    for (size_t i = 0; i < orbits.size(); ++i) {
+        const OrbitPath& o = orbits[i];
+        GLint first = (GLint)(orbitVertices.size() / 3);
+
+        float world[3], clip0[4], clip1[4];
+        evalOrbit(o, 0.0f, world, clip0);
+        for (int s = 0; s < ORBIT_BASE_SEGMENTS; ++s) {
+            float t0 = s * step, t1 = (s + 1) * step;
+            evalOrbit(o, t1, world, clip1);
+            tessellateArc(o, t0, clip0, t1, clip1, 0);
+            for (int k = 0; k < 4; ++k) clip0[k] = clip1[k];
+        }
+
+        orbitFirst.push_back(first);
+        orbitCount.push_back((GLsizei)(orbitVertices.size() / 3) - first);
+    }
+
+    if (!orbitVBO) glGenBuffers(1, &orbitVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, orbitVBO);
+    glBufferData(GL_ARRAY_BUFFER, orbitVertices.size() * sizeof(float), orbitVertices.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    orbitsDirty = false;
+}
+
+void drawOrbits() {
+    if (orbitFirst.empty()) return;
+
+    glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_TEXTURE_2D);
+    glColor3f(0.35f, 0.35f, 0.4f);
+
+    glBindBuffer(GL_ARRAY_BUFFER, orbitVBO);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, (const void*)0);
+    glMultiDrawArrays(GL_LINE_LOOP, orbitFirst.data(), orbitCount.data(), (GLsizei)orbitFirst.size());
+    perfCount(PERF_DRAW_CALLS);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glPopAttrib();
+}
+
+int orbitVertexCount() {
+    return (int)(orbitVertices.size() / 3);
+}
@@ -0,0 +1,32 @@
+// Orbits.h
+#pragma once
+#include <GL/glew.h>
+
+// Orbit ellipses are P(t) = center + u * cos(t) + v * sin(t), so any
+// inclined or eccentric orbit can be described by its two semi-axis vectors.
+// Each ellipse is tessellated from its projected curvature: segments are
+// split until the arc deviates less than ORBIT_PIXEL_TOLERANCE from the
+// chord on screen, so close parts get many segments and far or off-screen
+// parts get few.
+const float ORBIT_PIXEL_TOLERANCE = 0.75f; // Max on-screen chord error in pixels
+const int ORBIT_BASE_SEGMENTS = 8;         // Segments before any subdivision
+const int ORBIT_MAX_DEPTH = 9;             // Max subdivision depth per base segment
+
+// Register an orbit and return its index
+int addOrbit(float cx, float cy, float cz,
+             float ux, float uy, float uz,
+             float vx, float vy, float vz);
+
+// Remove every orbit
+void clearOrbits();
+
+// Re-tessellate the cached orbit lines if the current modelview/projection
+// or viewport moved far enough since the last rebuild. Call with the camera
+// transform loaded.
+void updateOrbitTessellation();
+
+// Draw all cached orbit lines in one call
+void drawOrbits();
+
+// Number of line vertices in the current tessellation
+int orbitVertexCount();
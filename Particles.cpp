@@ -0,0 +1,101 @@
+// Particles.cpp
+#include "Particles.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PARTICLES_SSE2 1
+#endif
+
+// Keeps the force finite for a particle passing through the Sun
+const float PARTICLE_MIN_RADIUS_SQUARED = 1e-4f;
+
+void initParticleSystem(ParticleSystem& system, int capacity) {
+    capacity = (capacity + 3) & ~3;
+    system.pool.assign((size_t)capacity * 8, 0.0f);
+    float* column = system.pool.data();
+    system.posX = column;
+    system.posY = column + capacity;
+    system.posZ = column + 2 * capacity;
+    system.velX = column + 3 * capacity;
+    system.velY = column + 4 * capacity;
+    system.velZ = column + 5 * capacity;
+    system.age = column + 6 * capacity;
+    system.life = column + 7 * capacity;
+    system.count = 0;
+    system.capacity = capacity;
+}
+
+int reserveParticles(ParticleSystem& system, int wanted, int& first) {
+    int granted = wanted < system.capacity - system.count ? wanted : system.capacity - system.count;
+    if (granted < 0) granted = 0;
+    first = system.count;
+    system.count += granted;
+    return granted;
+}
+
+void advanceParticles(ParticleSystem& system, float dt, int begin, int end) {
+    float* x = system.posX;
+    float* y = system.posY;
+    float* z = system.posZ;
+    float* vx = system.velX;
+    float* vy = system.velY;
+    float* vz = system.velZ;
+    float* age = system.age;
+    const float impulse = system.radialAcceleration * dt;
+
+    // Semi-implicit Euler: v += a dt, then x += v dt
+    int i = begin;
+#ifdef PARTICLES_SSE2
+    const __m128 k = _mm_set1_ps(impulse);
+    const __m128 h = _mm_set1_ps(dt);
+    const __m128 minR2 = _mm_set1_ps(PARTICLE_MIN_RADIUS_SQUARED);
+    for (; i + 4 <= end; i += 4) {
+        __m128 px = _mm_loadu_ps(x + i), py = _mm_loadu_ps(y + i), pz = _mm_loadu_ps(z + i);
+        __m128 r2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, px), _mm_mul_ps(py, py)), _mm_mul_ps(pz, pz));
+        r2 = _mm_max_ps(r2, minR2);
+        __m128 f = _mm_div_ps(k, _mm_mul_ps(r2, _mm_sqrt_ps(r2))); // k / r^3
+        __m128 qx = _mm_add_ps(_mm_loadu_ps(vx + i), _mm_mul_ps(f, px));
+        __m128 qy = _mm_add_ps(_mm_loadu_ps(vy + i), _mm_mul_ps(f, py));
+        __m128 qz = _mm_add_ps(_mm_loadu_ps(vz + i), _mm_mul_ps(f, pz));
+        _mm_storeu_ps(vx + i, qx);
+        _mm_storeu_ps(vy + i, qy);
+        _mm_storeu_ps(vz + i, qz);
+        _mm_storeu_ps(x + i, _mm_add_ps(px, _mm_mul_ps(qx, h)));
+        _mm_storeu_ps(y + i, _mm_add_ps(py, _mm_mul_ps(qy, h)));
+        _mm_storeu_ps(z + i, _mm_add_ps(pz, _mm_mul_ps(qz, h)));
+        _mm_storeu_ps(age + i, _mm_add_ps(_mm_loadu_ps(age + i), h));
+    }
+#endif
+    for (; i < end; ++i) {
+        float r2 = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+        if (r2 < PARTICLE_MIN_RADIUS_SQUARED) r2 = PARTICLE_MIN_RADIUS_SQUARED;
+        float f = impulse / (r2 * sqrtf(r2));
+        vx[i] += f * x[i];
+        vy[i] += f * y[i];
+        vz[i] += f * z[i];
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+        z[i] += vz[i] * dt;
+        age[i] += dt;
+    }
+}
+
+int compactParticles(ParticleSystem& system) {
+    float* columns[8] = { system.posX, system.posY, system.posZ, system.velX,
+        system.velY, system.velZ, system.age, system.life };
+    int count = system.count;
+    int i = 0;
+    while (i < count) {
+        if (system.age[i] < system.life[i]) {
+            ++i;
+            continue;
+        }
+        // Move the last live particle into the hole and look at it next
+        --count;
+        for (float* column : columns) column[i] = column[count];
+    }
+    int removed = system.count - count;
+    system.count = count;
+    return removed;
+}
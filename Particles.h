@@ -0,0 +1,41 @@
+// Particles.h
+#pragma once
+#include <vector>
+
+// Pooled particle storage for effects simulated on the CPU. Every column
+// of a system lives in one block allocated up front, so emitting and
+// retiring particles never touches the heap. Particles are advanced four
+// at a time with SSE2 (scalar elsewhere) under a radial force from the
+// world origin, which is where the Sun sits.
+const int PARTICLE_JOB_GRAIN = 4096; // Particles per job; a multiple of 4
+
+struct ParticleSystem {
+    std::vector<float> pool;       // All columns, capacity floats each
+    float* posX = nullptr;
+    float* posY = nullptr;
+    float* posZ = nullptr;
+    float* velX = nullptr;
+    float* velY = nullptr;
+    float* velZ = nullptr;
+    float* age = nullptr;          // Seconds since emission
+    float* life = nullptr;         // Age at which the particle dies
+    int count = 0;                 // Live particles are [0, count)
+    int capacity = 0;
+    float radialAcceleration = 0.0f; // Times 1/r^2 away from the origin (negative pulls in)
+};
+
+// Allocate the pool; capacity is rounded up to a multiple of 4
+void initParticleSystem(ParticleSystem& system, int capacity);
+
+// Make room for up to `wanted` particles at the end of the live range.
+// Returns how many fit; the caller fills [first, first + granted).
+int reserveParticles(ParticleSystem& system, int wanted, int& first);
+
+// Integrate particles [begin, end) over dt seconds and age them. Ranges
+// that do not overlap may run on different threads.
+void advanceParticles(ParticleSystem& system, float dt, int begin, int end);
+
+// Drop particles that outlived their life. Holes are filled from the end
+// of the live range, so only as many particles move as died; order is not
+// kept. Returns the number removed.
+int compactParticles(ParticleSystem& system);
@@ -0,0 +1,41 @@
+// PerfCounters.cpp
+#include "PerfCounters.h"
+
+std::atomic<int> perfCounters[PERF_COUNTER_COUNT];
+
+static std::atomic<float> lastTickMs{ 0.0f };
+static PerfFrame lastFrame;
+static float frameTimes[PERF_HISTORY_FRAMES] = {};
+static int newestFrame = 0;
+
+void perfRecordTick(float milliseconds) {
+    lastTickMs.store(milliseconds, std::memory_order_relaxed);
+}
+
+void perfEndFrame(float milliseconds) {
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        lastFrame.counters[i] = perfCounters[i].exchange(0, std::memory_order_relaxed);
+    }
+    lastFrame.frameMs = milliseconds;
+    lastFrame.tickMs = lastTickMs.load(std::memory_order_relaxed);
+
+    newestFrame = (newestFrame + 1) % PERF_HISTORY_FRAMES;
+    frameTimes[newestFrame] = milliseconds;
+}
+
+PerfFrame perfLastFrame() {
+    return lastFrame;
+}
+
+float perfFrameTime(int age) {
+    if (age < 0 || age >= PERF_HISTORY_FRAMES) return 0.0f;
+    return frameTimes[(newestFrame - age + PERF_HISTORY_FRAMES) % PERF_HISTORY_FRAMES];
+}
+
+float perfWorstFrameTime() {
+    float worst = 0.0f;
+    for (int i = 0; i < PERF_HISTORY_FRAMES; ++i) {
+        if (frameTimes[i] > worst) worst = frameTimes[i];
+    }
+    return worst;
+}
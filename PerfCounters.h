@@ -0,0 +1,46 @@
+// PerfCounters.h
+#pragma once
+#include <atomic>
+
+// Per-frame performance counters behind the overlay toggled with 'f'.
+// Drawing code bumps them with perfCount(), a relaxed atomic add that is
+// cheap enough to leave in, also from job workers. perfEndFrame() at the
+// end of display() keeps the frame's totals and duration and starts the
+// next frame from zero, and the last PERF_HISTORY_FRAMES durations are
+// kept for the graph.
+const int PERF_HISTORY_FRAMES = 240;
+
+enum PerfCounter {
+    PERF_DRAW_CALLS,
+    PERF_TRIANGLES,
+    PERF_TEXTURE_BINDS,
+    PERF_CULLED_BODIES,
+    PERF_COUNTER_COUNT
+};
+
+extern std::atomic<int> perfCounters[PERF_COUNTER_COUNT];
+
+inline void perfCount(PerfCounter counter, int amount = 1) {
+    perfCounters[counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+// Duration of the last simulation tick, from update()
+void perfRecordTick(float milliseconds);
+
+// Close the frame that took `milliseconds`
+void perfEndFrame(float milliseconds);
+
+// Totals of the last finished frame
+struct PerfFrame {
+    int counters[PERF_COUNTER_COUNT] = {};
+    float frameMs = 0.0f;
+    float tickMs = 0.0f;
+};
+
+PerfFrame perfLastFrame();
+
+// Duration of the frame `age` frames ago (0 is the last), 0 before it existed
+float perfFrameTime(int age);
+
+// Longest duration in the history
+float perfWorstFrameTime();
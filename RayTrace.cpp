@@ -0,0 +1,232 @@
+// RayTrace.cpp
+#include "RayTrace.h"
+#include "Atmosphere.h"
+#include "Bvh.h"
+#include "Image.h"
+#include "Jobs.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+static const float PI = 3.14159265f;
+static const float AMBIENT = 0.2f;                          // Matches the GL light
+static const float POINT_BODY_COLOR[3] = { 0.7f, 0.65f, 0.6f };  // Untextured bodies
+
+struct Vec3 {
+    float x, y, z;
+};
+
+static Vec3 operator+(Vec3 a, Vec3 b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+static Vec3 operator-(Vec3 a, Vec3 b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+static Vec3 operator*(Vec3 a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+static float dot(Vec3 a, Vec3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+static Vec3 normalize(Vec3 a) { return a * (1.0f / sqrtf(dot(a, a))); }
+
+// Everything a tile job needs
+struct RenderState {
+    const BodyTable* table;
+    const std::vector<const SoftTexture*>* textures;
+    RayTraceSettings settings;
+    Vec3 eye, right, up, back; // Camera basis in world space
+    float tanHalfFov;
+    int light;                 // Star body lighting the scene, or -1 for a point light at the origin
+    std::vector<int> atmospheres;
+    std::vector<const AtmosphereModel*> atmosphereModels; // One per atmosphere
+    std::vector<float> accumulated; // Sum of samples, RGB top-down
+    int pass;
+};
+
+// Small per-sample random number generator (PCG hash of a counter)
+static uint32_t hash(uint32_t v) {
+    v = v * 747796405u + 2891336453u;
+    v = ((v >> ((v >> 28) + 4)) ^ v) * 277803737u;
+    return (v >> 22) ^ v;
+}
+
+static float random(uint32_t& state) {
+    state = hash(state);
+    return (state >> 8) * (1.0f / 16777216.0f);
+}
+
+static Vec3 position(const BodyTable& table, int b) {
+    return { table.posX[b], table.posY[b], table.posZ[b] };
+}
+
+// gluSphere texture coordinates of a unit normal, in the body's own frame
+static void sphereCoordinates(const BodyTable& table, int b, Vec3 n, float& s, float& t) {
+    Vec3 local = n;
+    if (table.frameSlot[b] >= 0) {
+        const double* f = table.worldFrame(b);
+        local = { (float)(f[0] * n.x + f[1] * n.y + f[2] * n.z),
+                  (float)(f[4] * n.x + f[5] * n.y + f[6] * n.z),
+                  (float)(f[8] * n.x + f[9] * n.y + f[10] * n.z) };
+    }
+    float rho = acosf(std::min(std::max(local.z, -1.0f), 1.0f));
+    float theta = atan2f(-local.x, local.y);
+    s = theta / (2.0f * PI);
+    if (s < 0.0f) s += 1.0f;
+    t = 1.0f - rho / PI;
+}
+
+// Fraction of the star visible from p along one random sample, and the
+// direction to that sample
+static float sampleLight(const RenderState& state, Vec3 p, Vec3 n, uint32_t& rng, Vec3& toLight) {
+    const BodyTable& table = *state.table;
+    if (state.light < 0) {
+        toLight = normalize(p * -1.0f);
+        return 1.0f;
+    }
+
+    // Uniform point on the hemisphere of the star facing p
+    Vec3 center = position(table, state.light);
+    float z = 2.0f * random(rng) - 1.0f;
+    float phi = 2.0f * PI * random(rng);
+    float ring = sqrtf(std::max(1.0f - z * z, 0.0f));
+    Vec3 offset = { ring * cosf(phi), ring * sinf(phi), z };
+    if (dot(offset, p - center) < 0.0f) offset = offset * -1.0f;
+    Vec3 target = center + offset * table.radius[state.light];
+
+    toLight = normalize(target - p);
+    Vec3 origin = p + n * 1e-4f;
+    float t;
+    int hit = intersectBodies(table, &origin.x, &toLight.x, &t);
+    return hit == state.light || hit < 0 ? 1.0f : 0.0f;
+}
+
+// Seen through the atmospheres the ray enters before tHit: what is behind
+// is dimmed and the light scattered toward the eye added
+static void applyAtmospheres(const RenderState& state, Vec3 origin, Vec3 dir, float tHit, float* color) {
+    const BodyTable& table = *state.table;
+    for (size_t i = 0; i < state.atmospheres.size(); ++i) {
+        int a = state.atmospheres[i];
+        const AtmosphereModel& model = *state.atmosphereModels[i];
+        Vec3 center = position(table, a);
+        float r = table.radius[a];
+        float shell = r * (1.0f + model.params.height);
+        Vec3 oc = origin - center;
+        float b = dot(oc, dir);
+        float disc = b * b - (dot(oc, oc) - shell * shell);
+        if (disc <= 0.0f || -b + sqrtf(disc) <= 0.0f || -b - sqrtf(disc) >= tHit) continue;
+
+        // Planet-relative, in radii; the sun is the star or the origin
+        Vec3 x = oc * (1.0f / r);
+        Vec3 toSun = normalize((state.light >= 0 ? position(table, state.light) : Vec3{ 0.0f, 0.0f, 0.0f }) - center);
+        float light[3], through[3];
+        atmosphereInscatter(model, &x.x, &dir.x, &toSun.x, light, through);
+        for (int c = 0; c < 3; ++c) color[c] = color[c] * through[c] + light[c];
+    }
+}
+
+static void radiance(const RenderState& state, Vec3 origin, Vec3 dir, uint32_t& rng, float* color) {
+    const BodyTable& table = *state.table;
+    color[0] = color[1] = color[2] = 0.0f;
+
+    float t = INFINITY;
+    int b = intersectBodies(table, &origin.x, &dir.x, &t);
+    if (b >= 0) {
+        Vec3 p = origin + dir * t;
+        Vec3 n = normalize(p - position(table, b));
+
+        float albedo[3] = { POINT_BODY_COLOR[0], POINT_BODY_COLOR[1], POINT_BODY_COLOR[2] };
+        const SoftTexture* texture = (*state.textures)[b];
+        if (texture && !texture->rgb.empty()) {
+            float s, tc;
+            sphereCoordinates(table, b, n, s, tc);
+            sampleSoftTexture(texture, s, tc, albedo);
+            for (int c = 0; c < 3; ++c) albedo[c] /= 255.0f;
+        }
+
+        if (table.kind[b] == BODY_STAR) {
+            for (int c = 0; c < 3; ++c) color[c] = albedo[c];
+        }
+        else {
+            Vec3 toLight;
+            float visible = sampleLight(state, p, n, rng, toLight);
+            float light = AMBIENT + visible * std::max(dot(n, toLight), 0.0f);
+            for (int c = 0; c < 3; ++c) color[c] = albedo[c] * light;
+        }
+    }
+
+    if (!state.atmospheres.empty()) {
+        applyAtmospheres(state, origin, dir, t, color);
+    }
+}
+
+// Add one sample to every pixel of tiles [begin, end)
+static void traceTiles(void* data, int begin, int end) {
+    RenderState& state = *(RenderState*)data;
+    const int width = state.settings.width, height = state.settings.height;
+    const int tilesX = (width + RAYTRACE_TILE_SIZE - 1) / RAYTRACE_TILE_SIZE;
+    const float aspect = (float)width / height;
+
+    for (int tile = begin; tile < end; ++tile) {
+        int x0 = (tile % tilesX) * RAYTRACE_TILE_SIZE, y0 = (tile / tilesX) * RAYTRACE_TILE_SIZE;
+        int x1 = std::min(x0 + RAYTRACE_TILE_SIZE, width), y1 = std::min(y0 + RAYTRACE_TILE_SIZE, height);
+        for (int y = y0; y < y1; ++y) {
+            for (int x = x0; x < x1; ++x) {
+                // Same pixel and pass always give the same image
+                uint32_t rng = hash((uint32_t)(y * width + x) ^ hash((uint32_t)state.pass));
+                float px = (2.0f * (x + random(rng)) / width - 1.0f) * state.tanHalfFov * aspect;
+                float py = (1.0f - 2.0f * (y + random(rng)) / height) * state.tanHalfFov;
+                Vec3 dir = normalize(state.right * px + state.up * py - state.back);
+
+                float color[3];
+                radiance(state, state.eye, dir, rng, color);
+                float* out = &state.accumulated[((size_t)y * width + x) * 3];
+                for (int c = 0; c < 3; ++c) out[c] += color[c];
+            }
+        }
+    }
+}
+
+// Eye-space direction to world space: undo Rx(angleY), then Ry(angleX)
+static Vec3 eyeToWorld(const RayTraceCamera& camera, Vec3 v) {
+    float ax = camera.angleX * PI / 180.0f, ay = camera.angleY * PI / 180.0f;
+    Vec3 r = { v.x, cosf(ay) * v.y + sinf(ay) * v.z, -sinf(ay) * v.y + cosf(ay) * v.z };
+    return { cosf(ax) * r.x - sinf(ax) * r.z, r.y, sinf(ax) * r.x + cosf(ax) * r.z };
+}
+
+bool rayTraceImage(const BodyTable& table, const std::vector<const SoftTexture*>& textures,
+    const RayTraceCamera& camera, const RayTraceSettings& settings, const char* path) {
+    if (settings.width <= 0 || settings.height <= 0 || settings.samples <= 0) {
+        std::cerr << "Bad ray trace image size or sample count" << std::endl;
+        return false;
+    }
+
+    RenderState state;
+    state.table = &table;
+    state.textures = &textures;
+    state.settings = settings;
+    state.right = eyeToWorld(camera, { 1.0f, 0.0f, 0.0f });
+    state.up = eyeToWorld(camera, { 0.0f, 1.0f, 0.0f });
+    state.back = eyeToWorld(camera, { 0.0f, 0.0f, 1.0f });
+    state.eye = Vec3{ camera.target[0], camera.target[1], camera.target[2] } - state.back * camera.zoom;
+    state.tanHalfFov = tanf(camera.fovY * PI / 360.0f);
+    state.light = -1;
+    for (int b = 0; b < table.count(); ++b) {
+        if (table.kind[b] == BODY_STAR && state.light < 0) state.light = b;
+        if (table.flags[b] & BODY_FLAG_ATMOSPHERE) {
+            state.atmospheres.push_back(b);
+            state.atmosphereModels.push_back(loadAtmosphere(table.string(table.name[b])));
+        }
+    }
+    state.accumulated.assign((size_t)settings.width * settings.height * 3, 0.0f);
+
+    int tiles = ((settings.width + RAYTRACE_TILE_SIZE - 1) / RAYTRACE_TILE_SIZE) *
+        ((settings.height + RAYTRACE_TILE_SIZE - 1) / RAYTRACE_TILE_SIZE);
+    std::vector<float> image(state.accumulated.size());
+    for (state.pass = 0; state.pass < settings.samples; ++state.pass) {
+        JobCounter done;
+        parallelFor(tiles, 1, traceTiles, &state, &done);
+        waitForCounter(&done);
+
+        bool last = state.pass + 1 == settings.samples;
+        if (!settings.progressive && !last) continue;
+        float scale = 1.0f / (state.pass + 1);
+        for (size_t i = 0; i < image.size(); ++i) image[i] = state.accumulated[i] * scale;
+        if (!writeImage(path, settings.width, settings.height, image.data())) return false;
+        std::cout << "Pass " << state.pass + 1 << "/" << settings.samples << " written to " << path << std::endl;
+    }
+    return true;
+}
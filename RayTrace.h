@@ -0,0 +1,38 @@
+// RayTrace.h
+#pragma once
+#include "Bodies.h"
+#include "SoftRaster.h"
+#include <vector>
+
+// Offline renderer for stills. Every body is a sphere, so rays are
+// intersected analytically through the BVH, which must be built for the
+// table's current positions. Each pass adds one jittered sample per pixel
+// and sends its shadow ray to a random point on the star, so soft shadows
+// and eclipses converge as passes accumulate. Bodies flagged with
+// BODY_FLAG_ATMOSPHERE are seen through their scattering tables (see
+// Atmosphere.h).
+// Passes split the image into RAYTRACE_TILE_SIZE square tiles that run on
+// the job system.
+const int RAYTRACE_TILE_SIZE = 32;
+
+// Camera placed like display() places it: rotated about `target` and
+// pulled back by -zoom
+struct RayTraceCamera {
+    float angleX = 0.0f;   // Degrees about Y
+    float angleY = 0.0f;   // Degrees about X
+    float zoom = -30.0f;
+    float target[3] = { 0.0f, 0.0f, 0.0f };
+    float fovY = 45.0f;    // Degrees
+};
+
+struct RayTraceSettings {
+    int width = 1920;
+    int height = 1080;
+    int samples = 16;         // Per pixel, one per pass
+    bool progressive = false; // Rewrite the image after every pass
+};
+
+// Render the table and write the image to `path` (EXR or PNG, see Image.h).
+// textures holds one entry per body, null for untextured bodies.
+bool rayTraceImage(const BodyTable& table, const std::vector<const SoftTexture*>& textures,
+    const RayTraceCamera& camera, const RayTraceSettings& settings, const char* path);
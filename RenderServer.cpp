@@ -0,0 +1,246 @@
+// RenderServer.cpp
+#include "RenderServer.h"
+#include <iostream>
+
+#ifdef _WIN32
+
+bool runRenderServer(const char* /*socketPath*/, const RenderServerHandlers& /*handlers*/) {
+    std::cerr << "The render server needs Unix domain sockets, which this build does not support" << std::endl;
+    return false;
+}
+
+#else
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <map>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+struct Client {
+    int fd = -1;
+    std::vector<unsigned char> input;  // Bytes of a request not yet complete
+    std::vector<unsigned char> output; // Responses not yet sent
+    size_t sent = 0;                   // Bytes of output already sent
+    bool closing = false;              // Close once the output is sent
+};
+
+struct QueuedRequest {
+    int client;                        // Key in the client map
+    RenderRequest request;
+};
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int) {
+    stopRequested = 1;
+}
+
+static void appendResponse(Client& client, const RenderRequest& request, RenderStatus status,
+    const std::vector<unsigned char>* image) {
+    RenderResponse response;
+    memcpy(response.magic, RENDER_RESPONSE_MAGIC, 4);
+    response.status = status;
+    response.id = request.id;
+    response.width = status == RENDER_OK ? request.width : 0;
+    response.height = status == RENDER_OK ? request.height : 0;
+    response.imageBytes = status == RENDER_OK ? image->size() : 0;
+    const unsigned char* bytes = (const unsigned char*)&response;
+    client.output.insert(client.output.end(), bytes, bytes + sizeof(response));
+    if (status == RENDER_OK) client.output.insert(client.output.end(), image->begin(), image->end());
+}
+
+// Send what the socket takes without blocking; false if the peer is gone
+static bool flushClient(Client& client) {
+    while (client.sent < client.output.size()) {
+        ssize_t n = send(client.fd, client.output.data() + client.sent, client.output.size() - client.sent, 0);
+        if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        client.sent += (size_t)n;
+    }
+    client.output.clear();
+    client.sent = 0;
+    return true;
+}
+
+// Read whole requests while the queue has room; false if the peer is gone
+static bool readClient(int key, Client& client, std::vector<QueuedRequest>& queue) {
+    while (queue.size() < (size_t)RENDER_QUEUE_CAPACITY && !client.closing) {
+        size_t room = (RENDER_QUEUE_CAPACITY - queue.size()) * sizeof(RenderRequest) - client.input.size();
+        unsigned char buffer[64 * sizeof(RenderRequest)];
+        ssize_t n = recv(client.fd, buffer, std::min(room, sizeof(buffer)), 0);
+        if (n == 0) return false;
+        if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        client.input.insert(client.input.end(), buffer, buffer + n);
+
+        size_t used = 0;
+        while (client.input.size() - used >= sizeof(RenderRequest)) {
+            RenderRequest request;
+            memcpy(&request, client.input.data() + used, sizeof(request));
+            used += sizeof(request);
+            if (memcmp(request.magic, RENDER_REQUEST_MAGIC, 4) != 0 || request.version != RENDER_PROTOCOL_VERSION) {
+                // The stream cannot be trusted past this point
+                appendResponse(client, request, RENDER_BAD_REQUEST, nullptr);
+                client.closing = true;
+                break;
+            }
+            if (request.width < 1 || request.width > RENDER_MAX_SIZE || request.height < 1 || request.height > RENDER_MAX_SIZE
+                || memchr(request.follow, 0, sizeof(request.follow)) == nullptr) {
+                appendResponse(client, request, RENDER_BAD_REQUEST, nullptr);
+                continue;
+            }
+            QueuedRequest queued;
+            queued.client = key;
+            queued.request = request;
+            queue.push_back(queued);
+        }
+        client.input.erase(client.input.begin(), client.input.begin() + used);
+    }
+    return true;
+}
+
+// Requests that can share one prepare() call
+static bool sameBatch(const RenderRequest& a, const RenderRequest& b) {
+    return a.simulationTime == b.simulationTime && strcmp(a.follow, b.follow) == 0;
+}
+
+static bool batchOrder(const QueuedRequest& a, const QueuedRequest& b) {
+    if (a.request.simulationTime != b.request.simulationTime) return a.request.simulationTime < b.request.simulationTime;
+    int follow = strcmp(a.request.follow, b.request.follow);
+    if (follow != 0) return follow < 0;
+    if (a.request.width != b.request.width) return a.request.width < b.request.width;
+    return a.request.height < b.request.height;
+}
+
+bool runRenderServer(const char* socketPath, const RenderServerHandlers& handlers) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socketPath) >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path is too long: " << socketPath << std::endl;
+        return false;
+    }
+    strcpy(address.sun_path, socketPath);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socketPath); // Left behind by a server that did not shut down
+    if (listener < 0 || bind(listener, (const sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 64) != 0) {
+        std::cerr << "Failed to listen on " << socketPath << ": " << strerror(errno) << std::endl;
+        if (listener >= 0) close(listener);
+        return false;
+    }
+    fcntl(listener, F_SETFL, O_NONBLOCK);
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, requestStop);
+    signal(SIGTERM, requestStop);
+    std::cout << "Serving renders on " << socketPath << std::endl;
+
+    std::map<int, Client> clients;
+    int nextKey = 0;
+    std::vector<QueuedRequest> queue;
+    queue.reserve(RENDER_QUEUE_CAPACITY);
+    std::vector<pollfd> polled;
+    std::vector<int> polledKeys;
+    std::vector<unsigned char> image;
+
+    // The batch key prepare() last ran for and its result, kept across batches
+    bool prepared = false, ready = false;
+    RenderRequest preparedFor;
+    int served = 0, batches = 0, preparations = 0;
+    double renderSeconds = 0.0;
+
+    while (!stopRequested) {
+        // Backpressure: read only while there is room for the requests
+        bool room = queue.size() < (size_t)RENDER_QUEUE_CAPACITY;
+        polled.clear();
+        polledKeys.clear();
+        pollfd entry;
+        entry.fd = listener;
+        entry.events = (short)((int)clients.size() < RENDER_MAX_CLIENTS ? POLLIN : 0);
+        entry.revents = 0;
+        polled.push_back(entry);
+        polledKeys.push_back(-1);
+        for (auto& item : clients) {
+            Client& client = item.second;
+            entry.fd = client.fd;
+            entry.events = 0;
+            if (room && !client.closing && client.output.size() < RENDER_CLIENT_OUTPUT_LIMIT) entry.events |= POLLIN;
+            if (!client.output.empty()) entry.events |= POLLOUT;
+            polled.push_back(entry);
+            polledKeys.push_back(item.first);
+        }
+
+        // Do not sleep while there is work queued
+        if (poll(polled.data(), (nfds_t)polled.size(), queue.empty() ? -1 : 0) < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "poll failed: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        if (polled[0].revents & POLLIN) {
+            int fd;
+            while ((int)clients.size() < RENDER_MAX_CLIENTS && (fd = accept(listener, nullptr, nullptr)) >= 0) {
+                fcntl(fd, F_SETFL, O_NONBLOCK);
+                clients[nextKey++].fd = fd;
+            }
+        }
+        for (size_t i = 1; i < polled.size(); ++i) {
+            auto found = clients.find(polledKeys[i]);
+            Client& client = found->second;
+            bool alive = !(polled[i].revents & (POLLERR | POLLNVAL));
+            if (alive && (polled[i].revents & (POLLIN | POLLHUP))) alive = readClient(found->first, client, queue);
+            if (alive && (polled[i].revents & POLLOUT)) alive = flushClient(client);
+            if (!alive || (client.closing && client.output.empty())) {
+                close(client.fd);
+                clients.erase(found); // Its queued requests are dropped when they come up
+            }
+        }
+        if (queue.empty()) continue;
+
+        // Render everything queued, grouped so each epoch and target is set up once
+        auto start = std::chrono::steady_clock::now();
+        std::stable_sort(queue.begin(), queue.end(), batchOrder);
+        for (const QueuedRequest& queued : queue) {
+            auto found = clients.find(queued.client);
+            if (found == clients.end()) continue;
+            const RenderRequest& request = queued.request;
+            if (!prepared || !sameBatch(request, preparedFor)) {
+                preparedFor = request;
+                prepared = true;
+                ready = handlers.prepare(request);
+                ++preparations;
+            }
+            RenderStatus status = !ready ? RENDER_BAD_REQUEST : handlers.render(request, image) ? RENDER_OK : RENDER_FAILED;
+            appendResponse(found->second, request, status, &image);
+            ++served;
+        }
+        queue.clear();
+        ++batches;
+        renderSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // Start sending at once rather than after the next poll
+        for (auto it = clients.begin(); it != clients.end();) {
+            if (!flushClient(it->second)) {
+                close(it->second.fd);
+                it = clients.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    for (auto& item : clients) close(item.second.fd);
+    close(listener);
+    unlink(socketPath);
+    std::cout << "Served " << served << " renders in " << batches << " batches (" << preparations << " scene updates), "
+        << (served ? 1000.0 * renderSeconds / served : 0.0) << " ms per render" << std::endl;
+    return true;
+}
+
+#endif
@@ -0,0 +1,30 @@
+// RenderServer.h
+#pragma once
+#include "RenderServerFormat.h"
+#include <cstddef>
+#include <vector>
+
+// Headless render server on a Unix domain socket (messages in
+// RenderServerFormat.h). One thread multiplexes the connections with
+// poll() and renders between polls, so scene data, textures and meshes
+// stay warm from one request to the next. Queued requests are rendered in
+// batches sorted by epoch, view target and size, and prepare() runs only
+// when the epoch or target changes, so compatible requests share one scene
+// update. At most RENDER_QUEUE_CAPACITY requests wait; beyond that, and
+// while a client has RENDER_CLIENT_OUTPUT_LIMIT bytes of answers unread,
+// the server stops reading from sockets, so clients block on their own
+// writes instead of the server buffering without bound.
+const int RENDER_QUEUE_CAPACITY = 256;
+const size_t RENDER_CLIENT_OUTPUT_LIMIT = (size_t)64 << 20;
+const int RENDER_MAX_CLIENTS = 64;
+
+struct RenderServerHandlers {
+    // Set up the epoch and view target of the requests that follow
+    bool (*prepare)(const RenderRequest& request);
+    // Render one request into a PNG
+    bool (*render)(const RenderRequest& request, std::vector<unsigned char>& png);
+};
+
+// Serve on `socketPath` until SIGINT or SIGTERM; prints an error and
+// returns false if the socket cannot be created
+bool runRenderServer(const char* socketPath, const RenderServerHandlers& handlers);
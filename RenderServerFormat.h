@@ -0,0 +1,56 @@
+// RenderServerFormat.h
+#pragma once
+#include <cstdint>
+
+// Messages of the render server started with --serve <socket> (see
+// RenderServer.h), shared with clients such as tools/renderclient.cpp.
+// A client connects to the Unix domain socket and writes RenderRequests
+// back to back, without waiting for answers. Every request gets one
+// RenderResponse, followed by imageBytes bytes of PNG when the status is
+// RENDER_OK. Responses carry the request's id and may come back in a
+// different order than the requests were sent, because the server renders
+// requests for the same epoch and view target together. Native-endian.
+const char RENDER_REQUEST_MAGIC[4] = { 'R', 'R', 'E', 'Q' };
+const char RENDER_RESPONSE_MAGIC[4] = { 'R', 'R', 'S', 'P' };
+const uint32_t RENDER_PROTOCOL_VERSION = 1;
+const int RENDER_MAX_SIZE = 4096;        // Largest width or height
+const int RENDER_FOLLOW_NAME_BYTES = 32;
+
+// What to draw
+enum RenderLayer {
+    RENDER_LAYER_SPHERES = 1 << 0, // Textured bodies
+    RENDER_LAYER_POINTS = 1 << 1   // Untextured bodies such as asteroids
+};
+
+enum RenderStatus {
+    RENDER_OK = 0,
+    RENDER_BAD_REQUEST = 1,  // Unknown magic or version (the connection is closed), bad size or body
+    RENDER_FAILED = 2
+};
+
+struct RenderRequest {
+    char magic[4];
+    uint32_t version;
+    uint64_t id;                   // Echoed in the response
+    double simulationTime;         // Epoch in seconds
+    float angleX;                  // Camera as in the window: degrees about Y,
+    float angleY;                  // degrees about X,
+    float zoom;                    // and distance (negative) from the target
+    uint32_t layers;               // RenderLayer bits
+    int32_t width;
+    int32_t height;
+    char follow[RENDER_FOLLOW_NAME_BYTES]; // Body the camera orbits, empty for the Sun
+};
+
+static_assert(sizeof(RenderRequest) == 80, "RenderRequest must be 80 bytes");
+
+struct RenderResponse {
+    char magic[4];
+    uint32_t status;               // RenderStatus
+    uint64_t id;
+    int32_t width;
+    int32_t height;
+    uint64_t imageBytes;
+};
+
+static_assert(sizeof(RenderResponse) == 32, "RenderResponse must be 32 bytes");
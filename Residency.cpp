@@ -0,0 +1,447 @@
+// Residency.cpp
+#include "Residency.h"
+#include "FrameArena.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+static const size_t BYTES_PER_TEXEL = 4; // Drivers pad RGB8 to four bytes
+
+struct ResidentTexture {
+    std::string path;
+    GLuint texture = 0;
+    int width = 0, height = 0;   // Level 0, known after the first load
+    int levels = 0;
+    int tailLevel = 0;           // This level and coarser are always resident
+    int residentLevel = -1;      // Finest resident level, -1 before the first load
+    bool loading = false;
+    size_t reservedBytes = 0;    // Budget held for the load in flight
+    int lastVisibleFrame = -1;
+    int lastFineFrame = -1;      // Last frame that needed residentLevel or finer
+    float coveredPixels = 0.0f;  // Largest this frame
+};
+
+// Mip chain from `firstLevel` down, read and filtered on the loader thread
+struct TextureLoad {
+    int handle = 0;
+    int level = -1;              // Requested finest level; -1 for just the tail
+    std::string path;
+    bool ok = false;
+    int width = 0, height = 0;   // Level 0
+    int firstLevel = 0;
+    std::vector<std::vector<unsigned char>> mips;
+};
+
+static TextureLoader textureLoader = nullptr;
+static size_t budget = RESIDENCY_BUDGET_BYTES;
+static std::vector<ResidentTexture> textures;
+static std::map<std::string, int> handles;
+static int frame = 0;
+static size_t residentBytes = 0, reservedBytes = 0;
+static int loadsInFlight = 0;
+static GLuint copyFramebuffer = 0;
+
+static std::thread loaderThread;
+static std::mutex loaderLock;
+static std::condition_variable loaderWake;
+static std::deque<TextureLoad> pendingLoads;
+static std::deque<TextureLoad> finishedLoads;
+static bool loaderRunning = false;
+
+static ResidencyStats stats;
+static uint64_t windowBytes = 0; // Uploaded since windowStart
+static std::chrono::steady_clock::time_point windowStart;
+
+static int levelSize(int size, int level) {
+    return std::max(size >> level, 1);
+}
+
+static int levelCount(int width, int height) {
+    int levels = 1;
+    while ((width >> levels) > 0 || (height >> levels) > 0) ++levels;
+    return levels;
+}
+
+static int tailLevelFor(int width, int height) {
+    int level = 0;
+    while (std::max(levelSize(width, level), levelSize(height, level)) > RESIDENCY_TAIL_SIZE) ++level;
+    return level;
+}
+
+// GPU bytes of every level from `level` down
+static size_t chainBytes(const ResidentTexture& t, int level) {
+    if (level < 0) return 0;
+    size_t bytes = 0;
+    for (int l = level; l < t.levels; ++l) bytes += (size_t)levelSize(t.width, l) * levelSize(t.height, l) * BYTES_PER_TEXEL;
+    return bytes;
+}
+
+// 2x2 box filter (a single row or column is kept when that side is 1)
+static void halve(const std::vector<unsigned char>& source, int width, int height, std::vector<unsigned char>& result) {
+    int w = std::max(width / 2, 1), h = std::max(height / 2, 1);
+    result.resize((size_t)w * h * 3);
+    for (int y = 0; y < h; ++y) {
+        const unsigned char* row0 = &source[(size_t)std::min(2 * y, height - 1) * width * 3];
+        const unsigned char* row1 = &source[(size_t)std::min(2 * y + 1, height - 1) * width * 3];
+        for (int x = 0; x < w; ++x) {
+            int x0 = std::min(2 * x, width - 1) * 3, x1 = std::min(2 * x + 1, width - 1) * 3;
+            for (int c = 0; c < 3; ++c) {
+                result[((size_t)y * w + x) * 3 + c] =
+                    (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+            }
+        }
+    }
+}
+
+static void loadTexture(TextureLoad& load) {
+    std::vector<unsigned char> image, smaller;
+    if (!textureLoader(load.path.c_str(), load.width, load.height, image)) return;
+
+    int levels = levelCount(load.width, load.height);
+    load.firstLevel = load.level >= 0 ? std::min(load.level, levels - 1) : tailLevelFor(load.width, load.height);
+    int w = load.width, h = load.height;
+    for (int l = 0; l < levels; ++l) {
+        if (l >= load.firstLevel) load.mips.push_back(image);
+        if (l + 1 == levels) break;
+        halve(image, w, h, smaller);
+        image.swap(smaller);
+        w = std::max(w / 2, 1);
+        h = std::max(h / 2, 1);
+    }
+    load.ok = true;
+}
+
+static void loaderLoop() {
+    std::unique_lock<std::mutex> guard(loaderLock);
+    while (true) {
+        loaderWake.wait(guard, [] { return !pendingLoads.empty() || !loaderRunning; });
+        if (!loaderRunning) break;
+
+        TextureLoad load = std::move(pendingLoads.front());
+        pendingLoads.pop_front();
+        guard.unlock();
+        loadTexture(load);
+        guard.lock();
+        finishedLoads.push_back(std::move(load));
+    }
+}
+
+static void requestLoad(int handle, int level) {
+    ResidentTexture& t = textures[handle];
+    t.loading = true;
+    ++loadsInFlight;
+
+    TextureLoad load;
+    load.handle = handle;
+    load.level = level;
+    load.path = t.path;
+    {
+        std::lock_guard<std::mutex> guard(loaderLock);
+        pendingLoads.push_back(std::move(load));
+    }
+    loaderWake.notify_one();
+}
+
+void initResidency(TextureLoader loader, size_t budgetBytes) {
+    if (loaderThread.joinable()) return;
+    textureLoader = loader;
+    budget = budgetBytes;
+    windowStart = std::chrono::steady_clock::now();
+    loaderRunning = true;
+    loaderThread = std::thread(loaderLoop);
+}
+
+void shutdownResidency() {
+    if (!loaderThread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> guard(loaderLock);
+        loaderRunning = false;
+    }
+    loaderWake.notify_one();
+    loaderThread.join();
+}
+
+int registerTexture(const char* path) {
+    auto found = handles.find(path);
+    if (found != handles.end()) return found->second;
+
+    int handle = (int)textures.size();
+    textures.emplace_back();
+    textures.back().path = path;
+    handles[path] = handle;
+    requestLoad(handle, -1);
+    return handle;
+}
+
+GLuint residentTexture(int handle) {
+    return handle >= 0 && handle < (int)textures.size() ? textures[handle].texture : 0;
+}
+
+void markTextureVisible(int handle, float coveredPixels) {
+    if (handle < 0 || handle >= (int)textures.size()) return;
+    ResidentTexture& t = textures[handle];
+    if (t.lastVisibleFrame != frame) t.coveredPixels = 0.0f;
+    t.lastVisibleFrame = frame;
+    t.coveredPixels = std::max(t.coveredPixels, coveredPixels);
+}
+
+static GLuint createTexture(int levels) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    return texture;
+}
+
+// Swap in a texture holding the chain from `level` down
+static void replaceTexture(ResidentTexture& t, GLuint texture, int level) {
+    size_t before = chainBytes(t, t.residentLevel), after = chainBytes(t, level);
+    if (t.texture) glDeleteTextures(1, &t.texture);
+    t.texture = texture;
+    t.residentLevel = level;
+    residentBytes = residentBytes - before + after;
+    if (after < before) stats.evictedBytes += before - after;
+}
+
+// A finished load being uploaded. Its levels are allocated at once and
+// filled a band of rows at a time, so a large chain takes several frames.
+struct ActiveUpload {
+    TextureLoad load;
+    GLuint texture = 0;
+    int mip = 0;                 // Next level of the load to fill
+    int row = 0;                 // Next row of that level
+};
+
+static ActiveUpload upload;
+static bool uploading = false;
+
+// The load is done with; release the budget it held
+static void finishLoad(ResidentTexture& t) {
+    t.loading = false;
+    --loadsInFlight;
+    reservedBytes -= t.reservedBytes;
+    t.reservedBytes = 0;
+}
+
+// Make a finished load the active upload; false if it brings nothing new
+static bool beginUpload(TextureLoad& load) {
+    ResidentTexture& t = textures[load.handle];
+    if (!load.ok) { // The loader reported why
+        finishLoad(t);
+        return false;
+    }
+    if (t.residentLevel < 0) {
+        t.width = load.width;
+        t.height = load.height;
+        t.levels = levelCount(load.width, load.height);
+        t.tailLevel = tailLevelFor(load.width, load.height);
+    }
+    else if (load.firstLevel >= t.residentLevel) {
+        finishLoad(t); // Nothing finer than what is resident
+        return false;
+    }
+
+    upload.texture = createTexture((int)load.mips.size());
+    for (size_t i = 0; i < load.mips.size(); ++i) {
+        int l = load.firstLevel + (int)i;
+        glTexImage2D(GL_TEXTURE_2D, (GLint)i, GL_RGB8, levelSize(t.width, l), levelSize(t.height, l), 0,
+            GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    upload.load = std::move(load);
+    upload.mip = 0;
+    upload.row = 0;
+    uploading = true;
+    return true;
+}
+
+// Fill rows of the active upload until about `allowance` bytes went up (at
+// least one row), and swap the texture in once every level is there
+static size_t continueUpload(size_t allowance) {
+    TextureLoad& load = upload.load;
+    ResidentTexture& t = textures[load.handle];
+    size_t bytes = 0;
+    glBindTexture(GL_TEXTURE_2D, upload.texture);
+    glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Small mips have odd row lengths
+    while (upload.mip < (int)load.mips.size() && bytes < allowance) {
+        int l = load.firstLevel + upload.mip;
+        int w = levelSize(t.width, l), h = levelSize(t.height, l);
+        size_t rowBytes = (size_t)w * 3;
+        size_t fit = allowance > bytes ? (allowance - bytes) / rowBytes : 0;
+        int rows = (int)std::min((size_t)(h - upload.row), std::max(fit, (size_t)1));
+        glTexSubImage2D(GL_TEXTURE_2D, upload.mip, 0, upload.row, w, rows, GL_RGB, GL_UNSIGNED_BYTE,
+            load.mips[upload.mip].data() + upload.row * rowBytes);
+        bytes += rows * rowBytes;
+        upload.row += rows;
+        if (upload.row == h) {
+            ++upload.mip;
+            upload.row = 0;
+        }
+    }
+    glPopClientAttrib();
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (upload.mip == (int)load.mips.size()) {
+        finishLoad(t);
+        replaceTexture(t, upload.texture, load.firstLevel);
+        t.lastFineFrame = frame;
+        upload = ActiveUpload();
+        uploading = false;
+    }
+    return bytes;
+}
+
+// Drop the levels finer than `level`. The coarser ones are copied on the
+// GPU into a smaller texture, through the CPU where framebuffer objects
+// are missing.
+static void trimTexture(ResidentTexture& t, int level) {
+    if (level <= t.residentLevel || !t.texture) return;
+    int levels = t.levels - level;
+    GLuint texture = createTexture(levels);
+    for (int i = 0; i < levels; ++i) {
+        glTexImage2D(GL_TEXTURE_2D, i, GL_RGB8, levelSize(t.width, level + i), levelSize(t.height, level + i), 0,
+            GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    }
+
+    bool copied = false;
+    if (GLEW_ARB_framebuffer_object) {
+        GLint previousRead = 0;
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousRead);
+        if (!copyFramebuffer) glGenFramebuffers(1, &copyFramebuffer);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, copyFramebuffer);
+        copied = true;
+        for (int i = 0; i < levels && copied; ++i) {
+            glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, t.texture, level + i - t.residentLevel);
+            copied = glCheckFramebufferStatus(GL_READ_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+            if (copied) glCopyTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, 0, 0, levelSize(t.width, level + i), levelSize(t.height, level + i));
+        }
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, previousRead);
+    }
+    if (!copied) {
+        std::vector<unsigned char> pixels;
+        glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (int i = 0; i < levels; ++i) {
+            int w = levelSize(t.width, level + i), h = levelSize(t.height, level + i);
+            pixels.resize((size_t)w * h * 3);
+            glBindTexture(GL_TEXTURE_2D, t.texture);
+            glGetTexImage(GL_TEXTURE_2D, level + i - t.residentLevel, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, w, h, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+        }
+        glPopClientAttrib();
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    replaceTexture(t, texture, level);
+}
+
+// Finest level worth having for a texture spanning `coveredPixels`
+static int wantedLevel(const ResidentTexture& t, bool visible) {
+    if (!visible || t.coveredPixels <= 0.0f) return t.tailLevel;
+    int level = (int)floorf(log2f(t.width / t.coveredPixels));
+    return std::min(std::max(level, 0), t.tailLevel);
+}
+
+// Trim textures not seen this frame to their tails, least recently seen
+// first, until `bytes` more fit in the budget
+static bool makeRoom(size_t bytes) {
+    int* candidates = frameArray<int>(textures.size());
+    int candidateCount = 0;
+    for (int h = 0; h < (int)textures.size(); ++h) {
+        const ResidentTexture& t = textures[h];
+        if (t.lastVisibleFrame != frame && t.residentLevel >= 0 && t.residentLevel < t.tailLevel) candidates[candidateCount++] = h;
+    }
+    std::sort(candidates, candidates + candidateCount, [](int a, int b) {
+        return textures[a].lastVisibleFrame < textures[b].lastVisibleFrame;
+    });
+    for (int i = 0; i < candidateCount; ++i) {
+        if (residentBytes + reservedBytes + bytes <= budget) break;
+        trimTexture(textures[candidates[i]], textures[candidates[i]].tailLevel);
+    }
+    return residentBytes + reservedBytes + bytes <= budget;
+}
+
+void updateResidency() {
+    // Uploads that arrived, a few megabytes per frame; a load that does not
+    // fit stays active and continues next frame
+    size_t uploaded = 0;
+    while (uploaded < RESIDENCY_UPLOAD_BYTES_PER_FRAME) {
+        if (!uploading) {
+            TextureLoad load;
+            {
+                std::lock_guard<std::mutex> guard(loaderLock);
+                if (finishedLoads.empty()) break;
+                load = std::move(finishedLoads.front());
+                finishedLoads.pop_front();
+            }
+            if (!beginUpload(load)) continue;
+        }
+        uploaded += continueUpload(RESIDENCY_UPLOAD_BYTES_PER_FRAME - uploaded);
+    }
+    stats.uploadedBytes += uploaded;
+    windowBytes += uploaded;
+
+    // Levels to stream in (largest on screen first) and to drop
+    int* streams = frameArray<int>(textures.size());
+    int streamCount = 0;
+    for (int h = 0; h < (int)textures.size(); ++h) {
+        ResidentTexture& t = textures[h];
+        if (t.residentLevel < 0) continue;
+        int wanted = wantedLevel(t, t.lastVisibleFrame == frame);
+        if (wanted <= t.residentLevel) t.lastFineFrame = frame;
+        if (wanted < t.residentLevel && !t.loading) streams[streamCount++] = h;
+        else if (wanted > t.residentLevel && !t.loading && frame - t.lastFineFrame > RESIDENCY_GRACE_FRAMES) trimTexture(t, wanted);
+    }
+    std::sort(streams, streams + streamCount, [](int a, int b) {
+        return textures[a].coveredPixels > textures[b].coveredPixels;
+    });
+    for (int i = 0; i < streamCount; ++i) {
+        int h = streams[i];
+        ResidentTexture& t = textures[h];
+        int level = wantedLevel(t, true);
+        size_t extra = chainBytes(t, level) - chainBytes(t, t.residentLevel);
+        if (!makeRoom(extra)) {
+            // Settle for the finest level that fits
+            while (level < t.residentLevel && residentBytes + reservedBytes + chainBytes(t, level) - chainBytes(t, t.residentLevel) > budget) ++level;
+            extra = chainBytes(t, level) - chainBytes(t, t.residentLevel);
+        }
+        if (level >= t.residentLevel) continue;
+        t.reservedBytes = extra;
+        reservedBytes += extra;
+        requestLoad(h, level);
+    }
+
+    // Upload rate over the last second
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - windowStart).count();
+    if (seconds >= 1.0) {
+        stats.uploadMegabytesPerSecond = (float)(windowBytes / seconds / 1e6);
+        windowBytes = 0;
+        windowStart = now;
+    }
+    ++frame;
+}
+
+bool residencyBusy() {
+    return loadsInFlight > 0;
+}
+
+ResidencyStats residencyStats() {
+    ResidencyStats result = stats;
+    result.residentBytes = residentBytes;
+    result.budgetBytes = budget;
+    result.textures = (int)textures.size();
+    result.streaming = loadsInFlight;
+    return result;
+}
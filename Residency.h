@@ -0,0 +1,61 @@
+// Residency.h
+#pragma once
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Texture residency under a byte budget. A texture is registered by path
+// and drawn with whatever mip levels are resident. Each frame the renderer
+// reports the textures it drew and how many pixels their width covers on
+// screen, which picks the finest level worth having. Missing levels are
+// read and downsampled on a loader thread and uploaded a few megabytes per
+// frame, a band of rows at a time, so a large chain spreads over frames.
+// Levels finer than needed are dropped on the GPU (copied into a
+// smaller texture) once unused for RESIDENCY_GRACE_FRAMES, and when the
+// budget is exceeded the least recently visible textures lose levels
+// first. The mip tail up to RESIDENCY_TAIL_SIZE always stays resident.
+const size_t RESIDENCY_BUDGET_BYTES = (size_t)256 << 20;
+const int RESIDENCY_TAIL_SIZE = 64;          // Largest dimension of the always-resident levels
+const int RESIDENCY_GRACE_FRAMES = 120;      // Frames a finer level is kept after it was last needed
+const size_t RESIDENCY_UPLOAD_BYTES_PER_FRAME = (size_t)16 << 20;
+
+// Loads an image as RGB, rows bottom-up; called on the loader thread
+typedef bool (*TextureLoader)(const char* path, int& width, int& height, std::vector<unsigned char>& rgb);
+
+struct ResidencyStats {
+    size_t residentBytes = 0;      // Estimated GPU bytes of every resident level
+    size_t budgetBytes = 0;
+    int textures = 0;
+    int streaming = 0;             // Loads queued or in flight
+    float uploadMegabytesPerSecond = 0.0f; // Over the last second
+    uint64_t uploadedBytes = 0;    // Since start
+    uint64_t evictedBytes = 0;     // Since start
+};
+
+// Start the loader thread
+void initResidency(TextureLoader loader, size_t budgetBytes = RESIDENCY_BUDGET_BYTES);
+
+// Stop the loader thread (textures go with the GL context)
+void shutdownResidency();
+
+// Handle for the texture at `path` (the same path gives the same handle).
+// Its mip tail starts loading at once.
+int registerTexture(const char* path);
+
+// GL texture with the resident levels, or 0 before any have arrived. The
+// name changes when levels are added or dropped, so fetch it every frame.
+GLuint residentTexture(int handle);
+
+// The texture is drawn this frame with its width spanning about
+// `coveredPixels` screen pixels
+void markTextureVisible(int handle, float coveredPixels);
+
+// Once per frame before drawing: upload finished loads, request missing
+// levels, drop unneeded ones and enforce the budget
+void updateResidency();
+
+// True while loads are queued or uploads are waiting for a frame
+bool residencyBusy();
+
+ResidencyStats residencyStats();
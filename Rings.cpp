@@ -0,0 +1,166 @@
+// Rings.cpp
+#include "Rings.h"
+#include "PerfCounters.h"
+#include "Shaders.h"
+#include <cmath>
+#include <vector>
+
+static GLuint ringVBO = 0;
+static GLuint ringTexture = 0;
+static GLuint ringProgram = 0;
+static GLint sunPosLoc = -1, planetCenterLoc = -1, planetRadiusLoc = -1, shadowsLoc = -1;
+static float ringPlanetRadius = 1.0f;
+
+static const char* ringVertexShader =
+    "#version 120\n"
+    "varying vec3 eyePos;\n"
+    "varying vec3 eyeNormal;\n"
+    "void main() {\n"
+    "    eyePos = vec3(gl_ModelViewMatrix * gl_Vertex);\n"
+    "    eyeNormal = gl_NormalMatrix * gl_Normal;\n"
+    "    gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+    "    gl_Position = ftransform();\n"
+    "}\n";
+
+static const char* ringFragmentShader =
+    "#version 120\n"
+    "uniform sampler1D ringTexture;\n"
+    "uniform vec3 sunPos;\n"
+    "uniform vec3 planetCenter;\n"
+    "uniform float planetRadius;\n"
+    "uniform float shadows;\n"
+    "varying vec3 eyePos;\n"
+    "varying vec3 eyeNormal;\n"
+    "void main() {\n"
+    "    vec4 ring = texture1D(ringTexture, gl_TexCoord[0].s);\n"
+    "    vec3 toSun = normalize(sunPos - eyePos);\n"
+    "    float light = 0.35 + 0.65 * abs(dot(normalize(eyeNormal), toSun));\n"
+    // Ray from this fragment toward the Sun against the planet sphere;
+    // the closest-approach distance gives a soft shadow edge
+    "    vec3 oc = eyePos - planetCenter;\n"
+    "    float b = dot(oc, toSun);\n"
+    "    float miss = sqrt(max(dot(oc, oc) - b * b, 0.0));\n"
+    "    float lit = b < 0.0 ? smoothstep(0.95 * planetRadius, planetRadius, miss) : 1.0;\n"
+    "    light *= mix(1.0, 0.15 + 0.85 * lit, shadows);\n"
+    "    gl_FragColor = vec4(ring.rgb * light, ring.a);\n"
+    "}\n";
+
+// Radial profile in planet radii: C ring, B ring, Cassini division, A ring, Encke gap
+static void ringProfile(float r, float* rgba) {
+    float density, shade;
+    if (r < 1.527f) {                 // C ring: faint and grey
+        density = 0.25f + 0.1f * (r - RING_INNER_RADII) / (1.527f - RING_INNER_RADII);
+        shade = 0.6f;
+    }
+    else if (r < 1.951f) {            // B ring: densest
+        density = 0.75f + 0.2f * (r - 1.527f) / (1.951f - 1.527f);
+        shade = 1.0f;
+    }
+    else if (r < 2.025f) {            // Cassini division
+        density = 0.06f;
+        shade = 0.7f;
+    }
+    else if (r > 2.211f && r < 2.217f) { // Encke gap
+        density = 0.0f;
+        shade = 0.9f;
+    }
+    else {                            // A ring
+        density = 0.6f;
+        shade = 0.9f;
+    }
+
+    // Fine ringlets
+    density *= 0.85f + 0.15f * sinf(r * 420.0f) * sinf(r * 97.0f);
+
+    rgba[0] = 0.86f * shade;
+    rgba[1] = 0.78f * shade;
+    rgba[2] = 0.64f * shade;
+    rgba[3] = density;
+}
+
+void initRings(float planetRadius) {
+    ringPlanetRadius = planetRadius;
+    float inner = RING_INNER_RADII * planetRadius;
+    float outer = RING_OUTER_RADII * planetRadius;
+
+    // Triangle strip around the annulus: (x, y, z, s) per vertex, s = 0 inner, 1 outer
+    std::vector<float> vertices;
+    vertices.reserve((RING_SEGMENTS + 1) * 2 * 4);
+    for (int i = 0; i <= RING_SEGMENTS; ++i) {
+        float a = 6.28318531f * i / RING_SEGMENTS;
+        float c = cosf(a), s = sinf(a);
+        float strip[8] = { inner * c, 0.0f, inner * s, 0.0f, outer * c, 0.0f, outer * s, 1.0f };
+        vertices.insert(vertices.end(), strip, strip + 8);
+    }
+    glGenBuffers(1, &ringVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, ringVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // 1D density and color texture
+    std::vector<float> texels(RING_TEXTURE_SIZE * 4);
+    for (int i = 0; i < RING_TEXTURE_SIZE; ++i) {
+        float r = RING_INNER_RADII + (RING_OUTER_RADII - RING_INNER_RADII) * (i + 0.5f) / RING_TEXTURE_SIZE;
+        ringProfile(r, &texels[i * 4]);
+    }
+    glGenTextures(1, &ringTexture);
+    glBindTexture(GL_TEXTURE_1D, ringTexture);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA, RING_TEXTURE_SIZE, 0, GL_RGBA, GL_FLOAT, texels.data());
+    glBindTexture(GL_TEXTURE_1D, 0);
+
+    ringProgram = compileShaderProgram(ringVertexShader, ringFragmentShader);
+    if (ringProgram) {
+        sunPosLoc = glGetUniformLocation(ringProgram, "sunPos");
+        planetCenterLoc = glGetUniformLocation(ringProgram, "planetCenter");
+        planetRadiusLoc = glGetUniformLocation(ringProgram, "planetRadius");
+        shadowsLoc = glGetUniformLocation(ringProgram, "shadows");
+        glUseProgram(ringProgram);
+        glUniform1i(glGetUniformLocation(ringProgram, "ringTexture"), 0);
+        glUseProgram(0);
+    }
+}
+
+void drawRings(const float* sunEye, bool shadows) {
+    if (!ringVBO) return;
+
+    glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE); // Translucent: test against the planets but don't occlude
+    glEnable(GL_TEXTURE_1D);
+    glBindTexture(GL_TEXTURE_1D, ringTexture);
+    glColor3f(1.0f, 1.0f, 1.0f);
+    glNormal3f(0.0f, 1.0f, 0.0f);
+
+    if (ringProgram) {
+        // The planet sits at the origin of the current modelview
+        float modelview[16];
+        glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+
+        glUseProgram(ringProgram);
+        glUniform3f(sunPosLoc, sunEye[0], sunEye[1], sunEye[2]);
+        glUniform3f(planetCenterLoc, modelview[12], modelview[13], modelview[14]);
+        glUniform1f(planetRadiusLoc, ringPlanetRadius);
+        glUniform1f(shadowsLoc, shadows ? 1.0f : 0.0f);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, ringVBO);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 4 * sizeof(float), (const void*)0);
+    glTexCoordPointer(1, GL_FLOAT, 4 * sizeof(float), (const void*)(3 * sizeof(float)));
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, (RING_SEGMENTS + 1) * 2);
+    perfCount(PERF_TEXTURE_BINDS);
+    perfCount(PERF_DRAW_CALLS);
+    perfCount(PERF_TRIANGLES, RING_SEGMENTS * 2);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (ringProgram) glUseProgram(0);
+    glBindTexture(GL_TEXTURE_1D, 0);
+    glPopAttrib();
+}
@@ -0,0 +1,20 @@
+// Rings.h
+#pragma once
+#include <GL/glew.h>
+
+// Saturn's ring system as one annulus mesh. Radial density and color come
+// from a 1D texture indexed by distance from the planet, so the whole ring
+// system is a single draw call.
+const int RING_SEGMENTS = 256;        // Angular resolution of the annulus
+const int RING_TEXTURE_SIZE = 512;    // Texels across the radial profile
+const float RING_INNER_RADII = 1.24f; // Inner edge (C ring) in planet radii
+const float RING_OUTER_RADII = 2.27f; // Outer edge (A ring) in planet radii
+
+// Build the mesh, the radial texture and the ring shader
+void initRings(float planetRadius);
+
+// Draw the rings in the current modelview, which must place the planet at
+// the origin with the ring plane as XZ. sunEye is the Sun's eye-space
+// position; with shadows on, the planet's shadow is computed analytically
+// per pixel.
+void drawRings(const float* sunEye, bool shadows);
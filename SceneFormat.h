@@ -0,0 +1,45 @@
+// SceneFormat.h
+#pragma once
+#include <cstdint>
+
+// Binary scene layout, shared by the renderer and tools/sceneconv.cpp.
+// A SceneHeader is followed by one array per column, each `bodyCount`
+// 4-byte values long and 16-byte aligned, then a table of NUL-terminated
+// strings. Columns are used in place from the mapped file as the body table.
+//
+// Bodies are sorted by depth in the hierarchy: levelStart[l] is the first
+// body of level l, so every parent precedes its children and each level can
+// be updated in parallel.
+const char SCENE_MAGIC[4] = { 'S', 'C', 'N', 'E' };
+const uint32_t SCENE_VERSION = 1;
+const int SCENE_MAX_LEVELS = 8;
+
+enum SceneColumn {
+    SCENE_KIND,        // int32 BodyKind
+    SCENE_PARENT,      // int32 body index, -1 for a root
+    SCENE_FLAGS,       // int32 BodyFlags
+    SCENE_NAME,        // int32 string offset, -1 for none
+    SCENE_TEXTURE,     // int32 string offset, -1 for bodies drawn as points
+    SCENE_FRAME_SLOT,  // int32 frame index, -1 for bodies that need no frame
+    SCENE_RADIUS,      // float
+    SCENE_DISTANCE,    // float, from the parent
+    SCENE_INCLINATION, // float degrees about Z, applied before the orbit angle
+    SCENE_PHASE,       // float degrees at time zero
+    SCENE_ORBIT_RATE,  // float degrees per second
+    SCENE_SPIN_RATE,   // float degrees per second
+    SCENE_COLUMN_COUNT
+};
+
+struct SceneHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t bodyCount;
+    uint32_t frameCount;   // Bodies with a texture or children keep a full frame
+    uint32_t levelCount;
+    uint32_t levelStart[SCENE_MAX_LEVELS + 1];
+    uint64_t columnOffset[SCENE_COLUMN_COUNT]; // Byte offsets from the start of the file
+    uint64_t stringOffset;
+    uint64_t stringSize;
+};
+
+static_assert(sizeof(SceneHeader) == 168, "SceneHeader must be 168 bytes");
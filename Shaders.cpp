@@ -0,0 +1,59 @@
+// Shaders.cpp
+#include "Shaders.h"
+#include <iostream>
+#include <vector>
+
+// Compile one shader stage, printing the log on failure
+static GLuint compileStage(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+
+    GLint ok = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        GLint length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::vector<char> log(length + 1, '\0');
+        glGetShaderInfoLog(shader, length, nullptr, log.data());
+        std::cerr << "Shader compilation failed: " << log.data() << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+GLuint compileShaderProgram(const char* vertexSource, const char* fragmentSource) {
+    if (!GLEW_VERSION_2_0) {
+        std::cerr << "GLSL is not supported by this driver" << std::endl;
+        return 0;
+    }
+
+    GLuint vs = compileStage(GL_VERTEX_SHADER, vertexSource);
+    GLuint fs = compileStage(GL_FRAGMENT_SHADER, fragmentSource);
+    if (!vs || !fs) {
+        if (vs) glDeleteShader(vs);
+        if (fs) glDeleteShader(fs);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    glLinkProgram(program);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    GLint ok = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        std::vector<char> log(length + 1, '\0');
+        glGetProgramInfoLog(program, length, nullptr, log.data());
+        std::cerr << "Shader link failed: " << log.data() << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
@@ -0,0 +1,8 @@
+// Shaders.h
+#pragma once
+#include <GL/glew.h>
+
+// Compile and link a GLSL program from vertex and fragment source strings.
+// Returns 0 (after printing the info log) if compilation or linking fails,
+// or if the driver has no GLSL support.
+GLuint compileShaderProgram(const char* vertexSource, const char* fragmentSource);
@@ -0,0 +1,415 @@
+// SoftRaster.cpp
+#include "SoftRaster.h"
+#include "Jobs.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFT_RASTER_SSE2 1
+#endif
+
+// Unit sphere vertex: position doubles as the normal
+struct MeshVertex {
+    float x, y, z;
+    float s, t;
+};
+
+struct SphereMesh {
+    std::vector<MeshVertex> vertices;
+    std::vector<int> indices;
+};
+
+// Clip-space vertex with everything that is interpolated
+struct ClipVertex {
+    float x, y, z, w;
+    float s, t;
+    float light;
+};
+
+// Screen-space triangle ready for rasterization. The edge functions are
+// pre-scaled by 1 / area, so at a pixel they give the barycentric weights.
+struct Triangle {
+    float edgeA[3], edgeB[3], edgeC[3];
+    float z[3];                  // NDC depth mapped to [0, 1]
+    float invW[3], sw[3], tw[3], lw[3]; // Perspective-correct attributes (divided by w)
+    int minX, minY, maxX, maxY;  // Pixel bounds, inclusive
+    const SoftTexture* texture;
+};
+
+struct Point {
+    int x, y;
+    float z;
+    unsigned char color[4];
+};
+
+static int frameWidth = 0, frameHeight = 0, stride = 0;
+static int tilesX = 0, tilesY = 0;
+static std::vector<unsigned char> colorBuffer;
+static std::vector<float> depthBuffer;
+
+static float viewMatrix[16], projectionMatrix[16];
+static float lightPosition[3] = { 0.0f, 0.0f, 0.0f };
+static std::vector<Triangle> triangles;
+static std::vector<Point> points;
+static std::vector<ClipVertex> clipVertices; // One sphere's transformed vertices, reused
+static std::vector<std::vector<int>> triangleBins, pointBins;
+static std::map<int, SphereMesh> sphereMeshes; // By detail level
+
+// Column-major 4x4 product a * b
+static void multiply(const float* a, const float* b, float* out) {
+    for (int c = 0; c < 4; ++c) {
+        for (int r = 0; r < 4; ++r) {
+            out[4 * c + r] = a[r] * b[4 * c] + a[4 + r] * b[4 * c + 1] + a[8 + r] * b[4 * c + 2] + a[12 + r] * b[4 * c + 3];
+        }
+    }
+}
+
+// Same vertices, texture coordinates and winding as gluSphere(quad, 1, detail, detail)
+static const SphereMesh& sphereMesh(int detail) {
+    auto it = sphereMeshes.find(detail);
+    if (it != sphereMeshes.end()) return it->second;
+
+    const float pi = 3.14159265f;
+    SphereMesh& mesh = sphereMeshes[detail];
+    for (int i = 0; i <= detail; ++i) {
+        float rho = i * pi / detail;
+        for (int j = 0; j <= detail; ++j) {
+            float theta = j * 2.0f * pi / detail;
+            MeshVertex v = { -sinf(theta) * sinf(rho), cosf(theta) * sinf(rho), cosf(rho),
+                (float)j / detail, 1.0f - (float)i / detail };
+            mesh.vertices.push_back(v);
+        }
+    }
+    for (int i = 0; i < detail; ++i) {
+        for (int j = 0; j < detail; ++j) {
+            int a = i * (detail + 1) + j, b = a + detail + 1;
+            int quad[6] = { a, b, a + 1, a + 1, b, b + 1 };
+            mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+        }
+    }
+    return mesh;
+}
+
+void softBeginFrame(int width, int height, const float* modelview, const float* projection) {
+    if (width != frameWidth || height != frameHeight) {
+        frameWidth = width;
+        frameHeight = height;
+        stride = (width + 3) & ~3; // Whole SIMD groups on every row
+        colorBuffer.assign((size_t)stride * height * 4, 0);
+        depthBuffer.assign((size_t)stride * height, 1.0f);
+        tilesX = (width + SOFT_TILE_SIZE - 1) / SOFT_TILE_SIZE;
+        tilesY = (height + SOFT_TILE_SIZE - 1) / SOFT_TILE_SIZE;
+        triangleBins.assign((size_t)tilesX * tilesY, std::vector<int>());
+        pointBins.assign((size_t)tilesX * tilesY, std::vector<int>());
+    }
+    memcpy(viewMatrix, modelview, sizeof(viewMatrix));
+    memcpy(projectionMatrix, projection, sizeof(projectionMatrix));
+
+    triangles.clear();
+    points.clear();
+    for (auto& bin : triangleBins) bin.clear();
+    for (auto& bin : pointBins) bin.clear();
+}
+
+// Project a clipped triangle, cull back faces and bin it
+static void setupTriangle(const ClipVertex* v, const SoftTexture* texture) {
+    float sx[3], sy[3];
+    Triangle tri;
+    for (int k = 0; k < 3; ++k) {
+        float invW = 1.0f / v[k].w;
+        sx[k] = (v[k].x * invW * 0.5f + 0.5f) * frameWidth;
+        sy[k] = (v[k].y * invW * 0.5f + 0.5f) * frameHeight;
+        tri.z[k] = v[k].z * invW * 0.5f + 0.5f;
+        tri.invW[k] = invW;
+        tri.sw[k] = v[k].s * invW;
+        tri.tw[k] = v[k].t * invW;
+        tri.lw[k] = v[k].light * invW;
+    }
+
+    // Counter-clockwise faces the viewer (y points up)
+    float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sx[2] - sx[0]) * (sy[1] - sy[0]);
+    if (area <= 0.0f) return;
+
+    tri.minX = std::max((int)floorf(std::min({ sx[0], sx[1], sx[2] })), 0);
+    tri.minY = std::max((int)floorf(std::min({ sy[0], sy[1], sy[2] })), 0);
+    tri.maxX = std::min((int)ceilf(std::max({ sx[0], sx[1], sx[2] })), frameWidth - 1);
+    tri.maxY = std::min((int)ceilf(std::max({ sy[0], sy[1], sy[2] })), frameHeight - 1);
+    if (tri.minX > tri.maxX || tri.minY > tri.maxY) return;
+
+    // Edge k is opposite vertex k, so its function is vertex k's weight
+    for (int k = 0; k < 3; ++k) {
+        int a = (k + 1) % 3, b = (k + 2) % 3;
+        tri.edgeA[k] = (sy[a] - sy[b]) / area;
+        tri.edgeB[k] = (sx[b] - sx[a]) / area;
+        tri.edgeC[k] = (sx[a] * sy[b] - sx[b] * sy[a]) / area;
+    }
+    tri.texture = texture;
+
+    int index = (int)triangles.size();
+    triangles.push_back(tri);
+    for (int ty = tri.minY / SOFT_TILE_SIZE; ty <= tri.maxY / SOFT_TILE_SIZE; ++ty) {
+        for (int tx = tri.minX / SOFT_TILE_SIZE; tx <= tri.maxX / SOFT_TILE_SIZE; ++tx) {
+            triangleBins[ty * tilesX + tx].push_back(index);
+        }
+    }
+}
+
+static ClipVertex lerp(const ClipVertex& a, const ClipVertex& b, float f) {
+    ClipVertex v;
+    v.x = a.x + (b.x - a.x) * f;
+    v.y = a.y + (b.y - a.y) * f;
+    v.z = a.z + (b.z - a.z) * f;
+    v.w = a.w + (b.w - a.w) * f;
+    v.s = a.s + (b.s - a.s) * f;
+    v.t = a.t + (b.t - a.t) * f;
+    v.light = a.light + (b.light - a.light) * f;
+    return v;
+}
+
+// Clip against the near plane (z >= -w); the result is a fan of up to two triangles
+static void clipTriangle(const ClipVertex* in, const SoftTexture* texture) {
+    float d[3];
+    int inside = 0;
+    for (int k = 0; k < 3; ++k) {
+        d[k] = in[k].z + in[k].w;
+        if (d[k] >= 0.0f) ++inside;
+    }
+    if (inside == 3) {
+        setupTriangle(in, texture);
+        return;
+    }
+    if (inside == 0) return;
+
+    ClipVertex polygon[4];
+    int count = 0;
+    for (int k = 0; k < 3; ++k) {
+        const ClipVertex& a = in[k];
+        const ClipVertex& b = in[(k + 1) % 3];
+        float da = d[k], db = d[(k + 1) % 3];
+        if (da >= 0.0f) polygon[count++] = a;
+        if ((da >= 0.0f) != (db >= 0.0f)) polygon[count++] = lerp(a, b, da / (da - db));
+    }
+    for (int k = 1; k + 1 < count; ++k) {
+        ClipVertex tri[3] = { polygon[0], polygon[k], polygon[k + 1] };
+        setupTriangle(tri, texture);
+    }
+}
+
+void softSetLight(float x, float y, float z) {
+    lightPosition[0] = x;
+    lightPosition[1] = y;
+    lightPosition[2] = z;
+}
+
+void softDrawSphere(const float* frame, float radius, int detail, const SoftTexture* texture, bool emissive) {
+    const SphereMesh& mesh = sphereMesh(detail);
+    float modelview[16], mvp[16];
+    multiply(viewMatrix, frame, modelview);
+    multiply(projectionMatrix, modelview, mvp);
+
+    // Transform and light each vertex once
+    std::vector<ClipVertex>& clip = clipVertices;
+    clip.resize(mesh.vertices.size());
+    for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+        const MeshVertex& m = mesh.vertices[i];
+        float px = m.x * radius, py = m.y * radius, pz = m.z * radius;
+        ClipVertex& v = clip[i];
+        v.x = mvp[0] * px + mvp[4] * py + mvp[8] * pz + mvp[12];
+        v.y = mvp[1] * px + mvp[5] * py + mvp[9] * pz + mvp[13];
+        v.z = mvp[2] * px + mvp[6] * py + mvp[10] * pz + mvp[14];
+        v.w = mvp[3] * px + mvp[7] * py + mvp[11] * pz + mvp[15];
+        v.s = m.s;
+        v.t = m.t;
+
+        if (emissive) {
+            v.light = 1.0f;
+            continue;
+        }
+        // Ambient 0.2 plus diffuse from the light; w is the light-to-vertex vector
+        float wx = frame[0] * px + frame[4] * py + frame[8] * pz + frame[12] - lightPosition[0];
+        float wy = frame[1] * px + frame[5] * py + frame[9] * pz + frame[13] - lightPosition[1];
+        float wz = frame[2] * px + frame[6] * py + frame[10] * pz + frame[14] - lightPosition[2];
+        float nx = frame[0] * m.x + frame[4] * m.y + frame[8] * m.z;
+        float ny = frame[1] * m.x + frame[5] * m.y + frame[9] * m.z;
+        float nz = frame[2] * m.x + frame[6] * m.y + frame[10] * m.z;
+        float distance = sqrtf(wx * wx + wy * wy + wz * wz);
+        float diffuse = distance > 0.0f ? -(nx * wx + ny * wy + nz * wz) / distance : 0.0f;
+        v.light = std::min(0.2f + std::max(diffuse, 0.0f), 1.0f);
+    }
+
+    for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+        ClipVertex tri[3] = { clip[mesh.indices[i]], clip[mesh.indices[i + 1]], clip[mesh.indices[i + 2]] };
+        clipTriangle(tri, texture);
+    }
+}
+
+void softDrawPoints(const float* xyz, int count, unsigned char r, unsigned char g, unsigned char b) {
+    float mvp[16];
+    multiply(projectionMatrix, viewMatrix, mvp);
+    for (int i = 0; i < count; ++i) {
+        const float* p = xyz + 3 * i;
+        float w = mvp[3] * p[0] + mvp[7] * p[1] + mvp[11] * p[2] + mvp[15];
+        float z = mvp[2] * p[0] + mvp[6] * p[1] + mvp[10] * p[2] + mvp[14];
+        if (z < -w) continue; // In front of the near plane
+        float x = mvp[0] * p[0] + mvp[4] * p[1] + mvp[8] * p[2] + mvp[12];
+        float y = mvp[1] * p[0] + mvp[5] * p[1] + mvp[9] * p[2] + mvp[13];
+
+        Point point;
+        point.x = (int)((x / w * 0.5f + 0.5f) * frameWidth);
+        point.y = (int)((y / w * 0.5f + 0.5f) * frameHeight);
+        if (point.x < 0 || point.y < 0 || point.x >= frameWidth || point.y >= frameHeight) continue;
+        point.z = z / w * 0.5f + 0.5f;
+        point.color[0] = r;
+        point.color[1] = g;
+        point.color[2] = b;
+        point.color[3] = 255;
+
+        pointBins[(point.y / SOFT_TILE_SIZE) * tilesX + point.x / SOFT_TILE_SIZE].push_back((int)points.size());
+        points.push_back(point);
+    }
+}
+
+void sampleSoftTexture(const SoftTexture* texture, float s, float t, float* rgb) {
+    float fx = (s - floorf(s)) * texture->width - 0.5f;
+    float fy = std::min(std::max(t, 0.0f), 1.0f) * texture->height - 0.5f;
+    int x0 = (int)floorf(fx), y0 = (int)floorf(fy);
+    float ax = fx - x0, ay = fy - y0;
+    int x1 = (x0 + 1) % texture->width;
+    x0 = (x0 + texture->width) % texture->width;
+    int y1 = std::min(y0 + 1, texture->height - 1);
+    y0 = std::max(y0, 0);
+
+    const unsigned char* p00 = &texture->rgb[((size_t)y0 * texture->width + x0) * 3];
+    const unsigned char* p10 = &texture->rgb[((size_t)y0 * texture->width + x1) * 3];
+    const unsigned char* p01 = &texture->rgb[((size_t)y1 * texture->width + x0) * 3];
+    const unsigned char* p11 = &texture->rgb[((size_t)y1 * texture->width + x1) * 3];
+    for (int c = 0; c < 3; ++c) {
+        float top = p00[c] + (p10[c] - p00[c]) * ax;
+        float bottom = p01[c] + (p11[c] - p01[c]) * ax;
+        rgb[c] = top + (bottom - top) * ay;
+    }
+}
+
+// Interpolate, texture and write one covered pixel that passed the depth test
+static void shadePixel(const Triangle& tri, float b0, float b1, float b2, float z, size_t index) {
+    float invW = b0 * tri.invW[0] + b1 * tri.invW[1] + b2 * tri.invW[2];
+    float w = 1.0f / invW;
+    float light = (b0 * tri.lw[0] + b1 * tri.lw[1] + b2 * tri.lw[2]) * w;
+
+    float rgb[3] = { 255.0f, 255.0f, 255.0f };
+    if (tri.texture && !tri.texture->rgb.empty()) {
+        float s = (b0 * tri.sw[0] + b1 * tri.sw[1] + b2 * tri.sw[2]) * w;
+        float t = (b0 * tri.tw[0] + b1 * tri.tw[1] + b2 * tri.tw[2]) * w;
+        sampleSoftTexture(tri.texture, s, t, rgb);
+    }
+
+    unsigned char* out = &colorBuffer[index * 4];
+    for (int c = 0; c < 3; ++c) {
+        out[c] = (unsigned char)std::min(rgb[c] * light + 0.5f, 255.0f);
+    }
+    out[3] = 255;
+    depthBuffer[index] = z;
+}
+
+// Rasterize the part of a triangle inside one tile, four pixels at a time
+static void rasterTriangle(const Triangle& tri, int x0, int y0, int x1, int y1) {
+    int minX = std::max(tri.minX, x0) & ~3; // Start on a SIMD group
+    int minY = std::max(tri.minY, y0);
+    int maxX = std::min(tri.maxX, x1);
+    int maxY = std::min(tri.maxY, y1);
+
+    for (int y = minY; y <= maxY; ++y) {
+        float py = y + 0.5f;
+        size_t row = (size_t)y * stride;
+#ifdef SOFT_RASTER_SSE2
+        const __m128 zero = _mm_setzero_ps();
+        __m128 e[3], step[3];
+        __m128 px = _mm_add_ps(_mm_set1_ps(minX + 0.5f), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+        for (int k = 0; k < 3; ++k) {
+            e[k] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.edgeA[k]), px), _mm_set1_ps(tri.edgeB[k] * py + tri.edgeC[k]));
+            step[k] = _mm_set1_ps(4.0f * tri.edgeA[k]);
+        }
+        __m128 z0 = _mm_set1_ps(tri.z[0]), z1 = _mm_set1_ps(tri.z[1]), z2 = _mm_set1_ps(tri.z[2]);
+
+        for (int x = minX; x <= maxX; x += 4) {
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e[0], zero), _mm_cmpge_ps(e[1], zero)), _mm_cmpge_ps(e[2], zero));
+            int mask = _mm_movemask_ps(inside);
+            if (mask) {
+                __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e[0], z0), _mm_mul_ps(e[1], z1)), _mm_mul_ps(e[2], z2));
+                __m128 stored = _mm_loadu_ps(&depthBuffer[row + x]);
+                mask &= _mm_movemask_ps(_mm_cmplt_ps(z, stored));
+                if (mask) {
+                    alignas(16) float b[3][4], zs[4];
+                    for (int k = 0; k < 3; ++k) _mm_store_ps(b[k], e[k]);
+                    _mm_store_ps(zs, z);
+                    for (int lane = 0; lane < 4; ++lane) {
+                        if ((mask & (1 << lane)) && x + lane >= x0 && x + lane <= maxX) {
+                            shadePixel(tri, b[0][lane], b[1][lane], b[2][lane], zs[lane], row + x + lane);
+                        }
+                    }
+                }
+            }
+            for (int k = 0; k < 3; ++k) e[k] = _mm_add_ps(e[k], step[k]);
+        }
+#else
+        for (int x = minX; x <= maxX; ++x) {
+            if (x < x0) continue;
+            float pxf = x + 0.5f;
+            float b0 = tri.edgeA[0] * pxf + tri.edgeB[0] * py + tri.edgeC[0];
+            float b1 = tri.edgeA[1] * pxf + tri.edgeB[1] * py + tri.edgeC[1];
+            float b2 = tri.edgeA[2] * pxf + tri.edgeB[2] * py + tri.edgeC[2];
+            if (b0 < 0.0f || b1 < 0.0f || b2 < 0.0f) continue;
+            float z = b0 * tri.z[0] + b1 * tri.z[1] + b2 * tri.z[2];
+            if (z < depthBuffer[row + x]) shadePixel(tri, b0, b1, b2, z, row + x);
+        }
+#endif
+    }
+}
+
+// Clear and draw one tile; tiles never share pixels, so they run in parallel
+static void rasterTiles(void* data, int begin, int end) {
+    for (int tile = begin; tile < end; ++tile) {
+        int x0 = (tile % tilesX) * SOFT_TILE_SIZE, y0 = (tile / tilesX) * SOFT_TILE_SIZE;
+        int x1 = std::min(x0 + SOFT_TILE_SIZE, frameWidth) - 1;
+        int y1 = std::min(y0 + SOFT_TILE_SIZE, frameHeight) - 1;
+
+        for (int y = y0; y <= y1; ++y) {
+            size_t row = (size_t)y * stride;
+            memset(&colorBuffer[(row + x0) * 4], 0, (size_t)(x1 - x0 + 1) * 4);
+            std::fill(depthBuffer.begin() + row + x0, depthBuffer.begin() + row + x1 + 1, 1.0f);
+        }
+
+        for (int index : triangleBins[tile]) {
+            rasterTriangle(triangles[index], x0, y0, x1, y1);
+        }
+        for (int index : pointBins[tile]) {
+            const Point& p = points[index];
+            size_t i = (size_t)p.y * stride + p.x;
+            if (p.z < depthBuffer[i]) {
+                memcpy(&colorBuffer[i * 4], p.color, 4);
+                depthBuffer[i] = p.z;
+            }
+        }
+    }
+}
+
+void softEndFrame() {
+    JobCounter done;
+    parallelFor(tilesX * tilesY, 1, rasterTiles, nullptr, &done);
+    waitForCounter(&done);
+}
+
+const unsigned char* softColorBuffer() {
+    return colorBuffer.data();
+}
+
+int softStride() {
+    return stride;
+}
+
+int softTriangleCount() {
+    return (int)triangles.size();
+}
@@ -0,0 +1,44 @@
+// SoftRaster.h
+#pragma once
+#include <vector>
+
+// CPU rendering backend for machines without a GPU. Spheres are tessellated
+// like gluSphere(), clipped against the near plane and binned into
+// SOFT_TILE_SIZE square screen tiles. Tiles are rasterized in parallel on
+// the job system, four pixels at a time with SSE2 edge functions and depth
+// tests, with perspective-correct bilinear texturing and Gouraud lighting
+// from a point light (the Sun).
+const int SOFT_TILE_SIZE = 64;
+
+// RGB texture with rows bottom-up, as uploaded to GL
+struct SoftTexture {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> rgb;
+};
+
+// Bilinear lookup (0-255 per channel), repeating in s and clamped in t
+void sampleSoftTexture(const SoftTexture* texture, float s, float t, float* rgb);
+
+// Start a frame. Matrices are column-major, as returned by glGetFloatv().
+void softBeginFrame(int width, int height, const float* modelview, const float* projection);
+
+// Position of the point light, in the same space as the frames
+void softSetLight(float x, float y, float z);
+
+// Queue a textured sphere placed by a column-major frame matrix. Emissive
+// spheres (stars) ignore lighting.
+void softDrawSphere(const float* frame, float radius, int detail, const SoftTexture* texture, bool emissive);
+
+// Queue single-pixel points from interleaved world-space positions
+void softDrawPoints(const float* xyz, int count, unsigned char r, unsigned char g, unsigned char b);
+
+// Rasterize everything queued since softBeginFrame()
+void softEndFrame();
+
+// RGBA pixels, rows bottom-up with a stride of softStride() pixels
+const unsigned char* softColorBuffer();
+int softStride();
+
+// Triangles rasterized in the last frame (after culling and clipping)
+int softTriangleCount();
@@ -1,14 +1,48 @@
+#include <GL/glew.h>
 #include <GL/glut.h>
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <fstream>
+#include <map>
 #include <string>
-
-// Rotation angle for the planets
-float angle = 0.0f;
-GLuint textures[10]; // Array to hold textures for Sun and planets
-GLuint backgroundTexture; // Texture for the Milky Way background
-GLuint moonTexture; // Texture for all moons (using the same texture for simplicity)
+#include <thread>
+#include <vector>
+#include "Bodies.h"
+#include "Trails.h"
+#include "Orbits.h"
+#include "Rings.h"
+#include "Hud.h"
+#include "Bvh.h"
+#include "Stars.h"
+#include "Jobs.h"
+#include "FramePacer.h"
+#include "Checkpoint.h"
+#include "Capture.h"
+#include "SoftRaster.h"
+#include "RayTrace.h"
+#include "Farm.h"
+#include "Atmosphere.h"
+#include "Residency.h"
+#include "Terrain.h"
+#include "FrameArena.h"
+#include "Allocations.h"
+#include "PerfCounters.h"
+#include "Comets.h"
+#include "Telemetry.h"
+#include "RenderServer.h"
+#include "Image.h"
+#include "Collisions.h"
+
+// Simulation clock in seconds, advanced in fixed steps
+double simulationTime = 0.0;
+const char* scenePath = "scene/solar.scn"; // Changed with --scene
+int backgroundTexture = -1; // Residency handle of the Milky Way background
+bool starCatalogLoaded = false;      // Star field replaces the Milky Way sphere when available
+float starLimitingMagnitude = 6.5f;  // Faintest star drawn, adjusted with '[' and ']'
 float zoomLevel = -30.0f; // Zoom level (distance from the camera)
 
 // Global variables for camera control
@@ -17,48 +51,118 @@ float cameraAngleY = 0.0f; // Vertical angle
 float lastMouseX = 0.0f;   // Last mouse X position
 float lastMouseY = 0.0f;   // Last mouse Y position
 bool isDragging = false;   // Track if mouse is dragging
-
-// Number of planets (excluding the Sun)
-const int NUM_PLANETS = 9;
-
-// Moon properties
-struct Moon {
-    float orbitDistance;  // Distance from the planet
-    float orbitSpeed;     // Degrees per update
-    float rotationSpeed;  // Degrees per update
-};
-
-// Array to hold moon properties for each planet
-Moon moons[NUM_PLANETS];
-
-// Current angles for moons' orbits and rotations
-float moonOrbitAngles[NUM_PLANETS] = { 0.0f };
-float moonRotationAngles[NUM_PLANETS] = { 0.0f };
-
-// Orbital inclinations in degrees for each planet
-float orbitalInclinations[NUM_PLANETS] = {
-    7.0f,    // Mercury
-    3.4f,    // Venus
-    0.0f,    // Earth
-    1.85f,   // Mars
-    1.3f,    // Jupiter
-    2.5f,    // Saturn
-    0.8f,    // Uranus
-    1.77f,   // Neptune
-    17.16f   // Pluto
+float pressMouseX = 0.0f;  // Where the left button went down, to tell clicks from drags
+float pressMouseY = 0.0f;
+int followBody = -1;       // Body the camera follows after a click (-1 for none)
+const float FOLLOW_MIN_ALTITUDE = 1e-4f; // Closest approach to a followed body's surface, in its radii
+
+// Bodies drawn as textured spheres, with their textures (residency handles)
+std::vector<int> sphereBodies;
+std::vector<int> sphereTextures;
+size_t textureBudget = RESIDENCY_BUDGET_BYTES; // Changed with --texture-budget
+bool residencyPollArmed = false;               // A redraw is scheduled to pick up streamed textures and terrain
+std::vector<Terrain*> sphereTerrains;          // Surface detail from terrain/<name>.ter, null without one
+std::vector<char> sphereVisible;               // In the view this frame (GL only)
+std::vector<float> sphereCoverage;             // Screen pixels of each visible sphere's texture
+int culledSpheres = 0;
+
+// --software draws the bodies with the CPU rasterizer (SoftRaster.h), which
+// keeps its own copy of each texture
+bool softwareRendering = false;
+std::map<int32_t, SoftTexture> softTextures;
+std::vector<const SoftTexture*> sphereSoftTextures;
+
+// Bodies without a texture are drawn as points from an interleaved copy of their positions
+std::vector<int> pointBodies;
+std::vector<float> pointVertices;
+
+// Bodies that record a trail or get a HUD label, and their gathered trail positions
+std::vector<int> trailBodies;
+std::vector<int> labelBodies;
+std::vector<float> trailX, trailY, trailZ;
+
+// Bodies are updated level by level in jobs of this many bodies
+const int BODY_JOB_GRAIN = 4096;
+
+bool showTrails = true; // Toggled with 't'
+bool showOrbits = true; // Toggled with 'o'
+bool showComets = true; // Toggled with 'c'
+bool collisionDetection = true; // Toggled with 'x', off with --no-collisions
+
+int ringBody = -1;                    // Body drawn with a ring system (Saturn)
+const float SATURN_RING_TILT = 26.7f; // Ring plane tilt in degrees
+bool saturnRingShadows = true;        // Saturn's shadow on its rings
+float sunEyePos[3];                   // Sun position in eye space for this frame
+std::vector<int> atmosphereBodies;    // Bodies drawn with a scattering shell
+std::vector<AtmosphereModel*> atmosphereModels;
+GLfloat cameraMatrix[16];             // Camera modelview for this frame, relative to the floating origin
+
+// Reverse-Z depth: depth 1 at the near plane falling toward 0 at infinity,
+// stored as floats, so precision follows float spacing and one pass covers
+// moon close-ups and the outer planets. Needs clip control and a float
+// depth buffer, so the scene is drawn into an offscreen framebuffer.
+// Close to a followed body's surface the near plane moves in with the
+// camera, down to REVERSE_Z_MIN_NEAR.
+bool reverseDepth = false;
+const double REVERSE_Z_NEAR = 0.01;
+const double REVERSE_Z_MIN_NEAR = 1e-6;
+double nearPlane = REVERSE_Z_NEAR;
+GLuint sceneFramebuffer = 0, sceneColorBuffer = 0, sceneDepthBuffer = 0;
+
+// Window size and HUD state
+int windowWidth = 800, windowHeight = 600;
+bool showHud = true;    // Toggled with 'h'
+bool showPerfOverlay = false; // Frame-time graph and counters, toggled with 'f'
+int fpsFrames = 0;      // Frames since fpsStartTime
+int fpsStartTime = 0;   // In milliseconds since glutInit
+float currentFps = 0.0f;
+
+// Heap allocations between the last two presented frames (see Allocations.h)
+uint64_t frameAllocationsStart = 0;
+int lastFrameAllocations = 0;
+
+// Fixed-step simulation clock (see FramePacer.h)
+double lastSimulationTime = 0.0;
+double simulationAccumulator = 0.0;
+
+// Redraws are requested only when something visible changed, so a paused
+// scene sleeps in the GLUT event loop instead of redrawing at 60 Hz. The
+// flags say what changed, and display() skips the work they leave valid.
+enum DirtyFlags {
+    DIRTY_CAMERA = 1 << 0,     // Camera angle, zoom or followed body
+    DIRTY_WINDOW = 1 << 1,     // Window size
+    DIRTY_SIMULATION = 1 << 2, // Body positions
+    DIRTY_OPTIONS = 1 << 3,    // Display toggles (trails, orbits, HUD, stars)
+    DIRTY_TEXTURES = 1 << 4    // Streamed texture levels arrived
 };
-
-// Function to load a BMP texture
-GLuint loadBMPTexture(const char* filename) {
-    GLuint texture;
-    int width, height;
-    unsigned char* data;
-
+const unsigned int DIRTY_VIEW = DIRTY_CAMERA | DIRTY_WINDOW | DIRTY_SIMULATION; // Bodies moved on screen
+unsigned int dirtyFlags = ~0u;  // Everything is new for the first frame
+double redrawRequestTime = 0.0; // When the first change since the last frame was marked
+double lastSwapTime = 0.0;
+bool idleSinceSwap = true;      // Paused at the last swap, so no update timer drove the next frame
+bool orbitViewStale = true;     // The view moved since the orbits were last tessellated
+
+// Periodic checkpoints of the simulation state ('k' writes one at once)
+const char* checkpointPath = "checkpoint.ckpt";
+double checkpointInterval = 0.0; // Simulation seconds between checkpoints, 0 for none
+double nextCheckpointTime = 0.0;
+
+// Shared-memory region the body positions are published to every tick (--telemetry)
+const char* telemetryName = nullptr;
+
+// Video capture, toggled with 'v'
+const char* capturePath = "capture.mp4"; // Changed with --capture, which also starts recording
+bool captureOnStart = false;
+bool simulationPaused = false;
+int updateGeneration = 0; // Timers armed for an older generation are ignored
+
+// Function to load a 24-bit BMP image as RGB, rows bottom-up
+bool loadBMP(const char* filename, int& width, int& height, std::vector<unsigned char>& data) {
     FILE* file;
     errno_t err = fopen_s(&file, filename, "rb"); // Use fopen_s for safety
     if (err != 0 || !file) {
         std::cerr << "Failed to open texture file: " << filename << std::endl;
-        return 0;
+        return false;
     }
 
     unsigned char header[54];
@@ -68,7 +172,7 @@ GLuint loadBMPTexture(const char* filename) {
     if (header[0] != 'B' || header[1] != 'M') {
         std::cerr << "Not a valid BMP file: " << filename << std::endl;
         fclose(file);
-        return 0;
+        return false;
     }
 
     width = *(int*)&header[18];
@@ -79,34 +183,30 @@ GLuint loadBMPTexture(const char* filename) {
     if (bitsPerPixel != 24) {
         std::cerr << "Only 24-bit BMP files are supported: " << filename << std::endl;
         fclose(file);
-        return 0;
+        return false;
     }
 
     int imageSize = 3 * width * height;
-    data = new unsigned char[imageSize];
-    if (!data) {
-        std::cerr << "Failed to allocate memory for texture: " << filename << std::endl;
-        fclose(file);
-        return 0;
-    }
-
-    fread(data, sizeof(unsigned char), imageSize, file);
+    data.assign(imageSize, 0);
+    fread(data.data(), sizeof(unsigned char), imageSize, file);
     fclose(file);
 
     for (int i = 0; i < imageSize; i += 3) {
         std::swap(data[i], data[i + 2]); // Convert BGR to RGB
     }
+    return true;
+}
 
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // Upload texture data
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-
-    delete[] data;
-    return texture;
+// Textured, smooth-shaded quadric shared by every sphere, made on first use
+// rather than allocated per draw
+GLUquadric* sphereQuadric() {
+    static GLUquadric* quad = nullptr;
+    if (!quad) {
+        quad = gluNewQuadric();
+        gluQuadricTexture(quad, GL_TRUE);
+        gluQuadricNormals(quad, GLU_SMOOTH);
+    }
+    return quad;
 }
 
 // Function to draw a textured sphere
@@ -115,12 +215,11 @@ void drawTexturedSphere(GLuint texture, float radius, int slices, int stacks) {
     glBindTexture(GL_TEXTURE_2D, texture);
 
     glColor3f(1.0f, 1.0f, 1.0f); // White color to display texture
-    GLUquadric* quad = gluNewQuadric();
-    gluQuadricTexture(quad, GL_TRUE);
-    gluQuadricNormals(quad, GLU_SMOOTH);
-    gluSphere(quad, radius, slices, stacks);
-    gluDeleteQuadric(quad);
+    gluSphere(sphereQuadric(), radius, slices, stacks);
     glDisable(GL_TEXTURE_2D);
+    perfCount(PERF_TEXTURE_BINDS);
+    perfCount(PERF_DRAW_CALLS, stacks); // One strip per stack
+    perfCount(PERF_TRIANGLES, 2 * slices * stacks);
 }
 
 // Function to draw the Milky Way background
@@ -128,241 +227,749 @@ void drawBackground() {
     glPushMatrix();
 
     glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, backgroundTexture);
+    glBindTexture(GL_TEXTURE_2D, residentTexture(backgroundTexture));
 
     glColor3f(1.0f, 1.0f, 1.0f); // White color to display the texture
-    GLUquadric* quad = gluNewQuadric();
-    gluQuadricTexture(quad, GL_TRUE);
-    gluQuadricNormals(quad, GLU_SMOOTH);
-    gluSphere(quad, 50.0f, 50, 50); // Large sphere radius
-    gluDeleteQuadric(quad);
+    gluSphere(sphereQuadric(), 50.0f, 50, 50); // Large sphere radius
+    perfCount(PERF_TEXTURE_BINDS);
+    perfCount(PERF_DRAW_CALLS, 50);
+    perfCount(PERF_TRIANGLES, 2 * 50 * 50);
 
     glDisable(GL_TEXTURE_2D);
 
     glPopMatrix();
 }
 
-// Function to draw a moon for a given planet
-void drawMoon(int planetIndex, float planetRadius) {
-    glPushMatrix();
-
-    // Apply moon's orbital inclination (same as planet's for simplicity)
-    glRotatef(orbitalInclinations[planetIndex], 0.0f, 0.0f, 1.0f);
+// Sphere slices and stacks for a body
+int bodyDetail(int b) {
+    return bodies.kind[b] == BODY_STAR ? 50 : bodies.kind[b] == BODY_PLANET ? 20 : 10;
+}
 
-    // Rotate around the planet
-    glRotatef(moonOrbitAngles[planetIndex], 0.0f, 1.0f, 0.0f);
-    glTranslatef(moons[planetIndex].orbitDistance, 0.0f, 0.0f); // Distance from planet
+// Draw every textured body in view in its frame, as terrain where it has
+// one and as a sphere otherwise (or until its terrain has loaded)
+void drawBodies() {
+    for (size_t k = 0; k < sphereBodies.size(); ++k) {
+        if (!sphereVisible[k]) continue;
+        int b = sphereBodies[k];
+        int detail = bodyDetail(b);
+        GLuint texture = residentTexture(sphereTextures[k]);
+
+        glPushMatrix();
+        glMultMatrixf(bodies.frame(b));
+        if (!sphereTerrains[k] || !drawTerrain(sphereTerrains[k], texture, bodies.radius[b])) {
+            drawTexturedSphere(texture, bodies.radius[b], detail, detail);
+        }
+        glPopMatrix();
+    }
+}
 
-    // Rotate the moon around its own axis
-    glRotatef(moonRotationAngles[planetIndex], 0.0f, 1.0f, 0.0f);
+// Distance from the followed body's center to its highest ground: the
+// sphere, or the tallest peak of its terrain
+float followedSurfaceRadius() {
+    float r = bodies.radius[followBody];
+    for (size_t k = 0; k < sphereTerrains.size(); ++k) {
+        if (sphereBodies[k] == followBody && sphereTerrains[k]) return r * (1.0f + terrainMaxHeight(sphereTerrains[k]));
+    }
+    return r;
+}
 
-    // Draw the moon (smaller than the planet)
-    drawTexturedSphere(moonTexture, 0.1f * planetRadius, 10, 10);
+// Draw the untextured bodies (asteroids) as points
+void drawPointBodies() {
+    if (pointBodies.empty()) return;
+
+    glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT | GL_POINT_BIT);
+    glDisable(GL_LIGHTING);
+    glPointSize(1.5f);
+    glColor3f(0.7f, 0.65f, 0.6f);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, pointVertices.data());
+    glDrawArrays(GL_POINTS, 0, (GLsizei)pointBodies.size());
+    perfCount(PERF_DRAW_CALLS);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glPopAttrib();
+}
 
-    glPopMatrix();
+// Draw the spheres and points with the CPU rasterizer and copy the image
+// into the window. Background, orbits, rings and trails are GL-only.
+void drawSoftwareScene() {
+    GLfloat projection[16];
+    glGetFloatv(GL_PROJECTION_MATRIX, projection);
+    softBeginFrame(windowWidth, windowHeight, cameraMatrix, projection);
+    softSetLight((float)-bodies.origin[0], (float)-bodies.origin[1], (float)-bodies.origin[2]); // The Sun
+    for (size_t k = 0; k < sphereBodies.size(); ++k) {
+        int b = sphereBodies[k];
+        softDrawSphere(bodies.frame(b), bodies.radius[b], bodyDetail(b), sphereSoftTextures[k], bodies.kind[b] == BODY_STAR);
+    }
+    softDrawPoints(pointVertices.data(), (int)pointBodies.size(), 179, 166, 153);
+    softEndFrame();
+
+    glPushAttrib(GL_ENABLE_BIT | GL_PIXEL_MODE_BIT);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_DEPTH_TEST);
+    glWindowPos2i(0, 0);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, softStride());
+    glDrawPixels(windowWidth, windowHeight, GL_RGBA, GL_UNSIGNED_BYTE, softColorBuffer());
+    perfCount(PERF_DRAW_CALLS);
+    perfCount(PERF_TRIANGLES, softTriangleCount());
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPopAttrib();
 }
 
-// Function to draw the Sun
-void drawSun() {
+// Function to draw Saturn's rings (after the opaque bodies, since they are translucent)
+void drawSaturnRings() {
+    if (ringBody < 0) return;
+    // Placed at the planet with a fixed tilt: its frame carries the spin,
+    // which would turn the tilt axis with it
     glPushMatrix();
-    glRotatef(angle * 0.5f, 0.0f, 1.0f, 0.0f); // Rotate the Sun slowly
-    drawTexturedSphere(textures[0], 1.0f, 50, 50); // Render the textured Sun
+    glTranslatef(bodies.relX[ringBody], bodies.relY[ringBody], bodies.relZ[ringBody]);
+    glRotatef(SATURN_RING_TILT, 0.0f, 0.0f, 1.0f);
+    drawRings(sunEyePos, saturnRingShadows);
     glPopMatrix();
 }
 
-// Function to draw Mercury
-void drawMercury() {
-    glPushMatrix();
-    glRotatef(angle * 4.7f, 0.0f, 1.0f, 0.0f); // Orbit speed
-    glTranslatef(3.0f, 0.0f, 0.0f);            // Distance from the Sun
-    glRotatef(angle * 4.7f, 0.0f, 1.0f, 0.0f); // Mercury's rotation
-    drawTexturedSphere(textures[1], 0.2f, 20, 20);
+// Find the sphere bodies in view, and how many pixels the width of their
+// textures spans on screen: a sphere's texture wraps its circumference
+void cullSphereBodies() {
+    const float tanHalfY = tanf(22.5f * 3.14159265f / 180.0f);
+    const float tanHalfX = tanHalfY * windowWidth / windowHeight;
+    const float focal = windowHeight / (2.0f * tanHalfY); // Pixels per unit at distance 1
+    const float cosX = 1.0f / sqrtf(1.0f + tanHalfX * tanHalfX), sinX = tanHalfX * cosX;
+    const float cosY = 1.0f / sqrtf(1.0f + tanHalfY * tanHalfY), sinY = tanHalfY * cosY;
+    culledSpheres = 0;
+    for (size_t k = 0; k < sphereBodies.size(); ++k) {
+        int b = sphereBodies[k];
+        float x = bodies.relX[b], y = bodies.relY[b], z = bodies.relZ[b], r = bodies.radius[b];
+        float ex = cameraMatrix[0] * x + cameraMatrix[4] * y + cameraMatrix[8] * z + cameraMatrix[12];
+        float ey = cameraMatrix[1] * x + cameraMatrix[5] * y + cameraMatrix[9] * z + cameraMatrix[13];
+        float depth = -(cameraMatrix[2] * x + cameraMatrix[6] * y + cameraMatrix[10] * z + cameraMatrix[14]);
+        sphereVisible[k] = depth > -r && // Not behind the camera or outside the view
+            fabsf(ex) * cosX - depth * sinX <= r && fabsf(ey) * cosY - depth * sinY <= r;
+        if (!sphereVisible[k]) {
+            ++culledSpheres;
+            continue;
+        }
+        // Terrain is looked at from close by, so its texture detail follows the altitude
+        float distance = sphereTerrains[k] ? fmaxf(depth - r, 0.01f * r) : fmaxf(depth, r);
+        float diameter = 2.0f * r * focal / distance;
+        sphereCoverage[k] = 3.14159265f * diameter;
+    }
+}
 
-    // Draw Mercury's Moon
-    drawMoon(0, 0.2f); // planetIndex = 0 for Mercury, planetRadius = 0.2f
+// Tell the residency manager which textures the last cull found on screen.
+// Runs every frame, so their levels stay wanted while the view is still.
+// The background's texture spans 360 degrees of view.
+void markVisibleTextures() {
+    for (size_t k = 0; k < sphereBodies.size(); ++k) {
+        if (sphereVisible[k]) markTextureVisible(sphereTextures[k], sphereCoverage[k]);
+    }
+    perfCount(PERF_CULLED_BODIES, culledSpheres);
+    if (!starCatalogLoaded) {
+        const float tanHalfX = tanf(22.5f * 3.14159265f / 180.0f) * windowWidth / windowHeight;
+        markTextureVisible(backgroundTexture, windowWidth * 3.14159265f / atanf(tanHalfX));
+    }
+}
 
-    glPopMatrix();
+// Draw the atmosphere shells over the bodies (GL only)
+void drawAtmospheres() {
+    for (size_t k = 0; k < atmosphereBodies.size(); ++k) {
+        int b = atmosphereBodies[k];
+        glPushMatrix();
+        glMultMatrixf(bodies.frame(b));
+        drawAtmosphere(atmosphereModels[k], bodies.radius[b], sunEyePos);
+        glPopMatrix();
+    }
 }
 
-// Function to draw Venus
-void drawVenus() {
-    glPushMatrix();
-    glRotatef(angle * 3.5f, 0.0f, 1.0f, 0.0f);
-    glTranslatef(5.0f, 0.0f, 0.0f);
-    glRotatef(angle * 3.5f, 0.0f, 1.0f, 0.0f);
-    drawTexturedSphere(textures[2], 0.3f, 20, 20);
+// Compute every body's position and frame, one hierarchy level at a time
+void updateBodyTable() {
+    for (int l = 0; l < bodies.levelCount; ++l) {
+        updateBodies(simulationTime, bodies.levelStart[l], bodies.levelStart[l + 1]);
+    }
+}
 
-    // Draw Venus's Moon
-    drawMoon(1, 0.3f); // planetIndex = 1 for Venus, planetRadius = 0.3f
+// Per-tick jobs. Bodies in one level only read their parents, so a level
+// splits freely; the BVH refit and trail writes read every body and run
+// once all levels are done.
+void updateBodiesJob(void* data, int begin, int end) {
+    int first = *(const int*)data; // First body of the level
+    updateBodies(simulationTime, first + begin, first + end);
+}
 
-    glPopMatrix();
+void refitBvhJob(void* data, int begin, int end) {
+    refitBvh(bodies);
 }
 
-// Function to draw Earth
-void drawEarth() {
-    glPushMatrix();
-    glRotatef(angle * 3.0f, 0.0f, 1.0f, 0.0f);
-    glTranslatef(7.0f, 0.0f, 0.0f);
-    glRotatef(angle * 3.0f, 0.0f, 1.0f, 0.0f);
-    drawTexturedSphere(textures[3], 0.3f, 20, 20);
+void writeTrailsJob(void* data, int begin, int end) {
+    for (int t = begin; t < end; ++t) {
+        int b = trailBodies[t];
+        trailX[t] = bodies.posX[b];
+        trailY[t] = bodies.posY[b];
+        trailZ[t] = bodies.posZ[b];
+    }
+    writeTrailSamples(trailX.data(), trailY.data(), trailZ.data(), begin, end);
+}
 
-    // Draw Earth's Moon
-    drawMoon(2, 0.3f); // planetIndex = 2 for Earth, planetRadius = 0.3f
+void writeTelemetryJob(void* data, int begin, int end) {
+    writeTelemetry(bodies, begin, end);
+}
 
-    glPopMatrix();
+// What a tick writes once its body positions are final
+struct TickOutputs {
+    bool trails;       // Trail samples can be written this tick
+    bool telemetry;    // A telemetry slot is open
+    JobCounter* done;
+};
+
+// Queued behind the body update: fans the tick's outputs out into jobs
+void publishTickJob(void* data, int begin, int end) {
+    TickOutputs* outputs = (TickOutputs*)data;
+    runJob(refitBvhJob, nullptr, 0, 0, outputs->done);
+    if (outputs->trails) {
+        parallelFor((int)trailBodies.size(), BODY_JOB_GRAIN, writeTrailsJob, nullptr, outputs->done);
+    }
+    if (outputs->telemetry) {
+        parallelFor(bodies.count(), BODY_JOB_GRAIN, writeTelemetryJob, nullptr, outputs->done);
+    }
 }
 
-// Function to draw Mars
-void drawMars() {
-    glPushMatrix();
-    glRotatef(angle * 2.5f, 0.0f, 1.0f, 0.0f);
-    glTranslatef(9.0f, 0.0f, 0.0f);
-    glRotatef(angle * 2.5f, 0.0f, 1.0f, 0.0f);
-    drawTexturedSphere(textures[4], 0.2f, 20, 20);
+// Per-frame jobs: convert every body to floats relative to the floating
+// origin, then pack the point bodies from the converted positions
+void rebaseBodiesJob(void* data, int begin, int end) {
+    rebaseBodies(begin, end);
+}
 
-    // Draw Mars's Moon
-    drawMoon(3, 0.2f); // planetIndex = 3 for Mars, planetRadius = 0.2f
+void packPointsJob(void* data, int begin, int end) {
+    for (int k = begin; k < end; ++k) {
+        int b = pointBodies[k];
+        pointVertices[3 * k] = bodies.relX[b];
+        pointVertices[3 * k + 1] = bodies.relY[b];
+        pointVertices[3 * k + 2] = bodies.relZ[b];
+    }
+}
 
-    glPopMatrix();
+// Move the floating origin to the point the camera orbits (the followed
+// body or the world origin) and rebase everything on it
+void rebaseOnCamera() {
+    if (followBody >= 0) setBodyOrigin(bodies.worldX[followBody], bodies.worldY[followBody], bodies.worldZ[followBody]);
+    else setBodyOrigin(0.0, 0.0, 0.0);
+
+    JobCounter rebased;
+    parallelFor(bodies.count(), BODY_JOB_GRAIN, rebaseBodiesJob, nullptr, &rebased);
+    waitForCounter(&rebased);
+    JobCounter packed;
+    parallelFor((int)pointBodies.size(), BODY_JOB_GRAIN, packPointsJob, nullptr, &packed);
+    waitForCounter(&packed);
 }
 
-// Function to draw Jupiter
-void drawJupiter() {
-    glPushMatrix();
-    glRotatef(angle * 1.3f, 0.0f, 1.0f, 0.0f);
-    glTranslatef(12.0f, 0.0f, 0.0f);
-    glRotatef(angle * 1.3f, 0.0f, 1.0f, 0.0f);
-    drawTexturedSphere(textures[5], 0.6f, 20, 20);
+// Display name of a body in the table
+void bodyName(int b, char* out, int size) {
+    const char* name = bodies.string(bodies.name[b]);
+    int p = bodies.parent[b];
+    if (name) snprintf(out, size, "%s", name);
+    else if (bodies.kind[b] == BODY_MOON && p >= 0 && bodies.string(bodies.name[p])) snprintf(out, size, "Moon of %s", bodies.string(bodies.name[p]));
+    else snprintf(out, size, "Body %d", b);
+}
 
-    // Draw Jupiter's Moon
-    drawMoon(4, 0.6f); // planetIndex = 4 for Jupiter, planetRadius = 0.6f
+// Select the body under the mouse (window coordinates) for the follow camera
+void pickAt(int x, int y) {
+    GLdouble modelview[16], projection[16];
+    GLint viewport[4];
+    for (int i = 0; i < 16; ++i) modelview[i] = cameraMatrix[i];
+    glGetDoublev(GL_PROJECTION_MATRIX, projection);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    // Ray through the pixel from the near plane to the far plane
+    GLdouble nx, ny, nz, fx, fy, fz;
+    double wy = viewport[3] - y;
+    if (!gluUnProject(x, wy, 0.0, modelview, projection, viewport, &nx, &ny, &nz)) return;
+    if (!gluUnProject(x, wy, 1.0, modelview, projection, viewport, &fx, &fy, &fz)) return;
+    // The camera matrix is relative to the floating origin; the BVH is in world space
+    float origin[3] = { (float)(nx + bodies.origin[0]), (float)(ny + bodies.origin[1]), (float)(nz + bodies.origin[2]) };
+    float dir[3] = { (float)(fx - nx), (float)(fy - ny), (float)(fz - nz) };
+
+    float t;
+    followBody = pickBody(bodies, origin, dir, &t); // Empty space clears the selection
+}
 
-    glPopMatrix();
+// Queue the performance overlay in the bottom-right corner: the last
+// frame's counters over a graph of the last PERF_HISTORY_FRAMES frame
+// times, scaled to the worst of them (at least two refresh periods)
+void queuePerfOverlay() {
+    const float graphHeight = 60.0f;
+    float x = windowWidth - 330.0f, y = windowHeight - 140.0f;
+    hudRect(x - 6.0f, y - 6.0f, 330.0f, 140.0f, 0.0f, 0.0f, 0.0f, 0.55f);
+
+    PerfFrame frame = perfLastFrame();
+    FrameArenaStats arena = frameArenaStats();
+    hudPrintf(x, y, 1.0f, 0.8f, 0.8f, 0.8f, "Frame %.2f ms (worst %.2f), %.1f FPS", frame.frameMs, perfWorstFrameTime(), currentFps);
+    hudPrintf(x, y + 12.0f, 1.0f, 0.8f, 0.8f, 0.8f, "Draws %d, triangles %d, binds %d",
+        frame.counters[PERF_DRAW_CALLS], frame.counters[PERF_TRIANGLES], frame.counters[PERF_TEXTURE_BINDS]);
+    hudPrintf(x, y + 24.0f, 1.0f, 0.8f, 0.8f, 0.8f, "Culled bodies %d, simulation tick %.2f ms",
+        frame.counters[PERF_CULLED_BODIES], frame.tickMs);
+    hudPrintf(x, y + 36.0f, 1.0f, 0.8f, 0.8f, 0.8f, "Heap %d allocs/frame, arena %.0f KB, textures %.0f MB",
+        lastFrameAllocations, arena.usedBytes / 1024.0, residencyStats().residentBytes / 1048576.0);
+
+    float period = 1000.0f / (float)pacerRefreshRate();
+    float scale = fmaxf(perfWorstFrameTime(), 2.0f * period);
+    float bottom = y + 58.0f + graphHeight;
+    for (int age = 0; age < PERF_HISTORY_FRAMES; ++age) {
+        float ms = perfFrameTime(age);
+        float h = graphHeight * fminf(ms / scale, 1.0f);
+        bool late = ms > period * 1.05f, veryLate = ms > period * 2.0f;
+        hudRect(x + PERF_HISTORY_FRAMES - 1 - age, bottom - h, 1.0f, h,
+            veryLate ? 0.9f : late ? 0.9f : 0.3f, veryLate ? 0.2f : late ? 0.8f : 0.8f, 0.2f, 0.9f);
+    }
+    hudRect(x, bottom - graphHeight * period / scale, (float)PERF_HISTORY_FRAMES, 1.0f, 0.8f, 0.8f, 0.8f, 0.6f); // Refresh period
+    hudPrintf(x + PERF_HISTORY_FRAMES + 4.0f, bottom - graphHeight - 4.0f, 1.0f, 0.6f, 0.6f, 0.6f, "%.0f ms", scale);
+    hudPrintf(x + PERF_HISTORY_FRAMES + 4.0f, bottom - graphHeight * period / scale - 4.0f, 1.0f, 0.6f, 0.6f, 0.6f, "%.1f", period);
 }
 
-// Function to draw Saturn
-void drawSaturn() {
-    glPushMatrix();
-    glRotatef(angle * 1.0f, 0.0f, 1.0f, 0.0f);
-    glTranslatef(15.0f, 0.0f, 0.0f);
-    glRotatef(angle * 1.0f, 0.0f, 1.0f, 0.0f);
-    drawTexturedSphere(textures[6], 0.5f, 20, 20);
+// Function to draw the HUD: planet labels and the frame rate, batched into one draw
+// together with the performance overlay
+void drawHud() {
+    hudBegin(windowWidth, windowHeight);
+    if (!showHud) {
+        queuePerfOverlay();
+        hudFlush();
+        return;
+    }
 
-    // Draw Saturn's Moon
-    drawMoon(5, 0.5f); // planetIndex = 5 for Saturn, planetRadius = 0.5f
+    GLdouble modelview[16], projection[16];
+    GLint viewport[4];
+    for (int i = 0; i < 16; ++i) modelview[i] = cameraMatrix[i];
+    glGetDoublev(GL_PROJECTION_MATRIX, projection);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    for (int b : labelBodies) {
+        float x = bodies.relX[b], y = bodies.relY[b], z = bodies.relZ[b];
+        float eyeZ = cameraMatrix[2] * x + cameraMatrix[6] * y + cameraMatrix[10] * z + cameraMatrix[14];
+        if (eyeZ >= 0.0f) continue; // Behind the camera
+        GLdouble sx, sy, sz;
+        if (!gluProject(x, y, z, modelview, projection, viewport, &sx, &sy, &sz)) continue;
+        if (sz < 0.0 || sz > 1.0) continue; // Clipped
+        char name[64];
+        bodyName(b, name, sizeof(name));
+        hudText((float)sx + 6.0f, (float)(windowHeight - sy) - 4.0f, 1.0f, 0.8f, 0.8f, 0.6f, name);
+    }
 
-    glPopMatrix();
+    hudPrintf(10.0f, 10.0f, 2.0f, 0.7f, 0.7f, 0.11f, "FPS: %.1f", currentFps);
+
+    // Job worker utilization since the last frame
+    float busy = 0.0f;
+    int workers = jobWorkerCount();
+    for (int w = 0; w < workers; ++w) busy += jobWorkerUtilization(w);
+    hudPrintf(10.0f, 50.0f, 1.0f, 0.6f, 0.6f, 0.6f, "Jobs: %d workers, %.1f%% busy", workers, 100.0f * busy / workers);
+    hudPrintf(10.0f, 62.0f, 1.0f, 0.6f, 0.6f, 0.6f, "Frame: %.2f ms (target %.0f Hz)", pacerFrameTimeMs(), pacerRefreshRate());
+    hudPrintf(10.0f, 74.0f, 1.0f, 0.6f, 0.6f, 0.6f, "Input latency: %.1f ms (avg %.1f ms)", lastInputLatencyMs(), averageInputLatencyMs());
+    CheckpointStats checkpoints = checkpointStats();
+    if (checkpoints.written > 0) {
+        hudPrintf(10.0f, 86.0f, 1.0f, 0.6f, 0.6f, 0.6f, "Checkpoints: %d (%d skipped), %.1f MB/s, %.2f bytes/body",
+            checkpoints.written, checkpoints.skipped, checkpoints.megabytesPerSecond, checkpoints.bytesPerBody);
+    }
+    if (softwareRendering) {
+        hudPrintf(10.0f, 98.0f, 1.0f, 0.6f, 0.6f, 0.6f, "Software: %d triangles, %dx%d", softTriangleCount(), windowWidth, windowHeight);
+    }
+    else {
+        ResidencyStats textures = residencyStats();
+        hudPrintf(10.0f, 98.0f, 1.0f, 0.6f, 0.6f, 0.6f, "Textures: %.1f/%.0f MB, %d loading, %.1f MB/s upload",
+            textures.residentBytes / 1048576.0, textures.budgetBytes / 1048576.0, textures.streaming, textures.uploadMegabytesPerSecond);
+        for (size_t k = 0; k < sphereTerrains.size(); ++k) {
+            if (sphereBodies[k] != followBody || !sphereTerrains[k]) continue;
+            TerrainStats terrain = terrainStats(sphereTerrains[k]);
+            hudPrintf(10.0f, 122.0f, 1.0f, 0.6f, 0.6f, 0.6f, "Terrain: %d chunks, %d triangles, level %d, %d cached, %d loading",
+                terrain.chunks, terrain.triangles, terrain.deepestLevel, terrain.cached, terrain.loading);
+        }
+    }
+    FrameArenaStats arena = frameArenaStats();
+    hudPrintf(10.0f, 110.0f, 1.0f, 0.6f, 0.6f, 0.6f, "Memory: %d heap allocations last frame, arena %.0f/%.0f KB",
+        lastFrameAllocations, arena.usedBytes / 1024.0, arena.capacityBytes / 1024.0);
+    if (!softwareRendering && showComets) {
+        hudPrintf(10.0f, 134.0f, 1.0f, 0.6f, 0.6f, 0.6f, "Comets: %d particles", cometParticleCount());
+    }
+    CollisionStats collisions = collisionStats();
+    CollisionEvent lastEvent;
+    if (collisionDetection) {
+        hudPrintf(10.0f, 146.0f, 1.0f, 0.6f, 0.6f, 0.6f, "Collisions: %llu approaches, %llu contacts, %d pairs tested in %.2f ms",
+            (unsigned long long)collisions.approaches, (unsigned long long)collisions.contacts, collisions.candidatePairs, collisions.milliseconds);
+    }
+    if (collisionDetection && collisionEvent(collisionEventCount() - 1, lastEvent)) {
+        char a[64], b[64];
+        bodyName(lastEvent.a, a, sizeof(a));
+        bodyName(lastEvent.b, b, sizeof(b));
+        hudPrintf(10.0f, 158.0f, 1.0f, 0.6f, 0.6f, 0.6f, "Last: %s %s %s at t=%.1f s", a,
+            lastEvent.type == COLLISION_CONTACT ? "hit" : "passed", b, lastEvent.time);
+    }
+    if (starCatalogLoaded) {
+        hudPrintf(10.0f, windowHeight - 20.0f, 1.0f, 0.6f, 0.6f, 0.6f, "Stars: %d (magnitude < %.1f)",
+            starCountForMagnitude(starLimitingMagnitude), starLimitingMagnitude);
+    }
+    if (simulationPaused) {
+        hudText(windowWidth - 80.0f, 10.0f, 2.0f, 0.7f, 0.7f, 0.11f, "PAUSED");
+    }
+    if (capturing()) {
+        hudPrintf(windowWidth - 230.0f, 30.0f, 1.0f, 0.9f, 0.2f, 0.2f, "REC %d frames (%d dropped)", capturedFrames(), droppedFrames());
+    }
+    if (followBody >= 0) {
+        char name[64];
+        bodyName(followBody, name, sizeof(name));
+        hudPrintf(10.0f, 30.0f, 2.0f, 0.7f, 0.7f, 0.11f, "Following: %s", name);
+    }
+    if (showPerfOverlay) {
+        queuePerfOverlay();
+    }
+
+    hudFlush();
 }
 
-// Function to draw Uranus
-void drawUranus() {
-    glPushMatrix();
-    glRotatef(angle * 0.7f, 0.0f, 1.0f, 0.0f);
-    glTranslatef(18.0f, 0.0f, 0.0f);
-    glRotatef(angle * 0.7f, 0.0f, 1.0f, 0.0f);
-    drawTexturedSphere(textures[7], 0.4f, 20, 20);
+// Draw the scene with OpenGL
+void drawGLScene() {
+    // Draw the Milky Way background
+    glPushAttrib(GL_ENABLE_BIT | GL_LIGHTING_BIT | GL_DEPTH_BUFFER_BIT);
+    glDisable(GL_LIGHTING);    // Disable lighting for background
+    glDisable(GL_DEPTH_TEST);  // Disable depth testing to ensure background is drawn behind everything
 
-    // Draw Uranus's Moon
-    drawMoon(6, 0.4f); // planetIndex = 6 for Uranus, planetRadius = 0.4f
+    if (starCatalogLoaded) {
+        // Stars are at infinity: keep only the camera rotation
+        glPushMatrix();
+        GLfloat rotationOnly[16];
+        for (int i = 0; i < 16; ++i) rotationOnly[i] = cameraMatrix[i];
+        rotationOnly[12] = rotationOnly[13] = rotationOnly[14] = 0.0f;
+        glLoadMatrixf(rotationOnly);
+        drawStars(starLimitingMagnitude);
+        glPopMatrix();
+    }
+    else {
+        drawBackground();
+    }
 
-    glPopMatrix();
-}
+    glEnable(GL_LIGHTING);     // Re-enable lighting
+    glEnable(GL_DEPTH_TEST);   // Re-enable depth testing
+    glPopAttrib();
 
-// Function to draw Neptune
-void drawNeptune() {
+    // Orbit paths and trails are stored in world coordinates
     glPushMatrix();
-    glRotatef(angle * 0.5f, 0.0f, 1.0f, 0.0f);
-    glTranslatef(21.0f, 0.0f, 0.0f);
-    glRotatef(angle * 0.5f, 0.0f, 1.0f, 0.0f);
-    drawTexturedSphere(textures[8], 0.4f, 20, 20);
-
-    // Draw Neptune's Moon
-    drawMoon(7, 0.4f); // planetIndex = 7 for Neptune, planetRadius = 0.4f
+    glTranslated(-bodies.origin[0], -bodies.origin[1], -bodies.origin[2]);
 
+    // Draw the planets' orbit paths (re-tessellated only when the view moves)
+    if (showOrbits) {
+        if (orbitViewStale) updateOrbitTessellation();
+        orbitViewStale = false;
+        drawOrbits();
+    }
+    if (showTrails) {
+        drawTrails();
+    }
     glPopMatrix();
+
+    // Draw the Sun and planets with moons
+    drawBodies();
+    drawPointBodies();
+    drawAtmospheres();
+    drawSaturnRings();
+
+    // Comet tails blend over the bodies but are hidden behind them
+    if (showComets) {
+        glPushMatrix();
+        glTranslated(-bodies.origin[0], -bodies.origin[1], -bodies.origin[2]);
+        drawComets();
+        glPopMatrix();
+    }
 }
 
-// Function to draw Pluto
-void drawPluto() {
-    glPushMatrix();
-    glRotatef(angle * 0.2f, 0.0f, 1.0f, 0.0f);
-    glTranslatef(24.0f, 0.0f, 0.0f);
-    glRotatef(angle * 0.2f, 0.0f, 1.0f, 0.0f);
-    drawTexturedSphere(textures[9], 0.1f, 20, 20);
+// Record what changed and ask GLUT for a redraw
+void markDirty(unsigned int flags) {
+    if (dirtyFlags == 0) redrawRequestTime = pacerNow();
+    dirtyFlags |= flags;
+    glutPostRedisplay();
+}
 
-    // Draw Pluto's Moon
-    drawMoon(8, 0.1f); // planetIndex = 8 for Pluto, planetRadius = 0.1f
+// Redraw so updateResidency() and drawTerrain() can upload what the loaders finished
+void pollResidency(int value) {
+    residencyPollArmed = false;
+    markDirty(DIRTY_TEXTURES);
+}
 
-    glPopMatrix();
+// Projection for a w x h window: an infinite reverse-Z frustum when
+// reverseDepth is on, the original 1 to 100 range otherwise
+void setProjection(int w, int h) {
+    double aspect = (double)w / (double)h;
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    if (reverseDepth) {
+        // Clip z is the near distance and w the eye distance, so depth = near / distance
+        double f = 1.0 / tan(45.0 * 3.14159265358979 / 360.0);
+        GLdouble m[16] = {
+            f / aspect, 0.0, 0.0, 0.0,
+            0.0, f, 0.0, 0.0,
+            0.0, 0.0, 0.0, -1.0,
+            0.0, 0.0, nearPlane, 0.0
+        };
+        glLoadMatrixd(m);
+    }
+    else {
+        gluPerspective(45.0, aspect, 1.0, 100.0);
+    }
+    glMatrixMode(GL_MODELVIEW);
+}
+
+// Keep the reverse-Z near plane in front of the followed body's surface
+void updateNearPlane() {
+    if (!reverseDepth) return;
+    double wanted = REVERSE_Z_NEAR;
+    if (followBody >= 0) {
+        wanted = std::min(std::max(0.5 * (-zoomLevel - followedSurfaceRadius()), REVERSE_Z_MIN_NEAR), REVERSE_Z_NEAR);
+    }
+    if (wanted != nearPlane) {
+        nearPlane = wanted;
+        setProjection(windowWidth, windowHeight);
+    }
 }
 
 // Display function
 void display() {
+    // The frame time graphed by the overlay runs from the previous swap, so
+    // the tick, pacing and swap stalls all show. After a paused stretch it
+    // runs from the redraw request instead, as nothing was due in between.
+    double frameStart = pacerNow();
+    if (lastSwapTime > 0.0) {
+        if (!idleSinceSwap) frameStart = lastSwapTime;
+        else if (dirtyFlags) frameStart = redrawRequestTime;
+    }
+    if (reverseDepth) glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glLoadIdentity();
 
+    // Redraws for streamed textures or display toggles reuse the last
+    // frame's origin, culling and orbit tessellation
+    bool viewChanged = (dirtyFlags & DIRTY_VIEW) != 0;
+    if (viewChanged) orbitViewStale = true;
+
+    // Everything is drawn relative to the point the camera orbits
+    if (viewChanged) rebaseOnCamera();
+
     // Apply camera transformations
     glTranslatef(0.0f, 0.0f, zoomLevel);        // Apply zoom level
     glRotatef(cameraAngleY, 1.0f, 0.0f, 0.0f);  // Rotate around X-axis
     glRotatef(cameraAngleX, 0.0f, 1.0f, 0.0f);  // Rotate around Y-axis
+    glGetFloatv(GL_MODELVIEW_MATRIX, cameraMatrix);
 
-    // Draw the Milky Way background
-    glPushAttrib(GL_ENABLE_BIT | GL_LIGHTING_BIT | GL_DEPTH_BUFFER_BIT);
-    glDisable(GL_LIGHTING);    // Disable lighting for background
-    glDisable(GL_DEPTH_TEST);  // Disable depth testing to ensure background is drawn behind everything
+    // The Sun sits at the world origin and lights the scene from there
+    GLfloat sunPos[4] = { (float)-bodies.origin[0], (float)-bodies.origin[1], (float)-bodies.origin[2], 1.0f };
+    glLightfv(GL_LIGHT0, GL_POSITION, sunPos);
+    for (int r = 0; r < 3; ++r) {
+        sunEyePos[r] = cameraMatrix[r] * sunPos[0] + cameraMatrix[4 + r] * sunPos[1] + cameraMatrix[8 + r] * sunPos[2] + cameraMatrix[12 + r];
+    }
 
-    drawBackground();
+    if (softwareRendering) {
+        drawSoftwareScene();
+    }
+    else {
+        // Cull the spheres and stream texture levels for what is on
+        // screen; keep redrawing until the loads in flight have arrived
+        if (viewChanged) cullSphereBodies();
+        markVisibleTextures();
+        updateResidency();
+        updateNearPlane();
+        if ((residencyBusy() || terrainBusy()) && !residencyPollArmed) {
+            residencyPollArmed = true;
+            glutTimerFunc(16, pollResidency, 0);
+        }
+        drawGLScene();
+    }
 
-    glEnable(GL_LIGHTING);     // Re-enable lighting
-    glEnable(GL_DEPTH_TEST);   // Re-enable depth testing
-    glPopAttrib();
+    // Frame rate, averaged over about half a second
+    ++fpsFrames;
+    int now = glutGet(GLUT_ELAPSED_TIME);
+    if (now - fpsStartTime >= 500) {
+        currentFps = fpsFrames * 1000.0f / (now - fpsStartTime);
+        fpsFrames = 0;
+        fpsStartTime = now;
+    }
 
-    // Draw the Sun and planets with moons
-    drawSun();
-    drawMercury();
-    drawVenus();
-    drawEarth();
-    drawMars();
-    drawJupiter();
-    drawSaturn();
-    drawUranus();
-    drawNeptune();
-    drawPluto();
+    // Copy the offscreen scene into the window
+    if (reverseDepth) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFramebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, windowWidth, windowHeight, 0, 0, windowWidth, windowHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // Record the scene without the HUD
+    captureFrame();
+
+    if (showHud || showPerfOverlay) {
+        drawHud();
+    }
+    resetJobStats();
 
     glutSwapBuffers();
+    dirtyFlags = 0;
+    lastSwapTime = pacerNow();
+    idleSinceSwap = simulationPaused;
+
+    // The frame's scratch memory goes back to the arena, and everything
+    // since the last swap counts toward this frame's heap allocations
+    resetFrameArena();
+    uint64_t allocations = allocationTotals().allocations;
+    lastFrameAllocations = (int)(allocations - frameAllocationsStart);
+    frameAllocationsStart = allocations;
+    perfEndFrame((float)((lastSwapTime - frameStart) * 1000.0));
+
+    // Measuring input latency needs the swap to complete, so only wait for it
+    // on frames that show a pending input
+    if (inputPending()) {
+        glFinish();
+        markFramePresented();
+    }
+}
+
+// Advance the simulation clock by one fixed step; positions follow from it
+void stepSimulation() {
+    simulationTime += SIMULATION_STEP;
 }
 
-// Update function for animation
+// Update function for animation, paced by the frame pacer
 void update(int value) {
-    angle += 0.5f;  // Increment rotation angle for planets
-    if (angle >= 360.0f) angle -= 360.0f;
+    if (value != updateGeneration || simulationPaused) return; // Stop until resumed
+
+    // Run as many fixed steps as real time has passed
+    double now = pacerNow();
+    simulationAccumulator += now - lastSimulationTime;
+    lastSimulationTime = now;
+    int steps = 0;
+    while (simulationAccumulator >= SIMULATION_STEP && steps < MAX_SIMULATION_STEPS) {
+        stepSimulation();
+        simulationAccumulator -= SIMULATION_STEP;
+        ++steps;
+    }
+    if (simulationAccumulator >= SIMULATION_STEP) simulationAccumulator = 0.0; // Drop time after a stall
+
+    if (steps > 0) {
+        // Refresh body positions level by level, each level after its
+        // parents. The last level is not waited for here.
+        JobCounter bodiesUpdated;
+        for (int l = 0; l < bodies.levelCount; ++l) {
+            if (l > 0) waitForCounter(&bodiesUpdated);
+            parallelFor(bodies.levelStart[l + 1] - bodies.levelStart[l], BODY_JOB_GRAIN, updateBodiesJob,
+                &bodies.levelStart[l], &bodiesUpdated);
+        }
+
+        // Once it is done, refit the BVH, append to the trails and publish
+        // the telemetry. The trail fence wait is a GL call, so it stays on
+        // this thread.
+        JobCounter tickDone;
+        TickOutputs outputs;
+        outputs.trails = beginTrailTick();
+        outputs.telemetry = beginTelemetryTick(simulationTime);
+        outputs.done = &tickDone;
+        runJobAfter(&bodiesUpdated, publishTickJob, &outputs, 0, 0, &tickDone);
+
+        // Comets do not depend on the bodies, so they overlap the last level
+        updateComets(simulationTime, (float)(steps * SIMULATION_STEP));
+        waitForCounter(&bodiesUpdated);
+        if (collisionDetection) detectCollisions(bodies, simulationTime);
+        waitForCounter(&tickDone);
+        if (outputs.trails) endTrailTick();
+        if (outputs.telemetry) endTelemetryTick();
+
+        // The writer thread compresses and saves; this only copies the positions
+        if (checkpointInterval > 0.0 && simulationTime >= nextCheckpointTime) {
+            requestCheckpoint(checkpointPath, simulationTime, bodies);
+            nextCheckpointTime = simulationTime + checkpointInterval;
+        }
 
-    // Update moons' orbital and rotation angles
-    for (int i = 0; i < NUM_PLANETS; ++i) {
-        moonOrbitAngles[i] += moons[i].orbitSpeed;
-        if (moonOrbitAngles[i] >= 360.0f) moonOrbitAngles[i] -= 360.0f;
+        perfRecordTick((float)((pacerNow() - now) * 1000.0));
+        markDirty(DIRTY_SIMULATION); // Request to redraw the scene
+    }
+
+    glutTimerFunc(pacerNextDelayMs(), update, value); // Wait for the next frame deadline
+}
 
-        moonRotationAngles[i] += moons[i].rotationSpeed;
-        if (moonRotationAngles[i] >= 360.0f) moonRotationAngles[i] -= 360.0f;
+// Pause or resume the simulation. While paused no timer is armed, so the
+// program only wakes up for input and window events.
+void setPaused(bool paused) {
+    simulationPaused = paused;
+    ++updateGeneration;
+    if (!paused) {
+        initFramePacer(pacerRefreshRate());
+        lastSimulationTime = pacerNow();
+        simulationAccumulator = 0.0;
+        glutTimerFunc(0, update, updateGeneration);
     }
+    markDirty(DIRTY_OPTIONS);
+}
 
-    glutPostRedisplay(); // Request to redraw the scene
-    glutTimerFunc(16, update, 0);  // Redraw every 16ms (~60 FPS)
+// Switch between reverse-Z and the conventional depth convention
+void setDepthConvention(bool reverse) {
+    reverseDepth = reverse;
+    glClipControl(GL_LOWER_LEFT, reverse ? GL_ZERO_TO_ONE : GL_NEGATIVE_ONE_TO_ONE);
+    glDepthFunc(reverse ? GL_GREATER : GL_LESS);
+    glClearDepth(reverse ? 0.0 : 1.0);
+}
+
+// (Re)allocate the offscreen color and float depth buffers; falls back to
+// conventional depth if the framebuffer is not supported
+void resizeSceneFramebuffer(int w, int h) {
+    if (!sceneFramebuffer) {
+        glGenFramebuffers(1, &sceneFramebuffer);
+        glGenRenderbuffers(1, &sceneColorBuffer);
+        glGenRenderbuffers(1, &sceneDepthBuffer);
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, sceneColorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+    glBindRenderbuffer(GL_RENDERBUFFER, sceneDepthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, w, h);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, sceneColorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, sceneDepthBuffer);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete) {
+        std::cerr << "Float depth framebuffer unsupported, using conventional depth" << std::endl;
+        setDepthConvention(false);
+    }
 }
 
 // Reshape function to handle window resizing
 void reshape(int w, int h) {
     if (h == 0) h = 1; // Prevent division by zero
+    windowWidth = w;
+    windowHeight = h;
     glViewport(0, 0, w, h);
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(45.0, (double)w / (double)h, 1.0, 100.0);
-    glMatrixMode(GL_MODELVIEW);
+    if (reverseDepth) resizeSceneFramebuffer(w, h);
+    setProjection(w, h);
+    markDirty(DIRTY_WINDOW);
+
+    // Video frames have a fixed size
+    if (capturing()) {
+        std::cerr << "Window resized, recording stopped" << std::endl;
+        stopCapture();
+    }
+    if (captureOnStart) {
+        captureOnStart = false;
+        startCapture(capturePath, w, h, pacerRefreshRate());
+    }
 }
 
 // Mouse Button and wheel handler with zoom limits
 void mouseHandler(int button, int state, int x, int y) {
-    if (button == 3 && state == GLUT_DOWN) { // Mouse wheel up
+    float oldZoom = zoomLevel;
+    int oldFollow = followBody;
+    bool nearFollowed = followBody >= 0 && zoomLevel >= -5.0f && followedSurfaceRadius() < 5.0f;
+    if (button == 3 && state == GLUT_DOWN && nearFollowed) {
+        // Close to a followed body each step takes 30% off the altitude,
+        // so the camera can come down to the ground
+        float surface = followedSurfaceRadius();
+        float altitude = std::max((-zoomLevel - surface) * 0.7f, FOLLOW_MIN_ALTITUDE * bodies.radius[followBody]);
+        zoomLevel = -(surface + altitude);
+    }
+    else if (button == 4 && state == GLUT_DOWN && nearFollowed && zoomLevel > -5.0f) {
+        float surface = followedSurfaceRadius();
+        zoomLevel = std::max(-(surface + (-zoomLevel - surface) / 0.7f), -5.0f);
+    }
+    else if (button == 3 && state == GLUT_DOWN) { // Mouse wheel up
         zoomLevel += 1.0f; // Zoom in
         if (zoomLevel > -5.0f) zoomLevel = -5.0f; // Limit zoom in
     }
@@ -375,12 +982,19 @@ void mouseHandler(int button, int state, int x, int y) {
             isDragging = true;
             lastMouseX = x; // Record initial mouse position
             lastMouseY = y;
+            pressMouseX = x;
+            pressMouseY = y;
         }
         else if (state == GLUT_UP) {
             isDragging = false; // Stop dragging
+            if (fabsf(x - pressMouseX) < 4.0f && fabsf(y - pressMouseY) < 4.0f) {
+                pickAt(x, y); // A click rather than a drag
+            }
         }
     }
-    glutPostRedisplay();
+    if (zoomLevel != oldZoom || followBody != oldFollow) {
+        markDirty(DIRTY_CAMERA);
+    }
 }
 
 // Mouse Drag Function
@@ -395,17 +1009,20 @@ void mouseDrag(int x, int y) {
         lastMouseX = x; // Update last mouse position
         lastMouseY = y;
 
-        glutPostRedisplay(); // Request redraw
+        markInput();
+        markDirty(DIRTY_CAMERA); // Request redraw
     }
 }
 
 // Keyboard Handler for additional controls
 void keyboardHandler(unsigned char key, int x, int y) {
+    unsigned int changed = DIRTY_CAMERA;
     switch (key) {
     case 'r': // Reset camera
         cameraAngleX = 0.0f;
         cameraAngleY = 0.0f;
         zoomLevel = -30.0f;
+        followBody = -1;
         break;
     case 'w': // Pan up
         cameraAngleY += 5.0f;
@@ -419,10 +1036,221 @@ void keyboardHandler(unsigned char key, int x, int y) {
     case 'd': // Pan right
         cameraAngleX += 5.0f;
         break;
-    default:
+    case 't': // Toggle orbit trails
+        showTrails = !showTrails;
+        changed = DIRTY_OPTIONS;
+        break;
+    case 'o': // Toggle orbit paths
+        showOrbits = !showOrbits;
+        changed = DIRTY_OPTIONS;
+        break;
+    case 'c': // Toggle comets
+        showComets = !showComets;
+        changed = DIRTY_OPTIONS;
+        break;
+    case 'x': // Toggle collision detection; positions from before it was off are stale
+        collisionDetection = !collisionDetection;
+        resetCollisions();
+        changed = DIRTY_OPTIONS;
+        break;
+    case 'h': // Toggle HUD
+        showHud = !showHud;
+        changed = DIRTY_OPTIONS;
+        break;
+    case 'f': // Toggle the performance overlay
+        showPerfOverlay = !showPerfOverlay;
+        changed = DIRTY_OPTIONS;
         break;
+    case '[': // Fewer stars
+        starLimitingMagnitude = fmaxf(starLimitingMagnitude - 0.5f, 0.0f);
+        changed = DIRTY_OPTIONS;
+        break;
+    case ']': // More stars
+        starLimitingMagnitude = fminf(starLimitingMagnitude + 0.5f, 14.0f);
+        changed = DIRTY_OPTIONS;
+        break;
+    case 'k': // Checkpoint now
+        requestCheckpoint(checkpointPath, simulationTime, bodies);
+        return;
+    case 'v': // Start or stop recording video
+        if (capturing()) stopCapture();
+        else startCapture(capturePath, windowWidth, windowHeight, pacerRefreshRate());
+        changed = DIRTY_OPTIONS;
+        break;
+    case 'p': // Pause or resume the simulation
+        setPaused(!simulationPaused);
+        return;
+    default:
+        return; // Nothing changed
     }
-    glutPostRedisplay();
+    markDirty(changed);
+}
+
+// Restore the simulation clock from a checkpoint. Positions are a function
+// of the clock, so recomputing them must reproduce the saved ones exactly.
+bool resumeFromCheckpoint(const char* path) {
+    std::vector<float> x, y, z;
+    if (!readCheckpoint(path, bodies.count(), simulationTime, x, y, z)) return false;
+    resetCollisions();
+
+    updateBodyTable();
+    bool exact = x == bodies.posX && y == bodies.posY && z == bodies.posZ;
+    if (!exact) {
+        std::cerr << "Warning: positions recomputed from " << path << " differ from the saved ones" << std::endl;
+    }
+    return true;
+}
+
+// CPU copy of a scene texture, loaded once
+const SoftTexture* loadSoftTexture(int32_t path) {
+    if (!softTextures.count(path)) {
+        SoftTexture& texture = softTextures[path];
+        if (!loadBMP(bodies.string(path), texture.width, texture.height, texture.rgb)) {
+            std::cerr << "Failed to load texture: " << bodies.string(path) << std::endl;
+        }
+    }
+    return &softTextures[path];
+}
+
+// Body with the given name, or -1
+int findBody(const char* name) {
+    for (int b = 0; b < bodies.count(); ++b) {
+        const char* bodyName = bodies.string(bodies.name[b]);
+        if (bodyName && strcmp(bodyName, name) == 0) return b;
+    }
+    return -1;
+}
+
+// Ray trace one still of the current camera and simulation time (--raytrace)
+bool renderRayTraced(const char* path, const RayTraceSettings& settings) {
+    updateBodyTable();
+    buildBvh(bodies);
+
+    std::vector<const SoftTexture*> textures(bodies.count(), nullptr);
+    for (int b = 0; b < bodies.count(); ++b) {
+        if (bodies.texture[b] >= 0) textures[b] = loadSoftTexture(bodies.texture[b]);
+    }
+
+    RayTraceCamera camera;
+    camera.angleX = cameraAngleX;
+    camera.angleY = cameraAngleY;
+    camera.zoom = zoomLevel;
+    if (followBody >= 0) {
+        camera.target[0] = (float)bodies.worldX[followBody];
+        camera.target[1] = (float)bodies.worldY[followBody];
+        camera.target[2] = (float)bodies.worldZ[followBody];
+    }
+    return rayTraceImage(bodies, textures, camera, settings, path);
+}
+
+// Ray trace frames [first, last] of an animation that starts at the current
+// simulation time (--frames). Frame f shows start + f / frameRate.
+bool renderRayTracedFrames(const char* pattern, int first, int last, double frameRate, const RayTraceSettings& settings) {
+    double startTime = simulationTime;
+    for (int f = first; f <= last; ++f) {
+        std::string name;
+        if (!frameFileName(pattern, f, name)) {
+            std::cerr << "The output name needs a run of '#' for the frame number: " << pattern << std::endl;
+            return false;
+        }
+        simulationTime = startTime + f / frameRate;
+        resetCollisions();
+        if (!renderRayTraced(name.c_str(), settings)) return false;
+    }
+    simulationTime = startTime;
+    resetCollisions();
+    return true;
+}
+
+// Render server (--serve): the bodies are sorted and their textures loaded
+// once, and the table is recomputed only when a batch asks for a new epoch
+double servedTime = 0.0;
+bool servedTimeValid = false;
+std::vector<unsigned char> servedPixels;
+
+void initServedScene() {
+    for (int b = 0; b < bodies.count(); ++b) {
+        if (bodies.texture[b] < 0) {
+            pointBodies.push_back(b);
+            continue;
+        }
+        sphereBodies.push_back(b);
+        sphereSoftTextures.push_back(loadSoftTexture(bodies.texture[b]));
+    }
+    pointVertices.assign(pointBodies.size() * 3, 0.0f);
+}
+
+bool prepareServedRender(const RenderRequest& request) {
+    int follow = -1;
+    if (request.follow[0]) {
+        follow = findBody(request.follow);
+        if (follow < 0) return false;
+    }
+    if (!servedTimeValid || request.simulationTime != servedTime) {
+        simulationTime = request.simulationTime;
+        resetCollisions();
+        for (int l = 0; l < bodies.levelCount; ++l) {
+            JobCounter levelDone;
+            parallelFor(bodies.levelStart[l + 1] - bodies.levelStart[l], BODY_JOB_GRAIN, updateBodiesJob,
+                &bodies.levelStart[l], &levelDone);
+            waitForCounter(&levelDone);
+        }
+        servedTime = request.simulationTime;
+        servedTimeValid = true;
+    }
+    followBody = follow;
+    rebaseOnCamera();
+    return true;
+}
+
+// Draw one request with the CPU rasterizer, placing the camera like display()
+bool renderServedImage(const RenderRequest& request, std::vector<unsigned char>& png) {
+    const float degToRad = 3.14159265f / 180.0f;
+    float ca = cosf(request.angleY * degToRad), sa = sinf(request.angleY * degToRad);
+    float cb = cosf(request.angleX * degToRad), sb = sinf(request.angleX * degToRad);
+    float modelview[16] = {    // T(0, 0, zoom) * Rx(angleY) * Ry(angleX)
+        cb, sa * sb, -ca * sb, 0.0f,
+        0.0f, ca, sa, 0.0f,
+        sb, -sa * cb, ca * cb, 0.0f,
+        0.0f, 0.0f, request.zoom, 1.0f
+    };
+    int w = request.width, h = request.height;
+    float f = 1.0f / tanf(22.5f * degToRad), zNear = (float)REVERSE_Z_NEAR, zFar = 1000.0f;
+    float projection[16] = {   // gluPerspective(45, w / h, zNear, zFar)
+        f * h / w, 0.0f, 0.0f, 0.0f,
+        0.0f, f, 0.0f, 0.0f,
+        0.0f, 0.0f, (zFar + zNear) / (zNear - zFar), -1.0f,
+        0.0f, 0.0f, 2.0f * zFar * zNear / (zNear - zFar), 0.0f
+    };
+
+    softBeginFrame(w, h, modelview, projection);
+    softSetLight((float)-bodies.origin[0], (float)-bodies.origin[1], (float)-bodies.origin[2]); // The Sun
+    if (request.layers & RENDER_LAYER_SPHERES) {
+        for (size_t k = 0; k < sphereBodies.size(); ++k) {
+            int b = sphereBodies[k];
+            softDrawSphere(bodies.frame(b), bodies.radius[b], bodyDetail(b), sphereSoftTextures[k], bodies.kind[b] == BODY_STAR);
+        }
+    }
+    if (request.layers & RENDER_LAYER_POINTS) {
+        softDrawPoints(pointVertices.data(), (int)pointBodies.size(), 179, 166, 153);
+    }
+    softEndFrame();
+
+    // RGBA rows bottom-up to RGB rows top-down
+    const unsigned char* color = softColorBuffer();
+    int stride = softStride();
+    servedPixels.resize((size_t)w * h * 3);
+    for (int y = 0; y < h; ++y) {
+        const unsigned char* src = color + (size_t)(h - 1 - y) * stride * 4;
+        unsigned char* dst = servedPixels.data() + (size_t)y * w * 3;
+        for (int x = 0; x < w; ++x) {
+            dst[3 * x] = src[4 * x];
+            dst[3 * x + 1] = src[4 * x + 1];
+            dst[3 * x + 2] = src[4 * x + 2];
+        }
+    }
+    encodePNG(w, h, servedPixels.data(), png);
+    return true;
 }
 
 // Initialize OpenGL settings
@@ -455,66 +1283,264 @@ void initOpenGL() {
     glMaterialfv(GL_FRONT, GL_SPECULAR, mat_specular);
     glMaterialfv(GL_FRONT, GL_SHININESS, mat_shininess);
 
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(45.0, 800.0 / 600.0, 1.0, 100.0);
-    glMatrixMode(GL_MODELVIEW);
+    // Reverse-Z where supported (the software renderer keeps its own depth)
+    if (!softwareRendering && GLEW_ARB_clip_control && GLEW_ARB_framebuffer_object && GLEW_ARB_depth_buffer_float) {
+        setDepthConvention(true);
+    }
+    setProjection(800, 600);
+
+    // Sort bodies into spheres and points. GL textures stream in from the
+    // residency manager, one per file, starting with their smallest mips.
+    if (!softwareRendering) initResidency(loadBMP, textureBudget);
+    for (int b = 0; b < bodies.count(); ++b) {
+        int32_t path = bodies.texture[b];
+        if (path < 0) {
+            pointBodies.push_back(b);
+            continue;
+        }
+        sphereBodies.push_back(b);
+        if (softwareRendering) {
+            sphereSoftTextures.push_back(loadSoftTexture(path));
+            continue;
+        }
+        sphereTextures.push_back(registerTexture(bodies.string(path)));
+
+        // Optional surface detail, built with tools/terrainconv
+        Terrain* terrain = nullptr;
+        const char* name = bodies.string(bodies.name[b]);
+        std::string terrainPath = std::string("terrain/") + (name ? name : "") + ".ter";
+        if (name && std::ifstream(terrainPath.c_str())) terrain = openTerrain(terrainPath.c_str());
+        sphereTerrains.push_back(terrain);
+        sphereVisible.push_back(1);
+        sphereCoverage.push_back(0.0f);
+    }
+    pointVertices.assign(pointBodies.size() * 3, 0.0f);
 
-    // Load textures for Sun and planets
-    std::string texturePaths[] = {
-        "texture/sun.bmp",       // textures[0]
-        "texture/mercury.bmp",   // textures[1]
-        "texture/venus.bmp",     // textures[2]
-        "texture/earth.bmp",     // textures[3]
-        "texture/mars.bmp",      // textures[4]
-        "texture/jupiter.bmp",   // textures[5]
-        "texture/saturn.bmp",    // textures[6]
-        "texture/uranus.bmp",    // textures[7]
-        "texture/neptune.bmp",   // textures[8]
-        "texture/pluto.bmp"      // textures[9]
-    };
+    // Load the star catalog (falls back to the Milky Way sphere if missing)
+    starCatalogLoaded = loadStarCatalog("catalog/stars.bin");
+    if (!starCatalogLoaded && !softwareRendering) {
+        backgroundTexture = registerTexture("texture/milkyway.bmp");
+    }
+
+    // Collect the bodies with trails, labels and rings
+    for (int b = 0; b < bodies.count(); ++b) {
+        if (bodies.flags[b] & BODY_FLAG_TRAIL) trailBodies.push_back(b);
+        if (bodies.flags[b] & BODY_FLAG_LABEL) labelBodies.push_back(b);
+        if ((bodies.flags[b] & BODY_FLAG_RINGS) && bodies.frameSlot[b] >= 0 && ringBody < 0) ringBody = b;
+    }
+    trailX.resize(trailBodies.size());
+    trailY.resize(trailBodies.size());
+    trailZ.resize(trailBodies.size());
+
+    // Place the bodies and allocate their trails
+    updateBodyTable();
+    buildBvh(bodies);
+    initTrails((int)trailBodies.size());
+    if (!softwareRendering) initComets();
+
+    if (ringBody >= 0) initRings(bodies.radius[ringBody]);
+
+    // Scattering tables per atmosphere, from the cache when the parameters are unchanged
+    if (!softwareRendering && initAtmosphereRendering()) {
+        for (int b = 0; b < bodies.count(); ++b) {
+            if (!(bodies.flags[b] & BODY_FLAG_ATMOSPHERE)) continue;
+            atmosphereBodies.push_back(b);
+            atmosphereModels.push_back(loadAtmosphere(bodies.string(bodies.name[b])));
+        }
+    }
+    initHud();
+
+    // Orbit paths are static, so they are drawn only around root bodies.
+    // An orbit is a circle tilted by its inclination, traversed like glRotatef about Y.
+    clearOrbits();
+    for (int b = 0; b < bodies.count(); ++b) {
+        int p = bodies.parent[b];
+        if (!(bodies.flags[b] & BODY_FLAG_ORBIT) || p < 0 || bodies.parent[p] >= 0) continue;
+        float d = bodies.distance[b];
+        float inc = bodies.inclination[b] * 3.14159265f / 180.0f;
+        addOrbit(bodies.posX[p], bodies.posY[p], bodies.posZ[p],
+            d * cosf(inc), d * sinf(inc), 0.0f, 0.0f, 0.0f, -d);
+    }
+}
+
+int main(int argc, char** argv) {
+    // --refresh-rate <Hz> paces frames for displays other than 60 Hz;
+    // --paused starts with the simulation stopped (idle kiosk displays);
+    // --scene <file> loads another binary scene;
+    // --checkpoint-every <seconds> saves the state to checkpoint.ckpt periodically;
+    // --resume <file> continues from a checkpoint;
+    // --capture <file> records video from the start (.yuv for raw frames);
+    // --software renders the bodies on the CPU instead of through OpenGL;
+    // --time <seconds> starts the simulation clock there;
+    // --camera <angleX> <angleY> <zoom> and --follow <name> place the camera;
+    // --raytrace <file> renders one still (.exr or .png) without opening a
+    // window, with --size <width> <height>, --samples <n> and --progressive;
+    // --frames <first> <last> renders numbered frames instead ('#' in the
+    // file name), --fps <rate> apart;
+    // --farm <n> and --farm-host <command> split the frames across n local
+    // workers or a remote command, --chunk <frames> at a time, and
+    // --farm-video <file> encodes the result;
+    // --threads <n> sets the job system's thread count;
+    // --telemetry <name> publishes every tick's positions to shared memory;
+    // --serve <socket> answers render requests on a Unix socket without a window;
+    // --no-collisions skips close-approach and collision detection
+    double refreshRate = DEFAULT_REFRESH_RATE;
+    bool startPaused = false;
+    const char* resumePath = nullptr;
+    const char* followName = nullptr;
+    const char* rayTracePath = nullptr;
+    const char* servePath = nullptr;
+    RayTraceSettings rayTraceSettings;
+    bool renderFrames = false;
+    int jobThreads = 0; // 0 for one per hardware thread
+    int localWorkers = 0;
+    FarmJob farm;
+    farm.frameRate = 1.0 / SIMULATION_STEP;
+    for (int i = 1; i < argc; ++i) {
+        // Farm options stay with the coordinator; everything else is passed on to its workers
+        int optionStart = i;
+        if (strcmp(argv[i], "--frames") == 0 && i + 2 < argc) {
+            farm.firstFrame = atoi(argv[++i]);
+            farm.lastFrame = atoi(argv[++i]);
+            renderFrames = true;
+            continue;
+        }
+        else if (strcmp(argv[i], "--farm") == 0 && i + 1 < argc) {
+            localWorkers = atoi(argv[++i]);
+            continue;
+        }
+        else if (strcmp(argv[i], "--farm-host") == 0 && i + 1 < argc) {
+            farm.workers.push_back(argv[++i]);
+            continue;
+        }
+        else if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+            farm.chunkFrames = atoi(argv[++i]);
+            continue;
+        }
+        else if (strcmp(argv[i], "--farm-video") == 0 && i + 1 < argc) {
+            farm.video = argv[++i];
+            continue;
+        }
+
+        if (strcmp(argv[i], "--refresh-rate") == 0 && i + 1 < argc) refreshRate = atof(argv[++i]);
+        else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) scenePath = argv[++i];
+        else if (strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc) checkpointInterval = atof(argv[++i]);
+        else if (strcmp(argv[i], "--resume") == 0 && i + 1 < argc) resumePath = argv[++i];
+        else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            capturePath = argv[++i];
+            captureOnStart = true;
+        }
+        else if (strcmp(argv[i], "--paused") == 0) startPaused = true;
+        else if (strcmp(argv[i], "--software") == 0) softwareRendering = true;
+        else if (strcmp(argv[i], "--time") == 0 && i + 1 < argc) {
+            simulationTime = atof(argv[++i]);
+            resetCollisions();
+        }
+        else if (strcmp(argv[i], "--no-collisions") == 0) collisionDetection = false;
+        else if (strcmp(argv[i], "--camera") == 0 && i + 3 < argc) {
+            cameraAngleX = (float)atof(argv[++i]);
+            cameraAngleY = (float)atof(argv[++i]);
+            zoomLevel = (float)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--follow") == 0 && i + 1 < argc) followName = argv[++i];
+        else if (strcmp(argv[i], "--raytrace") == 0 && i + 1 < argc) rayTracePath = argv[++i];
+        else if (strcmp(argv[i], "--size") == 0 && i + 2 < argc) {
+            rayTraceSettings.width = atoi(argv[++i]);
+            rayTraceSettings.height = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) rayTraceSettings.samples = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--progressive") == 0) rayTraceSettings.progressive = true;
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) farm.frameRate = atof(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) jobThreads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) servePath = argv[++i];
+        else if (strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc) telemetryName = argv[++i];
+        else if (strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc) textureBudget = (size_t)(atof(argv[++i]) * 1048576.0);
+
+        for (int a = optionStart; a <= i; ++a) farm.workerArgs += " " + shellQuote(argv[a]);
+    }
 
-    for (int i = 0; i < NUM_PLANETS + 1; ++i) { // Including Pluto
-        textures[i] = loadBMPTexture(texturePaths[i].c_str());
-        if (!textures[i]) {
-            std::cerr << "Failed to load texture: " << texturePaths[i] << std::endl;
+    // Local workers share this machine's cores
+    if (localWorkers > 0) {
+        int cores = (int)std::thread::hardware_concurrency();
+        int threads = std::max(cores / localWorkers, 1);
+        for (int w = 0; w < localWorkers; ++w) {
+            farm.workers.push_back(shellQuote(argv[0]) + " --threads " + std::to_string(threads));
         }
     }
 
-    // Load moon texture
-    moonTexture = loadBMPTexture("texture/moon.bmp");
-    if (!moonTexture) {
-        std::cerr << "Failed to load moon texture: texture/moon.bmp" << std::endl;
+    // The coordinator only launches workers; they load the scene themselves
+    if (!farm.workers.empty()) {
+        if (!rayTracePath || !renderFrames) {
+            std::cerr << "The render farm needs --raytrace <file> and --frames <first> <last>" << std::endl;
+            return 1;
+        }
+        farm.pattern = rayTracePath;
+        return runFarm(farm) ? 0 : 1;
     }
 
-    // Load Milky Way background texture
-    backgroundTexture = loadBMPTexture("texture/milkyway.bmp");
-    if (!backgroundTexture) {
-        std::cerr << "Failed to load background texture: texture/milkyway.bmp" << std::endl;
+    if (!loadScene(scenePath)) {
+        return 1;
+    }
+    if (resumePath && !resumeFromCheckpoint(resumePath)) {
+        return 1;
+    }
+    nextCheckpointTime = simulationTime + checkpointInterval;
+    if (followName) {
+        followBody = findBody(followName);
+        if (followBody < 0) std::cerr << "No body named " << followName << std::endl;
     }
 
-    // Initialize moon properties for each planet
-    for (int i = 0; i < NUM_PLANETS; ++i) {
-        moons[i].orbitDistance = 1.5f + i * 0.5f; // Example distances
-        moons[i].orbitSpeed = 0.5f + i * 0.1f;    // Example speeds
-        moons[i].rotationSpeed = 1.0f + i * 0.2f; // Example rotation speeds
+    if (rayTracePath) {
+        initJobs(jobThreads);
+        bool ok = renderFrames ?
+            renderRayTracedFrames(rayTracePath, farm.firstFrame, farm.lastFrame, farm.frameRate, rayTraceSettings) :
+            renderRayTraced(rayTracePath, rayTraceSettings);
+        shutdownJobs();
+        return ok ? 0 : 1;
     }
-}
 
-int main(int argc, char** argv) {
+    if (servePath) {
+        initJobs(jobThreads);
+        initServedScene();
+        RenderServerHandlers handlers = { prepareServedRender, renderServedImage };
+        bool ok = runRenderServer(servePath, handlers);
+        shutdownJobs();
+        return ok ? 0 : 1;
+    }
+
+    // GLUT needs a display, so it starts only after the headless modes
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
     glutInitWindowSize(800, 600);
     glutCreateWindow("3D Solar System with Moons and Milky Way Background");
 
+    GLenum glewStatus = glewInit();
+    if (glewStatus != GLEW_OK) {
+        std::cerr << "Failed to initialize GLEW: " << glewGetErrorString(glewStatus) << std::endl;
+        return 1;
+    }
+
+    initJobs(jobThreads);
+    atexit(shutdownJobs);
+    initCheckpoints();
+    atexit(shutdownCheckpoints); // Finishes a checkpoint still being written
     initOpenGL();
+    atexit(shutdownResidency);
+    atexit(shutdownTerrain);
+    if (telemetryName && openTelemetry(telemetryName, bodies)) {
+        atexit(shutdownTelemetry);
+        beginTelemetryTick(simulationTime); // Readers see the starting positions even while paused
+        writeTelemetry(bodies, 0, bodies.count());
+        endTelemetryTick();
+    }
 
     glutDisplayFunc(display);
     glutReshapeFunc(reshape);
     glutMouseFunc(mouseHandler);       // Handle both mouse wheel and button events
     glutMotionFunc(mouseDrag);         // Handle mouse drag
     glutKeyboardFunc(keyboardHandler); // Handle keyboard inputs
-    glutTimerFunc(16, update, 0);      // Start the update loop (~60 FPS)
+    initFramePacer(refreshRate);
+    setPaused(startPaused);            // Starts the paced update loop unless paused
     glutMainLoop();
 
     return 0;
@@ -0,0 +1,25 @@
+// StarCatalog.h
+#pragma once
+#include <cstdint>
+
+// Binary star catalog layout, shared by the renderer and tools/starconv.cpp.
+// A StarCatalogHeader is followed by `count` StarRecords sorted by magnitude,
+// brightest first, so every limiting magnitude selects a prefix of the file.
+const char STAR_CATALOG_MAGIC[4] = { 'S', 'T', 'A', 'R' };
+const uint32_t STAR_CATALOG_VERSION = 1;
+
+struct StarCatalogHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+struct StarRecord {
+    float x, y, z;     // Unit direction
+    float magnitude;   // Apparent visual magnitude
+    uint8_t color[4];  // RGBA derived from B-V color index
+};
+
+static_assert(sizeof(StarCatalogHeader) == 16, "StarCatalogHeader must be 16 bytes");
+static_assert(sizeof(StarRecord) == 20, "StarRecord must be 20 bytes");
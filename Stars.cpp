@@ -0,0 +1,151 @@
+// Stars.cpp
+#include "Stars.h"
+#include "StarCatalog.h"
+#include "MappedFile.h"
+#include "PerfCounters.h"
+#include "Shaders.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+static GLuint starVBO = 0;
+static GLuint starProgram = 0;
+static int starCount = 0;
+
+// Stars brighter than the upper edge of each magnitude bucket
+static int bucketPrefix[STAR_BUCKETS];
+
+// Precomputed sprite size and brightness per magnitude bucket
+static float bucketSize[STAR_BUCKETS];
+static float bucketAlpha[STAR_BUCKETS];
+
+static const char* starVertexShader =
+    "#version 120\n"
+    "uniform float sizes[64];\n"
+    "uniform float alphas[64];\n"
+    "uniform float minMagnitude;\n"
+    "uniform float bucketWidth;\n"
+    "uniform float radius;\n"
+    "void main() {\n"
+    "    int k = int(clamp((gl_MultiTexCoord0.x - minMagnitude) / bucketWidth, 0.0, 63.0));\n"
+    "    gl_PointSize = sizes[k];\n"
+    "    gl_FrontColor = vec4(gl_Color.rgb, alphas[k]);\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * vec4(gl_Vertex.xyz * radius, 1.0);\n"
+    "}\n";
+
+static const char* starFragmentShader =
+    "#version 120\n"
+    "void main() {\n"
+    "    float r = 2.0 * length(gl_PointCoord - vec2(0.5));\n"
+    "    gl_FragColor = vec4(gl_Color.rgb, gl_Color.a * smoothstep(1.0, 0.2, r));\n"
+    "}\n";
+
+// Fill the per-bucket size and brightness tables
+static void buildMagnitudeTables() {
+    for (int k = 0; k < STAR_BUCKETS; ++k) {
+        float m = STAR_MIN_MAGNITUDE + (k + 0.5f) * STAR_BUCKET_WIDTH;
+        bucketSize[k] = std::min(std::max(6.0f * powf(10.0f, -0.12f * (m + 1.5f)), 1.0f), 6.0f);
+        bucketAlpha[k] = std::min(std::max(powf(10.0f, -0.4f * (m - 2.0f)), 0.12f), 1.0f);
+    }
+}
+
+bool loadStarCatalog(const char* path) {
+    MappedFile file;
+    if (!mapFile(path, file)) return false;
+
+    StarCatalogHeader header;
+    if (file.size < sizeof(header)) {
+        std::cerr << "Star catalog is truncated: " << path << std::endl;
+        unmapFile(file);
+        return false;
+    }
+    memcpy(&header, file.data, sizeof(header));
+    if (memcmp(header.magic, STAR_CATALOG_MAGIC, 4) != 0 || header.version != STAR_CATALOG_VERSION
+        || file.size < sizeof(header) + (size_t)header.count * sizeof(StarRecord)) {
+        std::cerr << "Not a valid star catalog: " << path << std::endl;
+        unmapFile(file);
+        return false;
+    }
+
+    const StarRecord* records = (const StarRecord*)(file.data + sizeof(header));
+    starCount = (int)header.count;
+
+    // Records are sorted by magnitude, so each bucket boundary is a binary search
+    for (int k = 0; k < STAR_BUCKETS; ++k) {
+        float edge = STAR_MIN_MAGNITUDE + (k + 1) * STAR_BUCKET_WIDTH;
+        const StarRecord* end = std::upper_bound(records, records + starCount, edge,
+            [](float m, const StarRecord& s) { return m < s.magnitude; });
+        bucketPrefix[k] = (int)(end - records);
+    }
+
+    // Upload straight from the mapping; the file is not needed afterwards
+    glGenBuffers(1, &starVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, starVBO);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)starCount * sizeof(StarRecord), records, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    unmapFile(file);
+
+    buildMagnitudeTables();
+    starProgram = compileShaderProgram(starVertexShader, starFragmentShader);
+    if (starProgram) {
+        glUseProgram(starProgram);
+        glUniform1fv(glGetUniformLocation(starProgram, "sizes"), STAR_BUCKETS, bucketSize);
+        glUniform1fv(glGetUniformLocation(starProgram, "alphas"), STAR_BUCKETS, bucketAlpha);
+        glUniform1f(glGetUniformLocation(starProgram, "minMagnitude"), STAR_MIN_MAGNITUDE);
+        glUniform1f(glGetUniformLocation(starProgram, "bucketWidth"), STAR_BUCKET_WIDTH);
+        glUniform1f(glGetUniformLocation(starProgram, "radius"), STAR_FIELD_RADIUS);
+        glUseProgram(0);
+    }
+    return true;
+}
+
+int starCountForMagnitude(float limitingMagnitude) {
+    if (!starVBO) return 0;
+    int k = (int)floorf((limitingMagnitude - STAR_MIN_MAGNITUDE) / STAR_BUCKET_WIDTH) - 1;
+    if (k < 0) return 0;
+    if (k >= STAR_BUCKETS) return starCount;
+    return bucketPrefix[k];
+}
+
+void drawStars(float limitingMagnitude) {
+    int count = starCountForMagnitude(limitingMagnitude);
+    if (count == 0) return;
+
+    glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_POINT_BIT);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_TEXTURE_2D);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE); // Stars add up
+
+    glPushMatrix();
+    if (starProgram) {
+        glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
+        glEnable(GL_POINT_SPRITE);
+        glUseProgram(starProgram);
+    }
+    else {
+        glPointSize(1.5f);
+        glScalef(STAR_FIELD_RADIUS, STAR_FIELD_RADIUS, STAR_FIELD_RADIUS);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, starVBO);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(StarRecord), (const void*)offsetof(StarRecord, x));
+    glTexCoordPointer(1, GL_FLOAT, sizeof(StarRecord), (const void*)offsetof(StarRecord, magnitude));
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(StarRecord), (const void*)offsetof(StarRecord, color));
+    glDrawArrays(GL_POINTS, 0, count);
+    perfCount(PERF_DRAW_CALLS);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (starProgram) glUseProgram(0);
+    glPopMatrix();
+    glPopAttrib();
+}
@@ -0,0 +1,23 @@
+// Stars.h
+#pragma once
+#include <GL/glew.h>
+
+// Star field from a binary catalog (see StarCatalog.h), drawn as point
+// sprites. The catalog is memory-mapped and uploaded to a static VBO once;
+// since it is sorted by magnitude, drawing down to a limiting magnitude is
+// a single glDrawArrays over a prefix, so the cost follows the number of
+// visible stars rather than the catalog size.
+const float STAR_MIN_MAGNITUDE = -2.0f;   // Brightest magnitude in the lookup tables
+const float STAR_BUCKET_WIDTH = 0.25f;    // Magnitude step of the lookup tables
+const int STAR_BUCKETS = 64;              // Covers magnitudes -2 to 14
+const float STAR_FIELD_RADIUS = 90.0f;    // Inside the far clip plane
+
+// Load and upload the catalog; returns false (and draws nothing) on failure
+bool loadStarCatalog(const char* path);
+
+// Number of stars brighter than the limiting magnitude
+int starCountForMagnitude(float limitingMagnitude);
+
+// Draw all stars brighter than the limiting magnitude. The current
+// modelview should contain the camera rotation only.
+void drawStars(float limitingMagnitude);
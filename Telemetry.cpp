@@ -0,0 +1,162 @@
+// Telemetry.cpp
+#include "Telemetry.h"
+#include "TelemetryFormat.h"
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static TelemetryHeader* header = nullptr;
+static size_t regionBytes = 0;
+static std::string regionName;
+static TelemetrySlot* writingSlot = nullptr;
+static uint64_t tick = 0;
+#ifdef _WIN32
+static HANDLE mappingHandle = nullptr;
+#endif
+
+static uint64_t alignUp(uint64_t offset, uint64_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+// Shared read-write memory of `bytes` under `name`, zero-filled
+static void* createRegion(const char* name, size_t bytes) {
+#ifdef _WIN32
+    regionName = std::string("Local\\") + name;
+    mappingHandle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+        (DWORD)((uint64_t)bytes >> 32), (DWORD)bytes, regionName.c_str());
+    void* view = mappingHandle ? MapViewOfFile(mappingHandle, FILE_MAP_WRITE, 0, 0, bytes) : nullptr;
+    if (!view) {
+        if (mappingHandle) CloseHandle(mappingHandle);
+        mappingHandle = nullptr;
+        return nullptr;
+    }
+    return view;
+#else
+    regionName = name[0] == '/' ? name : std::string("/") + name;
+    shm_unlink(regionName.c_str()); // A region left by a crashed run may have another size
+    int fd = shm_open(regionName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) return nullptr;
+    if (ftruncate(fd, (off_t)bytes) != 0) {
+        close(fd);
+        shm_unlink(regionName.c_str());
+        return nullptr;
+    }
+    void* view = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the object alive
+    if (view == MAP_FAILED) {
+        shm_unlink(regionName.c_str());
+        return nullptr;
+    }
+    return view;
+#endif
+}
+
+bool openTelemetry(const char* name, const BodyTable& table) {
+    uint64_t count = (uint64_t)table.count();
+    uint64_t stringBytes = 0;
+    for (int b = 0; b < table.count(); ++b) {
+        const char* bodyName = table.string(table.name[b]);
+        if (bodyName) stringBytes += strlen(bodyName) + 1;
+    }
+
+    TelemetryHeader layout;
+    memcpy(layout.magic, TELEMETRY_MAGIC, 4);
+    layout.version = TELEMETRY_VERSION;
+    layout.bodyCount = (uint32_t)count;
+    layout.slotCount = TELEMETRY_SLOTS;
+    layout.parentOffset = sizeof(TelemetryHeader);
+    layout.radiusOffset = layout.parentOffset + count * sizeof(int32_t);
+    layout.nameOffset = layout.radiusOffset + count * sizeof(float);
+    layout.stringsOffset = layout.nameOffset + count * sizeof(int32_t);
+    layout.slotOffset = alignUp(layout.stringsOffset + stringBytes, 64);
+    layout.slotBytes = alignUp(sizeof(TelemetrySlot) + 3 * count * sizeof(double), 64);
+    layout.reserved = 0;
+    size_t bytes = (size_t)(layout.slotOffset + layout.slotCount * layout.slotBytes);
+
+    unsigned char* region = (unsigned char*)createRegion(name, bytes);
+    if (!region) {
+        std::cerr << "Failed to create telemetry region: " << regionName << std::endl;
+        return false;
+    }
+
+    // Static part first; latestTick stays 0 until the first tick is complete
+    memcpy(region + layout.parentOffset, table.parent, count * sizeof(int32_t));
+    memcpy(region + layout.radiusOffset, table.radius, count * sizeof(float));
+    int32_t* nameOffsets = (int32_t*)(region + layout.nameOffset);
+    char* strings = (char*)(region + layout.stringsOffset);
+    int32_t offset = 0;
+    for (int b = 0; b < table.count(); ++b) {
+        const char* bodyName = table.string(table.name[b]);
+        if (!bodyName) {
+            nameOffsets[b] = -1;
+            continue;
+        }
+        size_t length = strlen(bodyName) + 1;
+        memcpy(strings + offset, bodyName, length);
+        nameOffsets[b] = offset;
+        offset += (int32_t)length;
+    }
+
+    header = (TelemetryHeader*)region;
+    memcpy(header->magic, layout.magic, 4);
+    header->version = layout.version;
+    header->bodyCount = layout.bodyCount;
+    header->slotCount = layout.slotCount;
+    header->slotBytes = layout.slotBytes;
+    header->parentOffset = layout.parentOffset;
+    header->radiusOffset = layout.radiusOffset;
+    header->nameOffset = layout.nameOffset;
+    header->stringsOffset = layout.stringsOffset;
+    header->slotOffset = layout.slotOffset;
+    header->reserved = 0;
+    header->latestTick.store(0, std::memory_order_release);
+    regionBytes = bytes;
+    tick = 0;
+    return true;
+}
+
+void shutdownTelemetry() {
+    if (!header) return;
+#ifdef _WIN32
+    UnmapViewOfFile(header);
+    CloseHandle(mappingHandle);
+    mappingHandle = nullptr;
+#else
+    munmap(header, regionBytes);
+    shm_unlink(regionName.c_str());
+#endif
+    header = nullptr;
+    writingSlot = nullptr;
+}
+
+bool beginTelemetryTick(double simulationTime) {
+    if (!header) return false;
+    ++tick;
+    writingSlot = telemetrySlot(header, tick);
+    writingSlot->sequence.store(2 * tick - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release); // Odd before any data changes
+    writingSlot->tick = tick;
+    writingSlot->simulationTime = simulationTime;
+    return true;
+}
+
+void writeTelemetry(const BodyTable& table, int begin, int end) {
+    size_t bytes = (size_t)(end - begin) * sizeof(double);
+    memcpy(telemetryColumn(header, writingSlot, 0) + begin, table.worldX.data() + begin, bytes);
+    memcpy(telemetryColumn(header, writingSlot, 1) + begin, table.worldY.data() + begin, bytes);
+    memcpy(telemetryColumn(header, writingSlot, 2) + begin, table.worldZ.data() + begin, bytes);
+}
+
+void endTelemetryTick() {
+    writingSlot->sequence.store(2 * tick, std::memory_order_release);
+    header->latestTick.store(tick, std::memory_order_release);
+    writingSlot = nullptr;
+}
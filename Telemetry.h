@@ -0,0 +1,23 @@
+// Telemetry.h
+#pragma once
+#include "Bodies.h"
+
+// Live body positions for other processes, published into a shared-memory
+// ring of seqlocked slots (layout in TelemetryFormat.h). Readers map the
+// region and read in place; the simulation never waits for them.
+
+// Create the region `name` for the table and fill in its static part;
+// prints an error and returns false on failure
+bool openTelemetry(const char* name, const BodyTable& table);
+
+// Unmap the region and remove its name
+void shutdownTelemetry();
+
+// Publishing a tick is split in three so the copy can run as jobs, like
+// the trail writes. beginTelemetryTick() claims the next slot and returns
+// false when telemetry is off; writeTelemetry() copies bodies [begin, end)
+// and may run on any thread for disjoint ranges; endTelemetryTick()
+// releases the slot to readers.
+bool beginTelemetryTick(double simulationTime);
+void writeTelemetry(const BodyTable& table, int begin, int end);
+void endTelemetryTick();
@@ -0,0 +1,71 @@
+// TelemetryFormat.h
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Layout of the shared-memory region published with --telemetry <name>,
+// shared by the simulation (Telemetry.cpp) and readers such as
+// tools/telemetryreader.cpp. On POSIX the region is the shared-memory
+// object "/<name>" (shm_open); on Windows it is the named mapping
+// "Local\<name>". Everything is native-endian and written once at open,
+// except the slots:
+//
+//     TelemetryHeader
+//     int32 parent[bodyCount]        (-1 for roots)
+//     float radius[bodyCount]
+//     int32 nameOffset[bodyCount]    (into the strings, -1 for none)
+//     char strings[stringBytes]      (NUL-terminated names)
+//     slotCount slots, each slotBytes long and 64-byte aligned:
+//         TelemetrySlot
+//         double x[bodyCount], y[bodyCount], z[bodyCount]   (world positions)
+//
+// Every update tick fills the next slot of the ring, guarded by the slot's
+// sequence number (a seqlock): it is odd while the slot is being written
+// and 2 * tick once tick is complete, after which header.latestTick
+// becomes tick. Ticks count from 1; latestTick is 0 until the first one.
+// A reader loads latestTick, reads slot latestTick % slotCount in place
+// while its sequence is 2 * latestTick, and checks afterwards that the
+// sequence did not change (see telemetryreader.cpp). The writer only
+// reuses a slot slotCount - 1 ticks later, so readers almost never retry
+// and never block the simulation.
+const char TELEMETRY_MAGIC[4] = { 'T', 'L', 'M', 'Y' };
+const uint32_t TELEMETRY_VERSION = 1;
+const uint32_t TELEMETRY_SLOTS = 4;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Telemetry needs lock-free 64-bit atomics across processes");
+
+struct TelemetryHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t bodyCount;
+    uint32_t slotCount;
+    uint64_t slotBytes;
+    uint64_t parentOffset;    // Byte offsets from the start of the region
+    uint64_t radiusOffset;
+    uint64_t nameOffset;
+    uint64_t stringsOffset;
+    uint64_t slotOffset;      // Of slot 0
+    std::atomic<uint64_t> latestTick;
+    uint64_t reserved;
+};
+
+static_assert(sizeof(TelemetryHeader) == 80, "TelemetryHeader must be 80 bytes");
+
+struct TelemetrySlot {
+    std::atomic<uint64_t> sequence;
+    uint64_t tick;
+    double simulationTime;    // Seconds; positions follow from it
+    uint64_t reserved[5];
+};
+
+static_assert(sizeof(TelemetrySlot) == 64, "TelemetrySlot must be 64 bytes");
+
+inline TelemetrySlot* telemetrySlot(const TelemetryHeader* header, uint64_t tick) {
+    unsigned char* base = (unsigned char*)header;
+    return (TelemetrySlot*)(base + header->slotOffset + (tick % header->slotCount) * header->slotBytes);
+}
+
+// Column c (0 = x, 1 = y, 2 = z) of a slot
+inline double* telemetryColumn(const TelemetryHeader* header, TelemetrySlot* slot, int c) {
+    return (double*)(slot + 1) + (uint64_t)c * header->bodyCount;
+}
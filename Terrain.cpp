@@ -0,0 +1,540 @@
+// Terrain.cpp
+#include "Terrain.h"
+#include "FrameArena.h"
+#include "MappedFile.h"
+#include "PerfCounters.h"
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+static const int GRID = TERRAIN_TILE_VERTICES;
+static const int SAMPLES = TERRAIN_TILE_SAMPLES;
+static const int VERTEX_FLOATS = 8; // Position, normal, texture coordinates
+static const int CHUNK_VERTICES = GRID * GRID + 4 * GRID; // Grid, then one skirt row per edge
+static const int UPLOADS_PER_FRAME = 64;
+static const double HALF_PI = 1.5707963267949;
+
+struct TerrainChunk {
+    GLuint vbo = 0;
+    GLuint indexBuffer = 0;                 // Own triangles of a pole chunk, else 0 for the shared ones
+    float center[3] = { 0.0f, 0.0f, 0.0f }; // Mesh origin, in planet radii
+    bool loading = false;
+    int lastUsedFrame = 0;
+};
+
+struct Terrain {
+    MappedFile file;
+    TerrainHeader header;
+    std::unordered_map<uint64_t, TerrainChunk> chunks;
+    TerrainStats stats;
+    int frame = 0;
+};
+
+// A chunk meshed on the loader thread
+struct ChunkLoad {
+    Terrain* terrain = nullptr;
+    uint64_t key = 0;
+    int level = 0, face = 0, x = 0, y = 0;
+    float center[3] = { 0.0f, 0.0f, 0.0f };
+    std::vector<float> vertices;
+    std::vector<GLushort> indices;          // Only for pole chunks
+};
+
+// Quadtree node being considered for drawing
+struct ChunkNode {
+    int level, face, x, y;
+    float spacing; // Screen pixels between vertices
+    bool operator<(const ChunkNode& other) const { return spacing < other.spacing; }
+};
+
+static std::thread loaderThread;
+static std::mutex loaderLock;
+static std::condition_variable loaderWake;
+static std::deque<ChunkLoad> pendingLoads;
+static std::deque<ChunkLoad> finishedLoads;
+static bool loaderRunning = false;
+static int loadsInFlight = 0; // Requested and not yet uploaded (GL thread only)
+
+static GLuint chunkIndexBuffer = 0;
+static int chunkIndexCount = 0;
+static std::vector<GLushort> chunkIndices; // Built before the loader starts, then read-only
+
+static uint64_t chunkKey(int level, int face, int x, int y) {
+    return ((uint64_t)level << 56) | ((uint64_t)face << 48) | ((uint64_t)y << 24) | (uint64_t)x;
+}
+
+// Appends a copy of vertex v with texture coordinate s; returns its index
+static GLushort copyVertex(std::vector<float>& vertices, int v, float s) {
+    size_t copy = vertices.size() / VERTEX_FLOATS;
+    vertices.resize(vertices.size() + VERTEX_FLOATS);
+    memcpy(&vertices[copy * VERTEX_FLOATS], &vertices[(size_t)v * VERTEX_FLOATS], VERTEX_FLOATS * sizeof(float));
+    vertices[copy * VERTEX_FLOATS + 6] = s;
+    return (GLushort)copy;
+}
+
+// A chunk on a +-Z face that holds a pole sees s go all the way round it,
+// so no single shift keeps s continuous. It gets its own triangles: corners
+// on the low side of the seam are copied with s + 1, and each triangle at
+// the pole gets its own pole vertex at the middle of its other corners' s,
+// as gluSphere's slices do.
+static void splitPoleChunk(ChunkLoad& load, const bool* atPole) {
+    std::vector<float>& vertices = load.vertices;
+    load.indices = chunkIndices;
+    GLushort shifted[CHUNK_VERTICES];
+    for (int v = 0; v < CHUNK_VERTICES; ++v) shifted[v] = 0; // 0 is never a copy
+    for (size_t n = 0; n < load.indices.size(); n += 3) {
+        GLushort* tri = &load.indices[n];
+        float s[3];
+        float minS = 1.0f, maxS = 0.0f;
+        for (int k = 0; k < 3; ++k) {
+            s[k] = vertices[(size_t)tri[k] * VERTEX_FLOATS + 6];
+            if (atPole[tri[k]]) continue;
+            minS = std::min(minS, s[k]);
+            maxS = std::max(maxS, s[k]);
+        }
+        bool wraps = maxS - minS > 0.5f;
+        float sum = 0.0f;
+        int count = 0;
+        for (int k = 0; k < 3; ++k) {
+            if (atPole[tri[k]]) continue;
+            if (wraps && s[k] < 0.5f) {
+                if (!shifted[tri[k]]) shifted[tri[k]] = copyVertex(vertices, tri[k], s[k] + 1.0f);
+                tri[k] = shifted[tri[k]];
+                s[k] += 1.0f;
+            }
+            sum += s[k];
+            ++count;
+        }
+        for (int k = 0; k < 3; ++k) {
+            if (atPole[tri[k]]) tri[k] = copyVertex(vertices, tri[k], sum / count);
+        }
+    }
+}
+
+// Build the chunk's vertices: heights from the tile, normals from the
+// neighbouring samples (the border included, so they match across
+// chunks), skirts hanging below the four edges
+static void meshChunk(ChunkLoad& load) {
+    const TerrainHeader& header = load.terrain->header;
+    const int16_t* tile = (const int16_t*)(load.terrain->file.data + terrainTileOffset(load.level, load.face, load.x, load.y));
+
+    double positions[SAMPLES][SAMPLES][3];
+    double directions[SAMPLES][SAMPLES][3];
+    for (int j = 0; j < SAMPLES; ++j) {
+        for (int i = 0; i < SAMPLES; ++i) {
+            double* dir = directions[j][i];
+            terrainDirection(load.face, terrainSampleCoordinate(load.level, load.x, i),
+                terrainSampleCoordinate(load.level, load.y, j), dir);
+            double r = 1.0 + tile[j * SAMPLES + i] * (double)header.heightScale;
+            for (int c = 0; c < 3; ++c) positions[j][i][c] = dir[c] * r;
+        }
+    }
+    const double* middle = directions[SAMPLES / 2][SAMPLES / 2];
+    for (int c = 0; c < 3; ++c) load.center[c] = (float)middle[c];
+
+    // Skirts reach below the largest step a coarser neighbour could leave
+    double spacing = HALF_PI / (1 << load.level) / (GRID - 1);
+    double skirt = std::min(2.0 * header.maxHeight, 4.0 * spacing) + 0.25 * spacing;
+
+    load.vertices.resize((size_t)CHUNK_VERTICES * VERTEX_FLOATS);
+    double s[GRID * GRID], t[GRID * GRID];
+    double minS = 1.0, maxS = 0.0;
+    bool atPole[CHUNK_VERTICES] = {};
+    bool holdsPole = false;
+    for (int j = 0; j < GRID; ++j) {
+        for (int i = 0; i < GRID; ++i) {
+            const double* dir = directions[j + 1][i + 1];
+            terrainTexCoord(dir, s[j * GRID + i], t[j * GRID + i]);
+            minS = std::min(minS, s[j * GRID + i]);
+            maxS = std::max(maxS, s[j * GRID + i]);
+            // Face coordinates are exact binary fractions, so the pole is hit exactly
+            atPole[j * GRID + i] = dir[0] == 0.0 && dir[1] == 0.0;
+            holdsPole = holdsPole || atPole[j * GRID + i];
+        }
+    }
+    bool wraps = !holdsPole && maxS - minS > 0.5; // Crosses the texture seam: keep s continuous
+
+    for (int j = 0; j < GRID; ++j) {
+        for (int i = 0; i < GRID; ++i) {
+            const double* p = positions[j + 1][i + 1];
+            const double* left = positions[j + 1][i], *right = positions[j + 1][i + 2];
+            const double* down = positions[j][i + 1], *up = positions[j + 2][i + 1];
+            double du[3], dv[3];
+            for (int c = 0; c < 3; ++c) {
+                du[c] = right[c] - left[c];
+                dv[c] = up[c] - down[c];
+            }
+            double n[3] = { du[1] * dv[2] - du[2] * dv[1], du[2] * dv[0] - du[0] * dv[2], du[0] * dv[1] - du[1] * dv[0] };
+            double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            float* v = &load.vertices[(size_t)(j * GRID + i) * VERTEX_FLOATS];
+            for (int c = 0; c < 3; ++c) {
+                v[c] = (float)(p[c] - middle[c]);
+                v[3 + c] = (float)(n[c] / length);
+            }
+            double sc = s[j * GRID + i];
+            v[6] = (float)(wraps && sc < 0.5 ? sc + 1.0 : sc);
+            v[7] = (float)t[j * GRID + i];
+        }
+    }
+
+    // Edges in the order bottom, top, left, right
+    for (int e = 0; e < 4; ++e) {
+        for (int k = 0; k < GRID; ++k) {
+            int i = e == 2 ? 0 : e == 3 ? GRID - 1 : k;
+            int j = e == 0 ? 0 : e == 1 ? GRID - 1 : k;
+            const float* edge = &load.vertices[(size_t)(j * GRID + i) * VERTEX_FLOATS];
+            float* v = &load.vertices[(size_t)(GRID * GRID + e * GRID + k) * VERTEX_FLOATS];
+            memcpy(v, edge, VERTEX_FLOATS * sizeof(float));
+            const double* dir = directions[j + 1][i + 1];
+            for (int c = 0; c < 3; ++c) v[c] -= (float)(dir[c] * skirt);
+            atPole[GRID * GRID + e * GRID + k] = atPole[j * GRID + i];
+        }
+    }
+
+    if (holdsPole) splitPoleChunk(load, atPole);
+}
+
+static void loaderLoop() {
+    std::unique_lock<std::mutex> guard(loaderLock);
+    while (true) {
+        loaderWake.wait(guard, [] { return !pendingLoads.empty() || !loaderRunning; });
+        if (!loaderRunning) break;
+
+        // Newest first: the camera has most likely moved on from old requests
+        ChunkLoad load = std::move(pendingLoads.back());
+        pendingLoads.pop_back();
+        guard.unlock();
+        meshChunk(load);
+        guard.lock();
+        finishedLoads.push_back(std::move(load));
+    }
+}
+
+void shutdownTerrain() {
+    if (!loaderThread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> guard(loaderLock);
+        loaderRunning = false;
+    }
+    loaderWake.notify_one();
+    loaderThread.join();
+}
+
+// Index buffer shared by every chunk
+static void buildIndices() {
+    std::vector<GLushort> indices;
+    auto quad = [&](int a, int b, int c, int d) {
+        GLushort q[6] = { (GLushort)a, (GLushort)b, (GLushort)c, (GLushort)a, (GLushort)c, (GLushort)d };
+        indices.insert(indices.end(), q, q + 6);
+    };
+    for (int j = 0; j + 1 < GRID; ++j) {
+        for (int i = 0; i + 1 < GRID; ++i) {
+            quad(j * GRID + i, j * GRID + i + 1, (j + 1) * GRID + i + 1, (j + 1) * GRID + i);
+        }
+    }
+    for (int e = 0; e < 4; ++e) {
+        for (int k = 0; k + 1 < GRID; ++k) {
+            int i0 = e == 2 ? 0 : e == 3 ? GRID - 1 : k, i1 = e >= 2 ? i0 : k + 1;
+            int j0 = e == 0 ? 0 : e == 1 ? GRID - 1 : k, j1 = e < 2 ? j0 : k + 1;
+            int skirt = GRID * GRID + e * GRID + k;
+            quad(j0 * GRID + i0, j1 * GRID + i1, skirt + 1, skirt);
+        }
+    }
+    chunkIndexCount = (int)indices.size();
+    glGenBuffers(1, &chunkIndexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, chunkIndexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    chunkIndices.swap(indices); // Pole chunks start from a copy
+}
+
+Terrain* openTerrain(const char* path) {
+    Terrain* terrain = new Terrain();
+    if (!mapFile(path, terrain->file)) {
+        delete terrain;
+        return nullptr;
+    }
+
+    const MappedFile& file = terrain->file;
+    bool ok = file.size >= sizeof(TerrainHeader);
+    if (ok) {
+        memcpy(&terrain->header, file.data, sizeof(TerrainHeader));
+        const TerrainHeader& h = terrain->header;
+        ok = memcmp(h.magic, TERRAIN_MAGIC, 4) == 0 && h.version == TERRAIN_VERSION &&
+            h.tileSamples == (uint32_t)TERRAIN_TILE_SAMPLES && h.levels >= 1 && h.levels <= (uint32_t)TERRAIN_MAX_LEVELS &&
+            file.size >= terrainTileOffset(h.levels, 0, 0, 0);
+    }
+    if (!ok) {
+        std::cerr << "Not a valid terrain file: " << path << std::endl;
+        unmapFile(terrain->file);
+        delete terrain;
+        return nullptr;
+    }
+
+    if (!chunkIndexBuffer) buildIndices();
+    if (!loaderThread.joinable()) {
+        loaderRunning = true;
+        loaderThread = std::thread(loaderLoop);
+    }
+    return terrain;
+}
+
+static void requestChunk(Terrain* terrain, int level, int face, int x, int y) {
+    TerrainChunk& chunk = terrain->chunks[chunkKey(level, face, x, y)];
+    chunk.lastUsedFrame = terrain->frame;
+    if (chunk.vbo || chunk.loading) return;
+    chunk.loading = true;
+    ++loadsInFlight;
+
+    ChunkLoad load;
+    load.terrain = terrain;
+    load.key = chunkKey(level, face, x, y);
+    load.level = level;
+    load.face = face;
+    load.x = x;
+    load.y = y;
+    {
+        std::lock_guard<std::mutex> guard(loaderLock);
+        pendingLoads.push_back(std::move(load));
+    }
+    loaderWake.notify_one();
+}
+
+static void uploadFinishedChunks() {
+    for (int n = 0; n < UPLOADS_PER_FRAME; ++n) {
+        ChunkLoad load;
+        {
+            std::lock_guard<std::mutex> guard(loaderLock);
+            if (finishedLoads.empty()) return;
+            load = std::move(finishedLoads.front());
+            finishedLoads.pop_front();
+        }
+        --loadsInFlight;
+        TerrainChunk& chunk = load.terrain->chunks[load.key];
+        chunk.loading = false;
+        memcpy(chunk.center, load.center, sizeof(chunk.center));
+        glGenBuffers(1, &chunk.vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, chunk.vbo);
+        glBufferData(GL_ARRAY_BUFFER, load.vertices.size() * sizeof(float), load.vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        if (!load.indices.empty()) {
+            glGenBuffers(1, &chunk.indexBuffer);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, chunk.indexBuffer);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, load.indices.size() * sizeof(GLushort), load.indices.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        }
+    }
+}
+
+// Whether a chunk can be drawn; either way it is requested and kept
+// cached, since the refinement wants it this frame
+static bool chunkReady(Terrain* terrain, int level, int face, int x, int y) {
+    requestChunk(terrain, level, face, x, y);
+    return terrain->chunks[chunkKey(level, face, x, y)].vbo != 0;
+}
+
+// View of the planet for one frame, everything in planet radii
+struct TerrainView {
+    float camera[3];       // In the body frame
+    float cameraDistance;
+    float modelview[16];
+    float radius;
+    float focal;           // Pixels per unit at distance 1
+    float sinX, cosX, sinY, cosY; // Side planes of the frustum
+    float horizon;         // Largest angle from the camera direction that can be seen
+};
+
+// Screen spacing of a node's vertices, or -1 if it cannot be seen
+static float nodeSpacing(const Terrain* terrain, const TerrainView& view, int level, int face, int x, int y) {
+    double center[3], corner[3];
+    terrainDirection(face, terrainSampleCoordinate(level, x, 1 + GRID / 2), terrainSampleCoordinate(level, y, 1 + GRID / 2), center);
+    terrainDirection(face, terrainSampleCoordinate(level, x, 1), terrainSampleCoordinate(level, y, 1), corner);
+    double cornerCos = center[0] * corner[0] + center[1] * corner[1] + center[2] * corner[2];
+    float angle = (float)acos(std::min(cornerCos, 1.0)); // Corners are the farthest points from the center
+    float maxHeight = terrain->header.maxHeight;
+
+    // Behind the horizon: every point of the chunk is farther round than the camera can see
+    float cameraCos = (float)((center[0] * view.camera[0] + center[1] * view.camera[1] + center[2] * view.camera[2]) / view.cameraDistance);
+    if (acosf(std::min(std::max(cameraCos, -1.0f), 1.0f)) - angle > view.horizon) return -1.0f;
+
+    // Outside the view: bounding sphere against the side planes in eye space
+    float boundRadius = 2.0f * sinf(0.5f * angle) + maxHeight;
+    const float* m = view.modelview;
+    float p[3] = { (float)center[0] * view.radius, (float)center[1] * view.radius, (float)center[2] * view.radius };
+    float ex = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12];
+    float ey = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13];
+    float depth = -(m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14]);
+    float r = boundRadius * view.radius;
+    if (depth < -r || fabsf(ex) * view.cosX - depth * view.sinX > r || fabsf(ey) * view.cosY - depth * view.sinY > r) return -1.0f;
+
+    float dx = view.camera[0] - (float)center[0], dy = view.camera[1] - (float)center[1], dz = view.camera[2] - (float)center[2];
+    float distance = std::max(sqrtf(dx * dx + dy * dy + dz * dz) - boundRadius, 1e-6f);
+    float vertexSpacing = (float)(HALF_PI / (1 << level) / (GRID - 1));
+    return vertexSpacing * view.focal / distance;
+}
+
+static void evictChunks(Terrain* terrain) {
+    if ((int)terrain->chunks.size() <= TERRAIN_CACHE_CHUNKS) return;
+    struct IdleChunk {
+        int lastUsedFrame;
+        uint64_t key;
+    };
+    IdleChunk* idle = frameArray<IdleChunk>(terrain->chunks.size());
+    size_t idleCount = 0;
+    for (auto& entry : terrain->chunks) {
+        const TerrainChunk& chunk = entry.second;
+        if (!chunk.loading && chunk.lastUsedFrame != terrain->frame && (entry.first >> 56) > 0) {
+            idle[idleCount++] = { chunk.lastUsedFrame, entry.first };
+        }
+    }
+    std::sort(idle, idle + idleCount, [](const IdleChunk& a, const IdleChunk& b) { return a.lastUsedFrame < b.lastUsedFrame; });
+    size_t excess = terrain->chunks.size() - TERRAIN_CACHE_CHUNKS;
+    for (size_t i = 0; i < idleCount && i < excess; ++i) {
+        TerrainChunk& chunk = terrain->chunks[idle[i].key];
+        if (chunk.vbo) glDeleteBuffers(1, &chunk.vbo);
+        if (chunk.indexBuffer) glDeleteBuffers(1, &chunk.indexBuffer);
+        terrain->chunks.erase(idle[i].key);
+    }
+}
+
+bool drawTerrain(Terrain* terrain, GLuint texture, float radius) {
+    uploadFinishedChunks();
+    ++terrain->frame;
+
+    // The roots cover the planet; without all six there is nothing to draw
+    bool rootsReady = true;
+    for (int face = 0; face < 6; ++face) {
+        if (!chunkReady(terrain, 0, face, 0, 0)) rootsReady = false;
+    }
+    if (!rootsReady) return false;
+
+    // The camera sits at -R^T t of the rigid modelview [R | t]
+    TerrainView view;
+    GLfloat projection[16];
+    GLint viewport[4];
+    glGetFloatv(GL_MODELVIEW_MATRIX, view.modelview);
+    glGetFloatv(GL_PROJECTION_MATRIX, projection);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    const float* m = view.modelview;
+    for (int i = 0; i < 3; ++i) view.camera[i] = -(m[4 * i] * m[12] + m[4 * i + 1] * m[13] + m[4 * i + 2] * m[14]) / radius;
+    view.cameraDistance = std::max(sqrtf(view.camera[0] * view.camera[0] + view.camera[1] * view.camera[1] + view.camera[2] * view.camera[2]), 1e-6f);
+    view.radius = radius;
+    view.focal = projection[5] * viewport[3] * 0.5f;
+    float tanX = 1.0f / projection[0], tanY = 1.0f / projection[5];
+    view.cosX = 1.0f / sqrtf(1.0f + tanX * tanX);
+    view.sinX = tanX * view.cosX;
+    view.cosY = 1.0f / sqrtf(1.0f + tanY * tanY);
+    view.sinY = tanY * view.cosY;
+    float low = 1.0f - terrain->header.maxHeight, high = 1.0f + terrain->header.maxHeight;
+    view.horizon = view.cameraDistance > low ?
+        acosf(low / view.cameraDistance) + acosf(low / high) : 3.14159265f; // Peaks show past the horizon
+
+    // Split the coarsest-looking chunk until the error or the budget is met.
+    // Open and selected chunks together never pass the budget, so both fit
+    // in arrays from the frame arena; the open ones form a max-heap.
+    ChunkNode* open = frameArray<ChunkNode>(TERRAIN_MAX_CHUNKS);
+    ChunkNode* selected = frameArray<ChunkNode>(TERRAIN_MAX_CHUNKS);
+    int openCount = 0, selectedCount = 0;
+    for (int face = 0; face < 6; ++face) {
+        float spacing = nodeSpacing(terrain, view, 0, face, 0, 0);
+        if (spacing >= 0.0f) open[openCount++] = { 0, face, 0, 0, spacing };
+    }
+    std::make_heap(open, open + openCount);
+    int planned = openCount;
+    int levels = (int)terrain->header.levels;
+    while (openCount > 0) {
+        std::pop_heap(open, open + openCount);
+        ChunkNode node = open[--openCount];
+        if (node.spacing > TERRAIN_MAX_SPACING && node.level + 1 < levels && planned + 3 <= TERRAIN_MAX_CHUNKS) {
+            ChunkNode children[4];
+            int visible = 0;
+            bool ready = true;
+            for (int c = 0; c < 4; ++c) {
+                int cx = 2 * node.x + (c & 1), cy = 2 * node.y + (c >> 1);
+                float spacing = nodeSpacing(terrain, view, node.level + 1, node.face, cx, cy);
+                if (spacing < 0.0f) continue;
+                children[visible++] = { node.level + 1, node.face, cx, cy, spacing };
+                if (!chunkReady(terrain, node.level + 1, node.face, cx, cy)) ready = false;
+            }
+            if (ready) {
+                for (int c = 0; c < visible; ++c) {
+                    open[openCount++] = children[c];
+                    std::push_heap(open, open + openCount);
+                }
+                planned += visible - 1;
+                continue;
+            }
+        }
+        selected[selectedCount++] = node;
+    }
+
+    glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT);
+    glEnable(GL_RESCALE_NORMAL);
+    if (texture) {
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        perfCount(PERF_TEXTURE_BINDS);
+    }
+    glColor3f(1.0f, 1.0f, 1.0f);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, chunkIndexBuffer);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+
+    TerrainStats& stats = terrain->stats;
+    stats.chunks = selectedCount;
+    stats.triangles = stats.chunks * chunkIndexCount / 3;
+    perfCount(PERF_DRAW_CALLS, stats.chunks);
+    perfCount(PERF_TRIANGLES, stats.triangles);
+    stats.deepestLevel = 0;
+    for (int i = 0; i < selectedCount; ++i) {
+        const ChunkNode& node = selected[i];
+        TerrainChunk& chunk = terrain->chunks[chunkKey(node.level, node.face, node.x, node.y)];
+        stats.deepestLevel = std::max(stats.deepestLevel, node.level);
+
+        glPushMatrix();
+        glScalef(radius, radius, radius);
+        glTranslatef(chunk.center[0], chunk.center[1], chunk.center[2]);
+        glBindBuffer(GL_ARRAY_BUFFER, chunk.vbo);
+        glVertexPointer(3, GL_FLOAT, VERTEX_FLOATS * sizeof(float), (const void*)0);
+        glNormalPointer(GL_FLOAT, VERTEX_FLOATS * sizeof(float), (const void*)(3 * sizeof(float)));
+        glTexCoordPointer(2, GL_FLOAT, VERTEX_FLOATS * sizeof(float), (const void*)(6 * sizeof(float)));
+        if (chunk.indexBuffer) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, chunk.indexBuffer);
+        glDrawElements(GL_TRIANGLES, chunkIndexCount, GL_UNSIGNED_SHORT, (const void*)0);
+        if (chunk.indexBuffer) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, chunkIndexBuffer);
+        glPopMatrix();
+    }
+
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glPopAttrib();
+
+    evictChunks(terrain);
+    stats.cached = (int)terrain->chunks.size();
+    stats.loading = loadsInFlight;
+    return true;
+}
+
+bool terrainBusy() {
+    return loadsInFlight > 0;
+}
+
+TerrainStats terrainStats(const Terrain* terrain) {
+    return terrain->stats;
+}
+
+float terrainMaxHeight(const Terrain* terrain) {
+    return terrain->header.maxHeight;
+}
@@ -0,0 +1,48 @@
+// Terrain.h
+#pragma once
+#include "TerrainFormat.h"
+#include <GL/glew.h>
+
+// Level-of-detail planet surfaces from a tile pyramid (TerrainFormat.h).
+// Each frame the quadtrees are refined from the six root chunks, always
+// splitting the visible chunk with the largest screen-space vertex spacing,
+// until no chunk's spacing exceeds TERRAIN_MAX_SPACING pixels or the next
+// split would pass TERRAIN_MAX_CHUNKS. The triangle count therefore stays
+// bounded however close the camera gets. Chunks behind the horizon or
+// outside the view are skipped. Missing chunks are read from the mapped
+// file and meshed on a loader thread; until all four children of a chunk
+// have arrived the parent is drawn instead. Each chunk hangs a skirt below
+// its edges, which hides the cracks between chunks of different levels.
+const int TERRAIN_MAX_CHUNKS = 384;        // Chunks drawn per frame at most
+const float TERRAIN_MAX_SPACING = 6.0f;    // Pixels between vertices before a chunk splits
+const int TERRAIN_CACHE_CHUNKS = 2048;     // Meshes kept in GPU memory per terrain
+
+struct Terrain;
+
+struct TerrainStats {
+    int chunks = 0;     // Drawn last frame
+    int triangles = 0;
+    int deepestLevel = 0;
+    int cached = 0;     // Meshes in GPU memory
+    int loading = 0;
+};
+
+// Open a tile pyramid; null (with an error printed) if it is not valid
+Terrain* openTerrain(const char* path);
+
+// Stop the loader thread (meshes go with the GL context)
+void shutdownTerrain();
+
+// Draw the surface of a planet of the given radius centered at the current
+// modelview origin, in the body's frame, with the planet's texture (may be
+// 0). Returns false if the root chunks have not loaded yet, in which case
+// the caller should draw the plain sphere.
+bool drawTerrain(Terrain* terrain, GLuint texture, float radius);
+
+// True while chunk loads are queued or waiting to be uploaded
+bool terrainBusy();
+
+TerrainStats terrainStats(const Terrain* terrain);
+
+// Highest ground above the mean radius, in planet radii
+float terrainMaxHeight(const Terrain* terrain);
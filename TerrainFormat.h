@@ -0,0 +1,76 @@
+// TerrainFormat.h
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+// Heightmap tile pyramid, shared by the renderer and tools/terrainconv.cpp.
+// The planet is a cube projected onto the sphere; each of the six faces is
+// a quadtree, and level l splits a face into 2^l x 2^l tiles. A
+// TerrainHeader is followed by every tile of level 0, then level 1, and so
+// on; within a level, face by face, rows of tiles bottom to top. A tile is
+// TERRAIN_TILE_SAMPLES^2 int16 heights, row by row, whose inner
+// TERRAIN_TILE_VERTICES^2 samples are the chunk's vertices. The one-sample
+// border belongs to the neighbours and is there for normals.
+const char TERRAIN_MAGIC[4] = { 'T', 'E', 'R', 'R' };
+const uint32_t TERRAIN_VERSION = 1;
+const int TERRAIN_TILE_VERTICES = 17;
+const int TERRAIN_TILE_SAMPLES = TERRAIN_TILE_VERTICES + 2;
+const int TERRAIN_MAX_LEVELS = 12;
+
+struct TerrainHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t levels;
+    uint32_t tileSamples;  // TERRAIN_TILE_SAMPLES
+    float heightScale;     // Planet radii per height unit
+    float maxHeight;       // Largest |height| in planet radii, for bounds
+};
+
+static_assert(sizeof(TerrainHeader) == 24, "TerrainHeader must be 24 bytes");
+
+// Tiles before level `level`
+inline uint64_t terrainLevelStart(int level) {
+    return 6 * (((uint64_t)1 << (2 * level)) - 1) / 3;
+}
+
+inline uint64_t terrainTileIndex(int level, int face, int x, int y) {
+    uint64_t side = (uint64_t)1 << level;
+    return terrainLevelStart(level) + (uint64_t)face * side * side + (uint64_t)y * side + x;
+}
+
+inline uint64_t terrainTileOffset(int level, int face, int x, int y) {
+    return sizeof(TerrainHeader) + terrainTileIndex(level, face, x, y) * TERRAIN_TILE_SAMPLES * TERRAIN_TILE_SAMPLES * sizeof(int16_t);
+}
+
+// Unit direction of face coordinates (u, v) in [-1, 1]; faces are +X, -X,
+// +Y, -Y, +Z, -Z, each seen from outside with u right and v up
+inline void terrainDirection(int face, double u, double v, double* dir) {
+    double p[3];
+    switch (face) {
+    case 0: p[0] = 1.0; p[1] = v; p[2] = -u; break;
+    case 1: p[0] = -1.0; p[1] = v; p[2] = u; break;
+    case 2: p[0] = u; p[1] = 1.0; p[2] = -v; break;
+    case 3: p[0] = u; p[1] = -1.0; p[2] = v; break;
+    case 4: p[0] = u; p[1] = v; p[2] = 1.0; break;
+    default: p[0] = -u; p[1] = v; p[2] = -1.0; break;
+    }
+    double length = sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+    for (int i = 0; i < 3; ++i) dir[i] = p[i] / length;
+}
+
+// Face coordinate of sample i of a tile (i = 0 and TERRAIN_TILE_SAMPLES - 1
+// are the border)
+inline double terrainSampleCoordinate(int level, int tile, int i) {
+    double size = 2.0 / (1 << level);
+    return -1.0 + size * (tile + (double)(i - 1) / (TERRAIN_TILE_VERTICES - 1));
+}
+
+// gluSphere texture coordinates of a unit direction in the body's frame,
+// so terrain lines up with the planet's texture
+inline void terrainTexCoord(const double* dir, double& s, double& t) {
+    const double pi = 3.14159265358979;
+    double z = dir[2] < -1.0 ? -1.0 : dir[2] > 1.0 ? 1.0 : dir[2];
+    s = atan2(-dir[0], dir[1]) / (2.0 * pi);
+    if (s < 0.0) s += 1.0;
+    t = 1.0 - acos(z) / pi;
+}
@@ -0,0 +1,179 @@
+// Trails.cpp
+#include "Trails.h"
+#include "PerfCounters.h"
+#include <iostream>
+#include <vector>
+
+// Trail t owns samples [t * TRAIL_SAMPLES, (t + 1) * TRAIL_SAMPLES) of the
+// buffer. All trails advance together, so a single head index is shared.
+static int trailCount = 0;
+static int trailHead = 0;   // Slot written by the next tick
+static int trailFilled = 0; // Number of valid samples in every trail
+
+static float* trailSamples = nullptr; // Mapped buffer or client-side array
+static std::vector<float> clientSamples;
+static bool persistentMapped = false;
+
+static GLuint trailVBO = 0;
+static GLuint trailIBO = 0;
+static GLsync trailFence = 0; // Signalled when the last trail draw has finished
+
+// Indices 0..N-1 twice, so any window of the ring is one contiguous range
+static GLuint ringIndices[2 * TRAIL_SAMPLES];
+
+// Per-trail arguments for glMultiDrawElementsBaseVertex
+static std::vector<GLsizei> drawCounts;
+static std::vector<const void*> drawOffsets;
+static std::vector<GLint> drawBaseVertices;
+
+void initTrails(int count) {
+    shutdownTrails();
+
+    trailCount = count;
+    trailHead = 0;
+    trailFilled = 0;
+
+    for (int i = 0; i < 2 * TRAIL_SAMPLES; ++i) {
+        ringIndices[i] = i % TRAIL_SAMPLES;
+    }
+
+    GLsizeiptr bytes = (GLsizeiptr)count * TRAIL_SAMPLES * 3 * sizeof(float);
+    if (GLEW_ARB_buffer_storage && GLEW_ARB_draw_elements_base_vertex && GLEW_ARB_sync) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        glGenBuffers(1, &trailVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, trailVBO);
+        glBufferStorage(GL_ARRAY_BUFFER, bytes, nullptr, flags);
+        trailSamples = (float*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glGenBuffers(1, &trailIBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, trailIBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(ringIndices), ringIndices, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+        persistentMapped = trailSamples != nullptr;
+        if (!persistentMapped) {
+            std::cerr << "Failed to map trail buffer, using client-side arrays" << std::endl;
+            glDeleteBuffers(1, &trailVBO);
+            glDeleteBuffers(1, &trailIBO);
+            trailVBO = trailIBO = 0;
+        }
+    }
+
+    if (!persistentMapped) {
+        clientSamples.assign((size_t)count * TRAIL_SAMPLES * 3, 0.0f);
+        trailSamples = clientSamples.data();
+    }
+
+    drawCounts.assign(count, 0);
+    drawOffsets.assign(count, nullptr);
+    drawBaseVertices.resize(count);
+    for (int t = 0; t < count; ++t) {
+        drawBaseVertices[t] = t * TRAIL_SAMPLES;
+    }
+}
+
+bool beginTrailTick() {
+    if (!trailSamples) return false;
+
+    // The slot we are about to overwrite is the oldest sample, which the
+    // previous draw may still be reading
+    if (trailFence) {
+        glClientWaitSync(trailFence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        glDeleteSync(trailFence);
+        trailFence = 0;
+    }
+    return true;
+}
+
+void writeTrailSamples(const float* x, const float* y, const float* z, int begin, int end) {
+    if (end > trailCount) end = trailCount;
+
+    const size_t stride = (size_t)TRAIL_SAMPLES * 3;
+    float* slot = trailSamples + (size_t)begin * stride + (size_t)trailHead * 3;
+    for (int t = begin; t < end; ++t, slot += stride) {
+        slot[0] = x[t];
+        slot[1] = y[t];
+        slot[2] = z[t];
+    }
+}
+
+void endTrailTick() {
+    trailHead = (trailHead + 1) % TRAIL_SAMPLES;
+    if (trailFilled < TRAIL_SAMPLES) ++trailFilled;
+}
+
+void recordTrailSamples(const float* x, const float* y, const float* z, int count) {
+    if (!beginTrailTick()) return;
+    writeTrailSamples(x, y, z, 0, count);
+    endTrailTick();
+}
+
+void drawTrails() {
+    if (!trailSamples || trailFilled < 2) return;
+
+    // Oldest valid sample; the window [start, start + trailFilled) never wraps
+    // thanks to the doubled index array
+    int start = (trailHead - trailFilled + TRAIL_SAMPLES) % TRAIL_SAMPLES;
+
+    glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT | GL_COLOR_BUFFER_BIT);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_TEXTURE_2D);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glColor4f(0.6f, 0.7f, 1.0f, 0.5f);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    if (persistentMapped) {
+        const void* offset = (const void*)(start * sizeof(GLuint));
+        for (int t = 0; t < trailCount; ++t) {
+            drawCounts[t] = trailFilled;
+            drawOffsets[t] = offset;
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, trailVBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, trailIBO);
+        glVertexPointer(3, GL_FLOAT, 0, (const void*)0);
+        glMultiDrawElementsBaseVertex(GL_LINE_STRIP, drawCounts.data(), GL_UNSIGNED_INT,
+            drawOffsets.data(), trailCount, drawBaseVertices.data());
+        perfCount(PERF_DRAW_CALLS);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        if (trailFence) glDeleteSync(trailFence);
+        trailFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    else {
+        for (int t = 0; t < trailCount; ++t) {
+            glVertexPointer(3, GL_FLOAT, 0, trailSamples + (size_t)t * TRAIL_SAMPLES * 3);
+            glDrawElements(GL_LINE_STRIP, trailFilled, GL_UNSIGNED_INT, ringIndices + start);
+        }
+        perfCount(PERF_DRAW_CALLS, trailCount);
+    }
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    glPopAttrib();
+}
+
+void shutdownTrails() {
+    if (trailFence) {
+        glDeleteSync(trailFence);
+        trailFence = 0;
+    }
+    if (trailVBO) {
+        glBindBuffer(GL_ARRAY_BUFFER, trailVBO);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glDeleteBuffers(1, &trailVBO);
+        trailVBO = 0;
+    }
+    if (trailIBO) {
+        glDeleteBuffers(1, &trailIBO);
+        trailIBO = 0;
+    }
+    clientSamples.clear();
+    trailSamples = nullptr;
+    persistentMapped = false;
+    trailCount = 0;
+}
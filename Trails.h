@@ -0,0 +1,29 @@
+// Trails.h
+#pragma once
+#include <GL/glew.h>
+
+// Number of recent positions kept for each trail
+const int TRAIL_SAMPLES = 512;
+
+// Allocate ring buffer storage for trailCount trails. Uses a persistently
+// mapped buffer (GL_ARB_buffer_storage) when available, otherwise falls back
+// to a client-side array with the same layout.
+void initTrails(int trailCount);
+
+// Write one sample per trail into the ring (called once per update() tick).
+// Only the newest slot is touched; older samples are never re-uploaded.
+void recordTrailSamples(const float* x, const float* y, const float* z, int count);
+
+// recordTrailSamples() split in three so the writes can run as jobs.
+// beginTrailTick() waits on the GL fence and must run on the GL thread;
+// writeTrailSamples() touches only memory and may run on any thread for
+// disjoint trail ranges; endTrailTick() advances the shared head.
+bool beginTrailTick();
+void writeTrailSamples(const float* x, const float* y, const float* z, int begin, int end);
+void endTrailTick();
+
+// Draw every trail as a line strip from its oldest to its newest sample
+void drawTrails();
+
+// Unmap and free the trail buffers
+void shutdownTrails();
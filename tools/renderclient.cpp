@@ -0,0 +1,142 @@
+// renderclient.cpp
+// Example client for the render server (solar_system --serve <socket>,
+// messages in RenderServerFormat.h). It sends a burst of thumbnail
+// requests for a few epochs and camera angles without waiting in between,
+// collects the answers, saves the first ones as PNG files and reports the
+// request rate. It then sends a few single requests at one epoch, each
+// after the previous answer, so every one arrives in a batch of its own.
+// Usage: renderclient <socket> [count] [size] [follow]
+#include "../RenderServerFormat.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static bool readAll(int fd, void* data, size_t size) {
+    unsigned char* bytes = (unsigned char*)data;
+    while (size > 0) {
+        ssize_t n = recv(fd, bytes, size, 0);
+        if (n <= 0) return false;
+        bytes += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+static bool writeAll(int fd, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    while (size > 0) {
+        ssize_t n = send(fd, bytes, size, 0);
+        if (n <= 0) return false;
+        bytes += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+// Read one response and its image; exits if the connection is lost
+static RenderResponse readResponse(int fd, std::vector<unsigned char>& image) {
+    RenderResponse response;
+    if (!readAll(fd, &response, sizeof(response)) || memcmp(response.magic, RENDER_RESPONSE_MAGIC, 4) != 0) {
+        std::cerr << "Connection lost before a response" << std::endl;
+        exit(1);
+    }
+    image.resize((size_t)response.imageBytes);
+    if (!readAll(fd, image.data(), image.size())) {
+        std::cerr << "Connection lost in an image" << std::endl;
+        exit(1);
+    }
+    return response;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: renderclient <socket> [count] [size] [follow]" << std::endl;
+        return 1;
+    }
+    int count = argc > 2 ? atoi(argv[2]) : 100;
+    int size = argc > 3 ? atoi(argv[3]) : 128;
+    const char* follow = argc > 4 ? argv[4] : "";
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, argv[1], sizeof(address.sun_path) - 1);
+    if (fd < 0 || connect(fd, (const sockaddr*)&address, sizeof(address)) != 0) {
+        std::cerr << "Failed to connect to " << argv[1] << std::endl;
+        return 1;
+    }
+
+    // Four epochs and a circle of views; the server batches the repeats
+    std::vector<RenderRequest> requests(count);
+    for (int i = 0; i < count; ++i) {
+        RenderRequest& r = requests[i];
+        memset(&r, 0, sizeof(r));
+        memcpy(r.magic, RENDER_REQUEST_MAGIC, 4);
+        r.version = RENDER_PROTOCOL_VERSION;
+        r.id = (uint64_t)i;
+        r.simulationTime = 10.0 * (i % 4);
+        r.angleX = 360.0f * i / count;
+        r.angleY = 30.0f;
+        r.zoom = follow[0] ? -3.0f : -30.0f;
+        r.layers = RENDER_LAYER_SPHERES | RENDER_LAYER_POINTS;
+        r.width = size;
+        r.height = size;
+        strncpy(r.follow, follow, RENDER_FOLLOW_NAME_BYTES - 1);
+    }
+
+    // Send from another thread: once the server's queue is full it stops
+    // reading, and only makes room again as the answers are read
+    auto start = std::chrono::steady_clock::now();
+    std::thread sender([&] {
+        if (!writeAll(fd, requests.data(), requests.size() * sizeof(RenderRequest))) {
+            std::cerr << "Failed to send the requests" << std::endl;
+        }
+    });
+    int failed = 0;
+    std::vector<unsigned char> image;
+    for (int i = 0; i < count; ++i) {
+        RenderResponse response = readResponse(fd, image);
+        if (response.status != RENDER_OK) {
+            ++failed;
+            continue;
+        }
+        if (response.id < 4) {
+            std::string name = "thumbnail_" + std::to_string(response.id) + ".png";
+            FILE* file = fopen(name.c_str(), "wb");
+            if (file) {
+                fwrite(image.data(), 1, image.size(), file);
+                fclose(file);
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    sender.join();
+    printf("%d renders (%d failed) in %.3f s, %.1f per second\n", count, failed, seconds, count / seconds);
+
+    // Repeat one epoch in separate batches; the server reuses the scene it
+    // set up for the first and must still answer the rest
+    int repeats = 3, repeatFailed = 0;
+    if (count > 0) {
+        RenderRequest repeat = requests[count - 1];
+        for (int i = 0; i < repeats; ++i) {
+            repeat.id = (uint64_t)(count + i);
+            if (!writeAll(fd, &repeat, sizeof(repeat))) {
+                std::cerr << "Failed to send a repeated request" << std::endl;
+                exit(1);
+            }
+            if (readResponse(fd, image).status != RENDER_OK) ++repeatFailed;
+        }
+        printf("%d repeated renders at one epoch (%d failed)\n", repeats, repeatFailed);
+    }
+    close(fd);
+    return failed || repeatFailed ? 1 : 0;
+}
@@ -0,0 +1,217 @@
+// sceneconv.cpp
+// Converts a text scene description into the binary scene read by Bodies.cpp.
+//
+// Input: one body per line, whitespace separated:
+//     name kind parent radius distance inclination phase orbit_rate spin_rate texture flags
+// kind is star, planet, moon or asteroid. parent names an earlier body, or
+// is '-' for a root. Angles are in degrees and rates in degrees per second.
+// texture is a BMP path, or '-' to draw the body as a point. flags is a
+// comma-separated list of trail, orbit, rings, label and atmosphere, or
+// '-'. A name of '-' leaves the body unnamed. Lines starting with '#' are
+// ignored.
+// Usage: sceneconv scene.txt scene.scn
+#include "../SceneFormat.h"
+#include "../Bodies.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+struct TextBody {
+    std::string name, texture;
+    int kind, parent, flags, depth;
+    float radius, distance, inclination, phase, orbitRate, spinRate;
+};
+
+static int parseKind(const char* s) {
+    if (strcmp(s, "star") == 0) return BODY_STAR;
+    if (strcmp(s, "planet") == 0) return BODY_PLANET;
+    if (strcmp(s, "moon") == 0) return BODY_MOON;
+    if (strcmp(s, "asteroid") == 0) return BODY_ASTEROID;
+    return -1;
+}
+
+static int parseFlags(const char* s) {
+    int flags = 0;
+    std::string list(s);
+    size_t start = 0;
+    while (start < list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) end = list.size();
+        std::string flag = list.substr(start, end - start);
+        if (flag == "trail") flags |= BODY_FLAG_TRAIL;
+        else if (flag == "orbit") flags |= BODY_FLAG_ORBIT;
+        else if (flag == "rings") flags |= BODY_FLAG_RINGS;
+        else if (flag == "label") flags |= BODY_FLAG_LABEL;
+        else if (flag == "atmosphere") flags |= BODY_FLAG_ATMOSPHERE;
+        else if (flag != "-") return -1;
+        start = end + 1;
+    }
+    return flags;
+}
+
+// Deduplicated table of NUL-terminated strings
+static int32_t addString(const std::string& s, std::vector<char>& table, std::map<std::string, int32_t>& offsets) {
+    if (s == "-") return -1;
+    auto it = offsets.find(s);
+    if (it != offsets.end()) return it->second;
+    int32_t offset = (int32_t)table.size();
+    table.insert(table.end(), s.begin(), s.end());
+    table.push_back('\0');
+    offsets[s] = offset;
+    return offset;
+}
+
+static uint64_t align16(uint64_t offset) {
+    return (offset + 15) & ~(uint64_t)15;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: sceneconv <scene.txt> <scene.scn>" << std::endl;
+        return 1;
+    }
+
+    FILE* in = fopen(argv[1], "r");
+    if (!in) {
+        std::cerr << "Failed to open input: " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::vector<TextBody> input;
+    std::map<std::string, int> byName;
+    char line[1024];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), in)) {
+        ++lineNumber;
+        if (line[0] == '#') continue;
+
+        char name[256], kind[32], parent[256], texture[512], flags[128];
+        TextBody body;
+        int fields = sscanf(line, "%255s %31s %255s %f %f %f %f %f %f %511s %127s", name, kind, parent,
+            &body.radius, &body.distance, &body.inclination, &body.phase, &body.orbitRate, &body.spinRate,
+            texture, flags);
+        if (fields <= 0) continue; // Blank line
+        if (fields != 11) {
+            std::cerr << argv[1] << ":" << lineNumber << ": expected 11 fields" << std::endl;
+            fclose(in);
+            return 1;
+        }
+
+        body.name = name;
+        body.texture = texture;
+        body.kind = parseKind(kind);
+        body.flags = parseFlags(flags);
+        body.parent = -1;
+        body.depth = 0;
+        if (strcmp(parent, "-") != 0) {
+            auto it = byName.find(parent);
+            if (it == byName.end()) {
+                std::cerr << argv[1] << ":" << lineNumber << ": unknown parent " << parent << std::endl;
+                fclose(in);
+                return 1;
+            }
+            body.parent = it->second;
+            body.depth = input[it->second].depth + 1;
+        }
+        if (body.kind < 0 || body.flags < 0 || body.depth >= SCENE_MAX_LEVELS) {
+            std::cerr << argv[1] << ":" << lineNumber << ": bad kind, flags or nesting depth" << std::endl;
+            fclose(in);
+            return 1;
+        }
+
+        if (body.name != "-") byName[body.name] = (int)input.size();
+        input.push_back(body);
+    }
+    fclose(in);
+
+    // Stable counting sort by depth so parents precede children
+    SceneHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SCENE_MAGIC, 4);
+    header.version = SCENE_VERSION;
+    header.bodyCount = (uint32_t)input.size();
+
+    int levelSize[SCENE_MAX_LEVELS] = {};
+    for (const TextBody& b : input) {
+        ++levelSize[b.depth];
+        if (b.depth + 1 > (int)header.levelCount) header.levelCount = b.depth + 1;
+    }
+    for (uint32_t l = 0; l < header.levelCount; ++l) {
+        header.levelStart[l + 1] = header.levelStart[l] + levelSize[l];
+    }
+
+    std::vector<int> order(input.size()), newIndex(input.size());
+    uint32_t next[SCENE_MAX_LEVELS];
+    memcpy(next, header.levelStart, sizeof(next));
+    for (size_t i = 0; i < input.size(); ++i) {
+        newIndex[i] = (int)next[input[i].depth]++;
+        order[newIndex[i]] = (int)i;
+    }
+
+    std::vector<char> hasChildren(input.size(), 0);
+    for (const TextBody& b : input) {
+        if (b.parent >= 0) hasChildren[b.parent] = 1;
+    }
+
+    // Build the columns in sorted order
+    size_t n = input.size();
+    std::vector<int32_t> intColumns[SCENE_RADIUS];
+    std::vector<float> floatColumns[SCENE_COLUMN_COUNT - SCENE_RADIUS];
+    for (auto& c : intColumns) c.resize(n);
+    for (auto& c : floatColumns) c.resize(n);
+
+    std::vector<char> strings;
+    std::map<std::string, int32_t> stringOffsets;
+    for (size_t i = 0; i < n; ++i) {
+        int src = order[i];
+        const TextBody& b = input[src];
+        bool needsFrame = b.texture != "-" || hasChildren[src];
+
+        intColumns[SCENE_KIND][i] = b.kind;
+        intColumns[SCENE_PARENT][i] = b.parent >= 0 ? newIndex[b.parent] : -1;
+        intColumns[SCENE_FLAGS][i] = b.flags;
+        intColumns[SCENE_NAME][i] = addString(b.name, strings, stringOffsets);
+        intColumns[SCENE_TEXTURE][i] = addString(b.texture, strings, stringOffsets);
+        intColumns[SCENE_FRAME_SLOT][i] = needsFrame ? (int32_t)header.frameCount++ : -1;
+        floatColumns[SCENE_RADIUS - SCENE_RADIUS][i] = b.radius;
+        floatColumns[SCENE_DISTANCE - SCENE_RADIUS][i] = b.distance;
+        floatColumns[SCENE_INCLINATION - SCENE_RADIUS][i] = b.inclination;
+        floatColumns[SCENE_PHASE - SCENE_RADIUS][i] = b.phase;
+        floatColumns[SCENE_ORBIT_RATE - SCENE_RADIUS][i] = b.orbitRate;
+        floatColumns[SCENE_SPIN_RATE - SCENE_RADIUS][i] = b.spinRate;
+    }
+
+    uint64_t offset = align16(sizeof(header));
+    for (int c = 0; c < SCENE_COLUMN_COUNT; ++c) {
+        header.columnOffset[c] = offset;
+        offset = align16(offset + n * 4);
+    }
+    header.stringOffset = offset;
+    header.stringSize = strings.size();
+
+    FILE* out = fopen(argv[2], "wb");
+    if (!out) {
+        std::cerr << "Failed to open output: " << argv[2] << std::endl;
+        return 1;
+    }
+    static const char padding[16] = {};
+    uint64_t written = 0;
+    auto writeAt = [&](uint64_t at, const void* data, size_t bytes) {
+        fwrite(padding, 1, (size_t)(at - written), out);
+        fwrite(data, 1, bytes, out);
+        written = at + bytes;
+    };
+    writeAt(0, &header, sizeof(header));
+    for (int c = 0; c < SCENE_COLUMN_COUNT; ++c) {
+        const void* data = c < SCENE_RADIUS ? (const void*)intColumns[c].data() : (const void*)floatColumns[c - SCENE_RADIUS].data();
+        writeAt(header.columnOffset[c], data, n * 4);
+    }
+    writeAt(header.stringOffset, strings.data(), strings.size());
+    fclose(out);
+
+    std::cout << "Wrote " << n << " bodies in " << header.levelCount << " levels to " << argv[2] << std::endl;
+    return 0;
+}
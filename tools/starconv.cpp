@@ -0,0 +1,79 @@
+// starconv.cpp
+// Converts a text star list into the binary catalog read by Stars.cpp.
+//
+// Input: one star per line as "ra_deg,dec_deg,vmag,b_v" (for example an
+// extract of Hipparcos or Tycho-2). Lines starting with '#' are ignored.
+// Usage: starconv stars.csv catalog/stars.bin
+#include "../StarCatalog.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Rough B-V color index to RGB ramp, from blue-white to deep orange
+static void colorFromBV(float bv, uint8_t* rgba) {
+    float t = std::min(std::max((bv + 0.4f) / 2.4f, 0.0f), 1.0f);
+    float r = 0.65f + 0.35f * std::min(t * 2.0f, 1.0f);
+    float g = 0.75f + 0.25f * (1.0f - fabsf(t - 0.35f) * 2.0f);
+    float b = 1.0f - 0.65f * t;
+    rgba[0] = (uint8_t)(255.0f * std::min(r, 1.0f));
+    rgba[1] = (uint8_t)(255.0f * std::min(std::max(g, 0.0f), 1.0f));
+    rgba[2] = (uint8_t)(255.0f * std::max(b, 0.0f));
+    rgba[3] = 255;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: starconv <input.csv> <output.bin>" << std::endl;
+        return 1;
+    }
+
+    FILE* in = fopen(argv[1], "r");
+    if (!in) {
+        std::cerr << "Failed to open input: " << argv[1] << std::endl;
+        return 1;
+    }
+
+    const double degToRad = 3.14159265358979 / 180.0;
+    std::vector<StarRecord> stars;
+    char line[256];
+    while (fgets(line, sizeof(line), in)) {
+        if (line[0] == '#') continue;
+        double ra, dec;
+        float mag, bv = 0.6f;
+        if (sscanf(line, "%lf,%lf,%f,%f", &ra, &dec, &mag, &bv) < 3) continue;
+
+        // Equatorial direction with the celestial pole along +Y
+        StarRecord s;
+        s.x = (float)(cos(dec * degToRad) * cos(ra * degToRad));
+        s.y = (float)sin(dec * degToRad);
+        s.z = (float)(-cos(dec * degToRad) * sin(ra * degToRad));
+        s.magnitude = mag;
+        colorFromBV(bv, s.color);
+        stars.push_back(s);
+    }
+    fclose(in);
+
+    std::sort(stars.begin(), stars.end(),
+        [](const StarRecord& a, const StarRecord& b) { return a.magnitude < b.magnitude; });
+
+    StarCatalogHeader header;
+    memcpy(header.magic, STAR_CATALOG_MAGIC, 4);
+    header.version = STAR_CATALOG_VERSION;
+    header.count = (uint32_t)stars.size();
+    header.reserved = 0;
+
+    FILE* out = fopen(argv[2], "wb");
+    if (!out) {
+        std::cerr << "Failed to open output: " << argv[2] << std::endl;
+        return 1;
+    }
+    fwrite(&header, sizeof(header), 1, out);
+    fwrite(stars.data(), sizeof(StarRecord), stars.size(), out);
+    fclose(out);
+
+    std::cout << "Wrote " << stars.size() << " stars to " << argv[2] << std::endl;
+    return 0;
+}
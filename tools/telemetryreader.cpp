@@ -0,0 +1,113 @@
+// telemetryreader.cpp
+// Example reader for the live telemetry published with --telemetry <name>
+// (layout in TelemetryFormat.h). It maps the region read-only and prints
+// the newest positions of a few bodies ten times a second, reading them in
+// place under the slot's seqlock.
+// Usage: telemetryreader <name> [body ...]
+#include "../TelemetryFormat.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Map the whole region read-only, or return null
+static const unsigned char* mapRegion(const char* name) {
+#ifdef _WIN32
+    std::string path = std::string("Local\\") + name;
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, path.c_str());
+    if (!mapping) return nullptr;
+    return (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    std::string path = name[0] == '/' ? name : std::string("/") + name;
+    int fd = shm_open(path.c_str(), O_RDONLY, 0);
+    if (fd < 0) return nullptr;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(TelemetryHeader)) {
+        close(fd);
+        return nullptr;
+    }
+    void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    return view == MAP_FAILED ? nullptr : (const unsigned char*)view;
+#endif
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: telemetryreader <name> [body ...]" << std::endl;
+        return 1;
+    }
+
+    const unsigned char* region = mapRegion(argv[1]);
+    if (!region) {
+        std::cerr << "No telemetry region named " << argv[1] << " (is the simulation running with --telemetry?)" << std::endl;
+        return 1;
+    }
+    const TelemetryHeader* header = (const TelemetryHeader*)region;
+    if (memcmp(header->magic, TELEMETRY_MAGIC, 4) != 0 || header->version != TELEMETRY_VERSION) {
+        std::cerr << "Not a telemetry region of this version: " << argv[1] << std::endl;
+        return 1;
+    }
+
+    // The static part never changes, so names are looked up once
+    const int32_t* nameOffsets = (const int32_t*)(region + header->nameOffset);
+    const char* strings = (const char*)(region + header->stringsOffset);
+    std::vector<int> watched;
+    for (uint32_t b = 0; b < header->bodyCount; ++b) {
+        const char* name = nameOffsets[b] >= 0 ? strings + nameOffsets[b] : nullptr;
+        bool wanted = argc == 2 ? watched.size() < 4 : false;
+        for (int i = 2; i < argc && name; ++i) wanted = wanted || strcmp(argv[i], name) == 0;
+        if (wanted) watched.push_back((int)b);
+    }
+    std::cout << header->bodyCount << " bodies, " << header->slotCount << " slots" << std::endl;
+
+    uint64_t lastTick = 0;
+    int retries = 0;
+    for (;;) {
+        uint64_t tick = header->latestTick.load(std::memory_order_acquire);
+        if (tick == 0 || tick == lastTick) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+
+        // Read in place, then make sure the writer did not reuse the slot meanwhile
+        TelemetrySlot* slot = telemetrySlot(header, tick);
+        if (slot->sequence.load(std::memory_order_acquire) != 2 * tick) {
+            ++retries;
+            continue;
+        }
+        double time = slot->simulationTime;
+        double position[8][3];
+        int shown = watched.size() < 8 ? (int)watched.size() : 8;
+        for (int i = 0; i < shown; ++i) {
+            for (int c = 0; c < 3; ++c) position[i][c] = telemetryColumn(header, slot, c)[watched[i]];
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->sequence.load(std::memory_order_relaxed) != 2 * tick) {
+            ++retries;
+            continue;
+        }
+
+        printf("tick %llu  t=%.3f s  (%d retries)\n", (unsigned long long)tick, time, retries);
+        for (int i = 0; i < shown; ++i) {
+            int b = watched[i];
+            printf("  %-12s %10.4f %10.4f %10.4f\n", nameOffsets[b] >= 0 ? strings + nameOffsets[b] : "-",
+                position[i][0], position[i][1], position[i][2]);
+        }
+        fflush(stdout);
+        lastTick = tick;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+}
@@ -0,0 +1,212 @@
+// terrainconv.cpp
+// Builds the heightmap tile pyramid read by Terrain.cpp.
+//
+// Input: a binary 16-bit PGM (P5, maxval above 255) in the same
+// equirectangular layout as the planet textures, north at the top; black is
+// the lowest ground and white the highest. With --synthetic no input is
+// read and cratered fractal hills are generated instead, for testing.
+// --flat writes level ground everywhere, a fixture for the texture mapping:
+// it must look exactly like the plain textured sphere, the tiles facing the
+// poles (on faces 4 and 5) included, so any smear at the caps stands out.
+// --relief sets the height of the highest ground above the mean as a
+// fraction of the planet's radius.
+// Usage: terrainconv [--levels N] [--relief F] <input.pgm | --synthetic | --flat> terrain/Earth.ter
+#include "../TerrainFormat.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+struct Heightmap {
+    int width = 0, height = 0;
+    std::vector<float> values; // -1 to 1, row 0 at the north pole
+};
+
+static bool readPGM(const char* path, Heightmap& map) {
+    FILE* in = fopen(path, "rb");
+    if (!in) {
+        std::cerr << "Failed to open input: " << path << std::endl;
+        return false;
+    }
+    int maxValue = 0;
+    char magic[3] = {};
+    bool ok = fscanf(in, "%2s", magic) == 1 && strcmp(magic, "P5") == 0;
+    // Header fields may be separated by comment lines
+    int* fields[3] = { &map.width, &map.height, &maxValue };
+    for (int i = 0; ok && i < 3; ++i) {
+        int c;
+        while ((c = fgetc(in)) == '#' || isspace(c)) {
+            if (c == '#') while ((c = fgetc(in)) != '\n' && c != EOF) {}
+        }
+        ungetc(c, in);
+        ok = fscanf(in, "%d", fields[i]) == 1;
+    }
+    ok = ok && fgetc(in) != EOF && map.width > 0 && map.height > 1 && maxValue > 255 && maxValue < 65536;
+    if (!ok) {
+        std::cerr << "Not a 16-bit binary PGM: " << path << std::endl;
+        fclose(in);
+        return false;
+    }
+
+    std::vector<unsigned char> row((size_t)map.width * 2);
+    map.values.resize((size_t)map.width * map.height);
+    for (int y = 0; y < map.height && ok; ++y) {
+        ok = fread(row.data(), 1, row.size(), in) == row.size();
+        for (int x = 0; x < map.width; ++x) {
+            int value = (row[2 * x] << 8) | row[2 * x + 1]; // Big-endian
+            map.values[(size_t)y * map.width + x] = 2.0f * value / maxValue - 1.0f;
+        }
+    }
+    fclose(in);
+    if (!ok) std::cerr << "Truncated PGM: " << path << std::endl;
+    return ok;
+}
+
+// Bilinear lookup, wrapping east-west
+static float sampleHeightmap(const Heightmap& map, const double* dir) {
+    double s, t;
+    terrainTexCoord(dir, s, t);
+    double fx = s * map.width - 0.5, fy = (1.0 - t) * (map.height - 1);
+    int x0 = (int)floor(fx), y0 = std::min((int)fy, map.height - 2);
+    float ax = (float)(fx - x0), ay = (float)(fy - y0);
+    x0 = (x0 % map.width + map.width) % map.width;
+    int x1 = (x0 + 1) % map.width;
+    const float* top = &map.values[(size_t)y0 * map.width];
+    const float* bottom = top + map.width;
+    float upper = top[x0] + (top[x1] - top[x0]) * ax;
+    float lower = bottom[x0] + (bottom[x1] - bottom[x0]) * ax;
+    return upper + (lower - upper) * ay;
+}
+
+// Value noise on the lattice of a 3D point
+static float hashLattice(int x, int y, int z) {
+    uint32_t h = (uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)z * 83492791u;
+    h ^= h >> 13;
+    h *= 0x5bd1e995u;
+    h ^= h >> 15;
+    return (h & 0xffffff) / (float)0x800000 - 1.0f;
+}
+
+static float valueNoise(double x, double y, double z) {
+    int ix = (int)floor(x), iy = (int)floor(y), iz = (int)floor(z);
+    double fx = x - ix, fy = y - iy, fz = z - iz;
+    float ux = (float)(fx * fx * (3.0 - 2.0 * fx));
+    float uy = (float)(fy * fy * (3.0 - 2.0 * fy));
+    float uz = (float)(fz * fz * (3.0 - 2.0 * fz));
+    float c[2][2];
+    for (int j = 0; j < 2; ++j) {
+        for (int k = 0; k < 2; ++k) {
+            float a = hashLattice(ix, iy + j, iz + k), b = hashLattice(ix + 1, iy + j, iz + k);
+            c[j][k] = a + (b - a) * ux;
+        }
+    }
+    float front = c[0][0] + (c[1][0] - c[0][0]) * uy;
+    float back = c[0][1] + (c[1][1] - c[0][1]) * uy;
+    return front + (back - front) * uz;
+}
+
+// Fractal hills with a scattering of bowl craters, roughly -1 to 1
+static float syntheticHeight(const double* dir, int octaves) {
+    float height = 0.0f, amplitude = 0.5f;
+    double frequency = 4.0;
+    for (int i = 0; i < octaves; ++i) {
+        height += amplitude * valueNoise(dir[0] * frequency + 17.0 * i, dir[1] * frequency, dir[2] * frequency);
+        amplitude *= 0.5f;
+        frequency *= 2.0;
+    }
+
+    // One candidate crater per lattice cell, at two sizes
+    for (double cells = 6.0; cells <= 24.0; cells *= 4.0) {
+        double p[3] = { dir[0] * cells, dir[1] * cells, dir[2] * cells };
+        int cx = (int)floor(p[0]), cy = (int)floor(p[1]), cz = (int)floor(p[2]);
+        if (hashLattice(cx, cy, cz + 1000) < 0.2f) continue;
+        double center[3] = { cx + 0.5 + 0.15 * hashLattice(cx, cy, cz + 2000), cy + 0.5 + 0.15 * hashLattice(cx, cy, cz + 3000),
+            cz + 0.5 + 0.15 * hashLattice(cx, cy, cz + 4000) };
+        double dx = p[0] - center[0], dy = p[1] - center[1], dz = p[2] - center[2];
+        double r = sqrt(dx * dx + dy * dy + dz * dz) / 0.25;
+        if (r < 1.0) height += (float)((r * r - 0.7) * 0.6 / cells * 6.0);
+        else if (r < 1.4) height += (float)((1.4 - r) * 0.4 / cells * 6.0); // Rim
+    }
+    return std::min(std::max(height, -1.0f), 1.0f);
+}
+
+int main(int argc, char** argv) {
+    int levels = 7;
+    double relief = 0.002;
+    const char* input = nullptr;
+    const char* output = nullptr;
+    bool synthetic = false, flat = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--levels") && i + 1 < argc) levels = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--relief") && i + 1 < argc) relief = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--synthetic")) synthetic = true;
+        else if (!strcmp(argv[i], "--flat")) flat = true;
+        else if (!input && !synthetic && !flat) input = argv[i];
+        else output = argv[i];
+    }
+    if ((!input && !synthetic && !flat) || !output || levels < 1 || levels > TERRAIN_MAX_LEVELS || relief <= 0.0) {
+        std::cerr << "Usage: terrainconv [--levels 1-" << TERRAIN_MAX_LEVELS << "] [--relief fraction] "
+            << "<input.pgm | --synthetic | --flat> <output.ter>" << std::endl;
+        return 1;
+    }
+
+    Heightmap map;
+    if (!synthetic && !flat && !readPGM(input, map)) return 1;
+
+    FILE* out = fopen(output, "wb");
+    if (!out) {
+        std::cerr << "Failed to open output: " << output << std::endl;
+        return 1;
+    }
+
+    TerrainHeader header = {};
+    memcpy(header.magic, TERRAIN_MAGIC, 4);
+    header.version = TERRAIN_VERSION;
+    header.levels = levels;
+    header.tileSamples = TERRAIN_TILE_SAMPLES;
+    header.heightScale = (float)(relief / 32767.0);
+    fwrite(&header, sizeof(header), 1, out);
+
+    // Noise detail follows the finest level's sample spacing
+    int octaves = 4 + levels;
+    int largest = 0;
+    std::vector<int16_t> tile(TERRAIN_TILE_SAMPLES * TERRAIN_TILE_SAMPLES);
+    for (int level = 0; level < levels; ++level) {
+        int side = 1 << level;
+        for (int face = 0; face < 6; ++face) {
+            for (int y = 0; y < side; ++y) {
+                for (int x = 0; x < side; ++x) {
+                    for (int j = 0; j < TERRAIN_TILE_SAMPLES; ++j) {
+                        for (int i = 0; i < TERRAIN_TILE_SAMPLES; ++i) {
+                            double dir[3];
+                            terrainDirection(face, terrainSampleCoordinate(level, x, i), terrainSampleCoordinate(level, y, j), dir);
+                            float h = flat ? 0.0f : synthetic ? syntheticHeight(dir, octaves) : sampleHeightmap(map, dir);
+                            int16_t value = (int16_t)lrintf(h * 32767.0f);
+                            tile[j * TERRAIN_TILE_SAMPLES + i] = value;
+                            largest = std::max(largest, abs((int)value));
+                        }
+                    }
+                    fwrite(tile.data(), sizeof(int16_t), tile.size(), out);
+                }
+            }
+        }
+        std::cout << "Level " << level << ": " << 6 * side * side << " tiles" << std::endl;
+    }
+
+    // The bound is only known once every sample has been seen
+    header.maxHeight = largest * header.heightScale;
+    fseek(out, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, out);
+    bool ok = !ferror(out);
+    fclose(out);
+    if (!ok) {
+        std::cerr << "Failed to write output: " << output << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << terrainLevelStart(levels) << " tiles to " << output << std::endl;
+    return 0;
+}